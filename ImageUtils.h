@@ -224,4 +224,106 @@ void printDataRange(const CvArr *src, const char *msg);
 #endif
 
 
-#endif 
+#ifdef __cplusplus
+
+// cv::Mat versions of the color converters, using the same 8-bit formulas as the IplImage versions above.
+// They write into 'dst' (only reallocated if it doesn't already have the right size & type, so it can be reused between frames),
+// process several pixels at a time using SSE2 when available, and split the rows across threads using cv::parallel_for_.
+// 'dst' can be the same image as 'src'. Returns false if the input is not an 8-bit 3-channel image, instead of calling exit().
+bool convertImageRGBtoHSV(const cv::Mat &imageRGB, cv::Mat &imageHSV);
+
+bool convertImageHSVtoRGB(const cv::Mat &imageHSV, cv::Mat &imageRGB);
+
+bool convertImageRGBtoYIQ(const cv::Mat &imageRGB, cv::Mat &imageYIQ);
+
+bool convertImageYIQtoRGB(const cv::Mat &imageYIQ, cv::Mat &imageRGB);
+
+// cv::Mat version of 'blendImage()', giving exactly the same pixels but blending into 'imageBlended' (which is only reallocated if needed,
+// and can be the same image as 'image1' to blend an overlay directly onto a frame). Uses SSE2 16-bit multiply-high arithmetic when available,
+// and splits the rows across threads using cv::parallel_for_ if 'useThreads' is true.
+bool blendImage(const cv::Mat &image1, const cv::Mat &image2, const cv::Mat &imageAlphaMask, cv::Mat &imageBlended, bool useThreads DEFAULT(true));
+
+
+// cv::Mat versions of 'cropImage()', 'resizeImage()' and 'rotateImage()'. They are inline so that they don't need ImageUtils_0.7.cpp.
+// Unlike the IplImage versions, they never modify the input image (not even its ROI), so they can be called from several threads
+// on the same frame at once, and they return false or an empty Mat for bad input instead of calling exit().
+
+// Returns a view of the region of 'img' (sharing its pixels, so nothing is copied). The region is clipped to fit in the image.
+// Call clone() on the result if the crop needs to outlive or be modified separately from 'img'.
+inline cv::Mat cropImage(const cv::Mat &img, const cv::Rect &region)
+{
+    cv::Rect r = region & cv::Rect(0, 0, img.cols, img.rows);
+    if (r.width <= 0 || r.height <= 0)
+        return cv::Mat();
+    return img(r);
+}
+
+// Resizes 'src' into 'dst' (only reallocated if it doesn't already have the right size & type, so it can be reused between frames).
+// The aspect ratio will be kept constant if 'keepAspectRatio' is true, by cropping off the edges, the same way as 'resizeImage()' does.
+inline bool resizeImage(const cv::Mat &src, cv::Mat &dst, cv::Size newSize, bool keepAspectRatio)
+{
+    if (newSize.width <= 0 || newSize.height <= 0 || src.cols <= 0 || src.rows <= 0) {
+        LOG("ERROR: Bad desired image size of %dx%d in resizeImage() for an image of %dx%d.", newSize.width, newSize.height, src.cols, src.rows);
+        return false;
+    }
+
+    cv::Mat input = src;
+    if (keepAspectRatio) {
+        // Crop the middle section (just a view into 'src', not a copy) so that it has the new aspect ratio.
+        float origAspect = (src.cols / (float)src.rows);
+        float newAspect = (newSize.width / (float)newSize.height);
+        if (origAspect > newAspect) {
+            int tw = (src.rows * newSize.width) / newSize.height;
+            input = src(cv::Rect((src.cols - tw)/2, 0, tw, src.rows));
+        }
+        else {
+            int th = (src.cols * newSize.height) / newSize.width;
+            input = src(cv::Rect(0, (src.rows - th)/2, src.cols, th));
+        }
+    }
+
+    // INTER_LINEAR is good for enlarging, and INTER_AREA is good for shrinking.
+    int interpolation = cv::INTER_AREA;
+    if (newSize.width > input.cols && newSize.height > input.rows)
+        interpolation = cv::INTER_LINEAR;
+
+    // resize() can't write into its own input, so use a temporary image if they share the same pixels.
+    if (dst.data == src.data && !dst.empty()) {
+        cv::Mat resized;
+        cv::resize(input, resized, newSize, 0, 0, interpolation);
+        dst = resized;
+    }
+    else {
+        cv::resize(input, dst, newSize, 0, 0, interpolation);
+    }
+    return true;
+}
+
+// Rotates 'src' clockwise and possibly scales it into 'dst' (only reallocated if needed), giving the same result as 'rotateImage()'.
+// Use 'mapRotatedImagePoint()' to map pixels from the src to dst image.
+inline bool rotateImage(const cv::Mat &src, cv::Mat &dst, float angleDegrees, float scale DEFAULT(1.0f))
+{
+    if (src.empty() || scale <= 1e-20 || (dst.data == src.data && !dst.empty())) {
+        LOG("ERROR: Bad input for rotateImage() (empty image, bad scale of %f, or rotating an image into itself).", scale);
+        return false;
+    }
+
+    // Same transform as in 'rotateImage()', where cvGetQuadrangleSubPix() measures the dst pixels from the center of the dst image.
+    float divscale = 1.0f / scale;
+    float angleRadians = angleDegrees * ((float)CV_PI / 180.0f);
+    float a = (float)(cos(angleRadians) * divscale);
+    float b = (float)(sin(angleRadians) * divscale);
+    cv::Size sizeRotated = cv::Size(cvRound(scale * src.cols), cvRound(scale * src.rows));
+    float cx = (sizeRotated.width - 1) * 0.5f;
+    float cy = (sizeRotated.height - 1) * 0.5f;
+    float m[6] = { a, b, src.cols*0.5f - a*cx - b*cy,
+                  -b, a, src.rows*0.5f + b*cx - a*cy };
+
+    cv::warpAffine(src, dst, cv::Mat(2, 3, CV_32F, m), sizeRotated, cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
+    return true;
+}
+
+#endif
+
+
+#endif
@@ -12,6 +12,9 @@
 
 #include "ImageUtils.h"
 
+#if CV_SSE2
+    #include <emmintrin.h>
+#endif
 
 
 using namespace std;
@@ -922,12 +925,12 @@ inline void convertPixelRGBtoHSV_256(int bR, int bG, int bB, int &bH, int &bS, i
 // Remember to free the generated HSV image.
 IplImage* convertImageRGBtoHSV(const IplImage *imageRGB)
 {
-    // Create a blank HSV image
-    IplImage *imageHSV = cvCreateImage(cvGetSize(imageRGB), 8, 3);
-    if (!imageHSV || imageRGB->depth != 8 || imageRGB->nChannels != 3) {
+    if (!imageRGB || imageRGB->depth != 8 || imageRGB->nChannels != 3) {
         LOG("ERROR in convertImageRGBtoHSV()! Bad input image.\n");
-        exit(1);
+        return NULL;
     }
+    // Create a blank HSV image
+    IplImage *imageHSV = cvCreateImage(cvGetSize(imageRGB), 8, 3);
 
     int h = imageRGB->height;                // Pixel height
     int w = imageRGB->width;                // Pixel width
@@ -1060,12 +1063,12 @@ inline void convertPixelHSVtoRGB_256(int bH, int bS, int bV, int &bR, int &bG, i
 // Remember to free the generated RGB image.
 IplImage* convertImageHSVtoRGB(const IplImage *imageHSV)
 {
-    // Create a blank RGB image
-    IplImage *imageRGB = cvCreateImage(cvGetSize(imageHSV), 8, 3);
-    if (!imageRGB || imageHSV->depth != 8 || imageHSV->nChannels != 3) {
+    if (!imageHSV || imageHSV->depth != 8 || imageHSV->nChannels != 3) {
         LOG("ERROR in convertImageHSVtoRGB()! Bad input image.\n");
-        exit(1);
+        return NULL;
     }
+    // Create a blank RGB image
+    IplImage *imageRGB = cvCreateImage(cvGetSize(imageHSV), 8, 3);
 
     int h = imageHSV->height;                // Pixel height
     int w = imageHSV->width;                // Pixel width
@@ -1129,12 +1132,12 @@ IplImage* convertImageYIQtoRGB(const IplImage *imageYIQ)
     const float I_TO_FLOAT = -2.0f * MIN_I / 255.0f;
     const float Q_TO_FLOAT = -2.0f * MIN_Q / 255.0f;
 
-    // Create a blank RGB image
-    IplImage *imageRGB = cvCreateImage(cvGetSize(imageYIQ), 8, 3);
-    if (!imageRGB || imageYIQ->depth != 8 || imageYIQ->nChannels != 3) {
+    if (!imageYIQ || imageYIQ->depth != 8 || imageYIQ->nChannels != 3) {
         LOG("ERROR in convertImageYIQtoRGB()! Bad input image.\n");
-        exit(1);
+        return NULL;
     }
+    // Create a blank RGB image
+    IplImage *imageRGB = cvCreateImage(cvGetSize(imageYIQ), 8, 3);
 
     int h = imageYIQ->height;                // Pixel height
     int w = imageYIQ->width;                // Pixel width
@@ -1191,6 +1194,387 @@ IplImage* convertImageYIQtoRGB(const IplImage *imageYIQ)
     return imageRGB;
 }
 
+// Range of the I & Q components, since they are stored as 0 to 255 in the 8-bit YIQ images.
+static const float YIQ_MIN_I = -0.5957f;
+static const float YIQ_MIN_Q = -0.5226f;
+
+// Clip an integer pixel value to fit within 8 bits.
+static inline int clipPixel(int v)
+{
+    if (v > 255)
+        return 255;
+    if (v < 0)
+        return 0;
+    return v;
+}
+
+// Do the color conversion of a single pixel, from RGB to YIQ using an approximation of NTSC conversion(ref: "YIQ" Wikipedia page).
+// I & Q are shifted and scaled to be between 0 to 255, so that 'convertImageYIQtoRGB()' can convert them back.
+static inline void convertPixelRGBtoYIQ(int bR, int bG, int bB, int &bY, int &bI, int &bQ)
+{
+    const float BYTE_TO_FLOAT = 1.0f / 255.0f;
+    const float FLOAT_TO_Y = 255.0f;
+    const float FLOAT_TO_I = 255.0f / (-2.0f * YIQ_MIN_I);
+    const float FLOAT_TO_Q = 255.0f / (-2.0f * YIQ_MIN_Q);
+
+    // Convert from 8-bit integers to floats
+    float fR = bR * BYTE_TO_FLOAT;
+    float fG = bG * BYTE_TO_FLOAT;
+    float fB = bB * BYTE_TO_FLOAT;
+    // Convert from RGB to YIQ
+    // where R,G,B are 0-1, Y is 0-1, I is -0.5957 to +0.5957, Q is -0.5226 to +0.5226.
+    float fY = 0.299f * fR + 0.587f * fG + 0.114f * fB;
+    float fI = 0.5959f * fR - 0.2746f * fG - 0.3213f * fB;
+    float fQ = 0.2115f * fR - 0.5227f * fG + 0.3112f * fB;
+    // Convert from floats to 8-bit integers, and clip the values to make sure it fits within the 8bits
+    bY = clipPixel((int)(0.5f + fY * FLOAT_TO_Y));
+    bI = clipPixel((int)(0.5f + (fI - YIQ_MIN_I) * FLOAT_TO_I));
+    bQ = clipPixel((int)(0.5f + (fQ - YIQ_MIN_Q) * FLOAT_TO_Q));
+}
+
+// Do the color conversion of a single pixel, from 8-bit YIQ to RGB. Does exactly the same as each pixel of 'convertImageYIQtoRGB()'.
+static inline void convertPixelYIQtoRGB(int bY, int bI, int bQ, int &bR, int &bG, int &bB)
+{
+    const float FLOAT_TO_BYTE = 255.0f;
+    const float Y_TO_FLOAT = 1.0f / 255.0f;
+    const float I_TO_FLOAT = -2.0f * YIQ_MIN_I / 255.0f;
+    const float Q_TO_FLOAT = -2.0f * YIQ_MIN_Q / 255.0f;
+
+    // Convert from 8-bit integers to floats
+    float fY = (float)bY * Y_TO_FLOAT;
+    float fI = (float)bI * I_TO_FLOAT + YIQ_MIN_I;
+    float fQ = (float)bQ * Q_TO_FLOAT + YIQ_MIN_Q;
+    // Convert from YIQ to RGB
+    float fR =  fY  + 0.9563f * fI + 0.6210f * fQ;
+    float fG =  fY  - 0.2721f * fI - 0.6474f * fQ;
+    float fB =  fY  - 1.1070f * fI + 1.7046f * fQ;
+    // Convert from floats to 8-bit integers, and clip the values to make sure it fits within the 8bits
+    bR = clipPixel((int)(fR * FLOAT_TO_BYTE));
+    bG = clipPixel((int)(fG * FLOAT_TO_BYTE));
+    bB = clipPixel((int)(fB * FLOAT_TO_BYTE));
+}
+
+// Create a YIQ image from the RGB image using an approximation of NTSC conversion(ref: "YIQ" Wikipedia page).
+// Remember to free the generated YIQ image.
+IplImage* convertImageRGBtoYIQ(const IplImage *imageRGB)
+{
+    if (!imageRGB || imageRGB->depth != 8 || imageRGB->nChannels != 3) {
+        LOG("ERROR in convertImageRGBtoYIQ()! Bad input image.\n");
+        return NULL;
+    }
+    // Create a blank YIQ image
+    IplImage *imageYIQ = cvCreateImage(cvGetSize(imageRGB), 8, 3);
+
+    int h = imageRGB->height;                // Pixel height
+    int w = imageRGB->width;                // Pixel width
+    int rowSizeRGB = imageRGB->widthStep;    // Size of row in bytes, including extra padding
+    char *imRGB = imageRGB->imageData;        // Pointer to the start of the image pixels.
+    int rowSizeYIQ = imageYIQ->widthStep;    // Size of row in bytes, including extra padding
+    char *imYIQ = imageYIQ->imageData;        // Pointer to the start of the image pixels.
+    for (int y=0; y<h; y++) {
+        for (int x=0; x<w; x++) {
+            // Get the RGB pixel components. NOTE that OpenCV stores RGB pixels in B,G,R order.
+            uchar *pRGB = (uchar*)(imRGB + y*rowSizeRGB + x*3);
+            int bB = *(uchar*)(pRGB+0);    // Blue component
+            int bG = *(uchar*)(pRGB+1);    // Green component
+            int bR = *(uchar*)(pRGB+2);    // Red component
+
+            // Do the conversion.
+            int bY, bI, bQ;
+            convertPixelRGBtoYIQ(bR,bG,bB, bY,bI,bQ);
+
+            // Set the YIQ pixel components
+            uchar *pYIQ = (uchar*)(imYIQ + y*rowSizeYIQ + x*3);
+            *(pYIQ+0) = bY;        // Y component
+            *(pYIQ+1) = bI;        // I component
+            *(pYIQ+2) = bQ;        // Q component
+        }
+    }
+    return imageYIQ;
+}
+
+//------------------------------------------------------------------------------
+// cv::Mat color conversion functions
+//------------------------------------------------------------------------------
+
+#if CV_SSE2
+// Load 4 pixels of an 8-bit 3-channel image, as 3 vectors of floats (one vector per channel).
+static inline void loadPixels4(const uchar *p, __m128 &c0, __m128 &c1, __m128 &c2)
+{
+    c0 = _mm_setr_ps(p[0], p[3], p[6], p[9]);
+    c1 = _mm_setr_ps(p[1], p[4], p[7], p[10]);
+    c2 = _mm_setr_ps(p[2], p[5], p[8], p[11]);
+}
+
+// Store 4 pixels of an 8-bit 3-channel image from 3 vectors of floats. Each float is truncated like "(int)f"
+// and then saturated to 0..255, so it gives the same result as the clipping in the scalar code.
+static inline void storePixels4(uchar *p, __m128 c0, __m128 c1, __m128 c2)
+{
+    __m128i c01 = _mm_packs_epi32(_mm_cvttps_epi32(c0), _mm_cvttps_epi32(c1));
+    __m128i c22 = _mm_packs_epi32(_mm_cvttps_epi32(c2), _mm_cvttps_epi32(c2));
+    uchar b[16];
+    _mm_storeu_si128((__m128i*)b, _mm_packus_epi16(c01, c22));    // c0[0..3], c1[0..3], c2[0..3], c2[0..3]
+    for (int i=0; i<4; i++) {
+        p[i*3+0] = b[i];
+        p[i*3+1] = b[4+i];
+        p[i*3+2] = b[8+i];
+    }
+}
+#endif
+
+// Convert a row of RGB pixels to HSV with Hues between 0 to 255, giving the same values as 'convertPixelRGBtoHSV_256()'.
+static void convertRowRGBtoHSV_256(const uchar *pRGB, uchar *pHSV, int width)
+{
+    int x = 0;
+#if CV_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 six = _mm_set1_ps(6.0f);
+    const __m128 allBits = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    const __m128 byteToFloat = _mm_set1_ps(1.0f / 255.0f);
+    const __m128 floatToByte = _mm_set1_ps(255.0f);
+    for (; x <= width - 4; x += 4) {
+        // NOTE that OpenCV stores RGB pixels in B,G,R order.
+        __m128 fB, fG, fR;
+        loadPixels4(pRGB + x*3, fB, fG, fR);
+        fB = _mm_mul_ps(fB, byteToFloat);
+        fG = _mm_mul_ps(fG, byteToFloat);
+        fR = _mm_mul_ps(fR, byteToFloat);
+
+        __m128 fMax = _mm_max_ps(fR, _mm_max_ps(fG, fB));
+        __m128 fMin = _mm_min_ps(fR, _mm_min_ps(fG, fB));
+        __m128 fDelta = _mm_sub_ps(fMax, fMin);
+        __m128 angleToUnit = _mm_div_ps(one, _mm_mul_ps(six, fDelta));    // Infinite for grey pixels, but they are masked out below.
+
+        // Calculate the Hue for all 3 cases and then choose one per pixel, preferring R then G then B like the scalar code.
+        __m128 hR = _mm_mul_ps(_mm_sub_ps(fG, fB), angleToUnit);
+        __m128 hG = _mm_add_ps(_mm_set1_ps(2.0f/6.0f), _mm_mul_ps(_mm_sub_ps(fB, fR), angleToUnit));
+        __m128 hB = _mm_add_ps(_mm_set1_ps(4.0f/6.0f), _mm_mul_ps(_mm_sub_ps(fR, fG), angleToUnit));
+        __m128 isR = _mm_cmpeq_ps(fMax, fR);
+        __m128 isG = _mm_andnot_ps(isR, _mm_cmpeq_ps(fMax, fG));
+        __m128 isB = _mm_andnot_ps(_mm_or_ps(isR, isG), allBits);
+        __m128 fH = _mm_or_ps(_mm_and_ps(isR, hR), _mm_or_ps(_mm_and_ps(isG, hG), _mm_and_ps(isB, hB)));
+        // Wrap outlier Hues around the circle.
+        fH = _mm_add_ps(fH, _mm_and_ps(_mm_cmplt_ps(fH, zero), one));
+        fH = _mm_sub_ps(fH, _mm_and_ps(_mm_cmpge_ps(fH, one), one));
+        // Grey and pure black pixels have an undefined hue of 0, and black pixels have a saturation of 0.
+        fH = _mm_and_ps(fH, _mm_cmpgt_ps(fDelta, zero));
+        __m128 fS = _mm_and_ps(_mm_div_ps(fDelta, fMax), _mm_cmpgt_ps(fMax, zero));
+
+        // Convert from floats to 8-bit integers, rounding to the nearest integer.
+        storePixels4(pHSV + x*3, _mm_add_ps(half, _mm_mul_ps(fH, floatToByte)),
+                                 _mm_add_ps(half, _mm_mul_ps(fS, floatToByte)),
+                                 _mm_add_ps(half, _mm_mul_ps(fMax, floatToByte)));
+    }
+#endif
+    // Do the remaining pixels one at a time.
+    for (; x < width; x++) {
+        const uchar *p = pRGB + x*3;
+        int bH, bS, bV;
+        convertPixelRGBtoHSV_256(p[2], p[1], p[0], bH, bS, bV);
+        pHSV[x*3+0] = bH;
+        pHSV[x*3+1] = bS;
+        pHSV[x*3+2] = bV;
+    }
+}
+
+// Convert a row of HSV pixels with Hues between 0 to 255 to RGB, giving the same values as 'convertPixelHSVtoRGB_256()'.
+static void convertRowHSVtoRGB_256(const uchar *pHSV, uchar *pRGB, int width)
+{
+    int x = 0;
+#if CV_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 six = _mm_set1_ps(6.0f);
+    const __m128 allBits = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    const __m128 byteToFloat = _mm_set1_ps(1.0f / 255.0f);
+    const __m128 floatToByte = _mm_set1_ps(255.0f);
+    for (; x <= width - 4; x += 4) {
+        __m128 fH, fS, fV;
+        loadPixels4(pHSV + x*3, fH, fS, fV);
+        fH = _mm_mul_ps(fH, byteToFloat);
+        fS = _mm_mul_ps(fS, byteToFloat);
+        fV = _mm_mul_ps(fV, byteToFloat);
+
+        // If Hue == 1.0, then wrap it around the circle to 0.0
+        fH = _mm_andnot_ps(_mm_cmpge_ps(fH, one), fH);
+        fH = _mm_mul_ps(fH, six);               // sector 0 to 5
+        __m128i iI = _mm_cvttps_epi32(fH);      // integer part of h, since h is never negative.
+        __m128 fF = _mm_sub_ps(fH, _mm_cvtepi32_ps(iI));    // factorial part of h (0 to 1)
+
+        __m128 p = _mm_mul_ps(fV, _mm_sub_ps(one, fS));
+        __m128 q = _mm_mul_ps(fV, _mm_sub_ps(one, _mm_mul_ps(fS, fF)));
+        __m128 t = _mm_mul_ps(fV, _mm_sub_ps(one, _mm_mul_ps(fS, _mm_sub_ps(one, fF))));
+
+        // Choose the sector of each pixel, where sector 5 (or 6) is the default case.
+        __m128 s0 = _mm_castsi128_ps(_mm_cmpeq_epi32(iI, _mm_set1_epi32(0)));
+        __m128 s1 = _mm_castsi128_ps(_mm_cmpeq_epi32(iI, _mm_set1_epi32(1)));
+        __m128 s2 = _mm_castsi128_ps(_mm_cmpeq_epi32(iI, _mm_set1_epi32(2)));
+        __m128 s3 = _mm_castsi128_ps(_mm_cmpeq_epi32(iI, _mm_set1_epi32(3)));
+        __m128 s4 = _mm_castsi128_ps(_mm_cmpeq_epi32(iI, _mm_set1_epi32(4)));
+        __m128 s5 = _mm_andnot_ps(_mm_or_ps(_mm_or_ps(s0, s1), _mm_or_ps(_mm_or_ps(s2, s3), s4)), allBits);
+
+        __m128 fR = _mm_or_ps(_mm_or_ps(_mm_and_ps(_mm_or_ps(s0, s5), fV), _mm_and_ps(s1, q)),
+                              _mm_or_ps(_mm_and_ps(_mm_or_ps(s2, s3), p), _mm_and_ps(s4, t)));
+        __m128 fG = _mm_or_ps(_mm_or_ps(_mm_and_ps(s0, t), _mm_and_ps(_mm_or_ps(s1, s2), fV)),
+                              _mm_or_ps(_mm_and_ps(s3, q), _mm_and_ps(_mm_or_ps(s4, s5), p)));
+        __m128 fB = _mm_or_ps(_mm_or_ps(_mm_and_ps(_mm_or_ps(s0, s1), p), _mm_and_ps(s2, t)),
+                              _mm_or_ps(_mm_and_ps(_mm_or_ps(s3, s4), fV), _mm_and_ps(s5, q)));
+
+        // Achromatic (grey) pixels just use the Value.
+        __m128 grey = _mm_cmpeq_ps(fS, zero);
+        fR = _mm_or_ps(_mm_and_ps(grey, fV), _mm_andnot_ps(grey, fR));
+        fG = _mm_or_ps(_mm_and_ps(grey, fV), _mm_andnot_ps(grey, fG));
+        fB = _mm_or_ps(_mm_and_ps(grey, fV), _mm_andnot_ps(grey, fB));
+
+        // Convert from floats to 8-bit integers. NOTE that OpenCV stores RGB pixels in B,G,R order.
+        storePixels4(pRGB + x*3, _mm_mul_ps(fB, floatToByte), _mm_mul_ps(fG, floatToByte), _mm_mul_ps(fR, floatToByte));
+    }
+#endif
+    // Do the remaining pixels one at a time.
+    for (; x < width; x++) {
+        const uchar *p = pHSV + x*3;
+        int bR, bG, bB;
+        convertPixelHSVtoRGB_256(p[0], p[1], p[2], bR, bG, bB);
+        pRGB[x*3+0] = bB;
+        pRGB[x*3+1] = bG;
+        pRGB[x*3+2] = bR;
+    }
+}
+
+// Convert a row of RGB pixels to 8-bit YIQ, giving the same values as 'convertPixelRGBtoYIQ()'.
+static void convertRowRGBtoYIQ(const uchar *pRGB, uchar *pYIQ, int width)
+{
+    int x = 0;
+#if CV_SSE2
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 byteToFloat = _mm_set1_ps(1.0f / 255.0f);
+    const __m128 floatToY = _mm_set1_ps(255.0f);
+    const __m128 floatToI = _mm_set1_ps(255.0f / (-2.0f * YIQ_MIN_I));
+    const __m128 floatToQ = _mm_set1_ps(255.0f / (-2.0f * YIQ_MIN_Q));
+    const __m128 minI = _mm_set1_ps(YIQ_MIN_I);
+    const __m128 minQ = _mm_set1_ps(YIQ_MIN_Q);
+    for (; x <= width - 4; x += 4) {
+        __m128 fB, fG, fR;
+        loadPixels4(pRGB + x*3, fB, fG, fR);
+        fB = _mm_mul_ps(fB, byteToFloat);
+        fG = _mm_mul_ps(fG, byteToFloat);
+        fR = _mm_mul_ps(fR, byteToFloat);
+
+        __m128 fY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.299f), fR), _mm_mul_ps(_mm_set1_ps(0.587f), fG)), _mm_mul_ps(_mm_set1_ps(0.114f), fB));
+        __m128 fI = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(0.5959f), fR), _mm_mul_ps(_mm_set1_ps(0.2746f), fG)), _mm_mul_ps(_mm_set1_ps(0.3213f), fB));
+        __m128 fQ = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(0.2115f), fR), _mm_mul_ps(_mm_set1_ps(0.5227f), fG)), _mm_mul_ps(_mm_set1_ps(0.3112f), fB));
+
+        storePixels4(pYIQ + x*3, _mm_add_ps(half, _mm_mul_ps(fY, floatToY)),
+                                 _mm_add_ps(half, _mm_mul_ps(_mm_sub_ps(fI, minI), floatToI)),
+                                 _mm_add_ps(half, _mm_mul_ps(_mm_sub_ps(fQ, minQ), floatToQ)));
+    }
+#endif
+    // Do the remaining pixels one at a time.
+    for (; x < width; x++) {
+        const uchar *p = pRGB + x*3;
+        int bY, bI, bQ;
+        convertPixelRGBtoYIQ(p[2], p[1], p[0], bY, bI, bQ);
+        pYIQ[x*3+0] = bY;
+        pYIQ[x*3+1] = bI;
+        pYIQ[x*3+2] = bQ;
+    }
+}
+
+// Convert a row of 8-bit YIQ pixels to RGB, giving the same values as 'convertImageYIQtoRGB()'.
+static void convertRowYIQtoRGB(const uchar *pYIQ, uchar *pRGB, int width)
+{
+    int x = 0;
+#if CV_SSE2
+    const __m128 yToFloat = _mm_set1_ps(1.0f / 255.0f);
+    const __m128 iToFloat = _mm_set1_ps(-2.0f * YIQ_MIN_I / 255.0f);
+    const __m128 qToFloat = _mm_set1_ps(-2.0f * YIQ_MIN_Q / 255.0f);
+    const __m128 minI = _mm_set1_ps(YIQ_MIN_I);
+    const __m128 minQ = _mm_set1_ps(YIQ_MIN_Q);
+    const __m128 floatToByte = _mm_set1_ps(255.0f);
+    for (; x <= width - 4; x += 4) {
+        __m128 fY, fI, fQ;
+        loadPixels4(pYIQ + x*3, fY, fI, fQ);
+        fY = _mm_mul_ps(fY, yToFloat);
+        fI = _mm_add_ps(_mm_mul_ps(fI, iToFloat), minI);
+        fQ = _mm_add_ps(_mm_mul_ps(fQ, qToFloat), minQ);
+
+        __m128 fR = _mm_add_ps(_mm_add_ps(fY, _mm_mul_ps(_mm_set1_ps(0.9563f), fI)), _mm_mul_ps(_mm_set1_ps(0.6210f), fQ));
+        __m128 fG = _mm_sub_ps(_mm_sub_ps(fY, _mm_mul_ps(_mm_set1_ps(0.2721f), fI)), _mm_mul_ps(_mm_set1_ps(0.6474f), fQ));
+        __m128 fB = _mm_add_ps(_mm_sub_ps(fY, _mm_mul_ps(_mm_set1_ps(1.1070f), fI)), _mm_mul_ps(_mm_set1_ps(1.7046f), fQ));
+
+        // NOTE that OpenCV stores RGB pixels in B,G,R order.
+        storePixels4(pRGB + x*3, _mm_mul_ps(fB, floatToByte), _mm_mul_ps(fG, floatToByte), _mm_mul_ps(fR, floatToByte));
+    }
+#endif
+    // Do the remaining pixels one at a time.
+    for (; x < width; x++) {
+        const uchar *p = pYIQ + x*3;
+        int bR, bG, bB;
+        convertPixelYIQtoRGB(p[0], p[1], p[2], bR, bG, bB);
+        pRGB[x*3+0] = bB;
+        pRGB[x*3+1] = bG;
+        pRGB[x*3+2] = bR;
+    }
+}
+
+typedef void (*ConvertRowFunc)(const uchar *src, uchar *dst, int width);
+
+// Runs a row conversion function on a range of rows, so that cv::parallel_for_ can split the image across threads.
+class ConvertRowsBody : public cv::ParallelLoopBody
+{
+public:
+    ConvertRowsBody(const cv::Mat &src, cv::Mat &dst, ConvertRowFunc convertRow) : m_src(src), m_dst(dst), m_convertRow(convertRow) {}
+
+    virtual void operator()(const cv::Range &rows) const
+    {
+        for (int y = rows.start; y < rows.end; y++)
+            m_convertRow(m_src.ptr<uchar>(y), m_dst.ptr<uchar>(y), m_src.cols);
+    }
+
+private:
+    const cv::Mat &m_src;
+    cv::Mat &m_dst;
+    ConvertRowFunc m_convertRow;
+};
+
+// Check the input image and allocate the output image (if needed), then convert all the rows in parallel.
+static bool convertImageRows(const cv::Mat &src, cv::Mat &dst, ConvertRowFunc convertRow, const char *funcName)
+{
+    if (src.empty() || src.type() != CV_8UC3) {
+        LOG("ERROR in %s()! Bad input image.", funcName);
+        return false;
+    }
+    dst.create(src.size(), CV_8UC3);
+    cv::parallel_for_(cv::Range(0, src.rows), ConvertRowsBody(src, dst, convertRow));
+    return true;
+}
+
+// Create a HSV image from the RGB image using the full 8-bits, since OpenCV only allows Hues up to 180 instead of 255.
+bool convertImageRGBtoHSV(const cv::Mat &imageRGB, cv::Mat &imageHSV)
+{
+    return convertImageRows(imageRGB, imageHSV, convertRowRGBtoHSV_256, "convertImageRGBtoHSV");
+}
+
+// Create an RGB image from the HSV image using the full 8-bits, since OpenCV only allows Hues up to 180 instead of 255.
+bool convertImageHSVtoRGB(const cv::Mat &imageHSV, cv::Mat &imageRGB)
+{
+    return convertImageRows(imageHSV, imageRGB, convertRowHSVtoRGB_256, "convertImageHSVtoRGB");
+}
+
+// Create a YIQ image from the RGB image using an approximation of NTSC conversion(ref: "YIQ" Wikipedia page).
+bool convertImageRGBtoYIQ(const cv::Mat &imageRGB, cv::Mat &imageYIQ)
+{
+    return convertImageRows(imageRGB, imageYIQ, convertRowRGBtoYIQ, "convertImageRGBtoYIQ");
+}
+
+// Create an RGB image from the YIQ image using an approximation of NTSC conversion(ref: "YIQ" Wikipedia page).
+bool convertImageYIQtoRGB(const cv::Mat &imageYIQ, cv::Mat &imageRGB)
+{
+    return convertImageRows(imageYIQ, imageRGB, convertRowYIQtoRGB, "convertImageYIQtoRGB");
+}
+
 //------------------------------------------------------------------------------
 // 2D Point functions
 //------------------------------------------------------------------------------
@@ -2026,6 +2410,107 @@ IplImage* blendImage(const IplImage* image1, const IplImage* image2, const IplIm
     return imageBlended;
 }
 
+// Blend one row of 'n' bytes (3 per pixel) of image1 and image2, where 'mask3' has the alpha mask value repeated for each of the 3 channels.
+// Gives exactly the same values as the loop in 'blendImage()' above.
+static void blendRow(const uchar *p1, const uchar *p2, const uchar *mask3, uchar *pBlended, int n)
+{
+    int i = 0;
+#if CV_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i v1 = _mm_set1_epi16(1);
+    const __m128i v255 = _mm_set1_epi16(255);
+    for (; i <= n - 16; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(p1 + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(p2 + i));
+        __m128i m = _mm_loadu_si128((const __m128i*)(mask3 + i));
+
+        // "(pixel * f) >> 8" is the same as the high 16 bits of "(pixel << 8) * f", since both fit in 16 bits.
+        // Unpacking with zero as the low byte gives "pixel << 8" directly.
+        __m128i mLo = _mm_unpacklo_epi8(m, zero);
+        __m128i mHi = _mm_unpackhi_epi8(m, zero);
+        __m128i part2Lo = _mm_mulhi_epu16(_mm_unpacklo_epi8(zero, b), _mm_add_epi16(mLo, v1));
+        __m128i part2Hi = _mm_mulhi_epu16(_mm_unpackhi_epi8(zero, b), _mm_add_epi16(mHi, v1));
+        __m128i part1Lo = _mm_mulhi_epu16(_mm_unpacklo_epi8(zero, a), _mm_sub_epi16(v255, mLo));
+        __m128i part1Hi = _mm_mulhi_epu16(_mm_unpackhi_epi8(zero, a), _mm_sub_epi16(v255, mHi));
+        __m128i blended = _mm_packus_epi16(_mm_add_epi16(part1Lo, part2Lo), _mm_add_epi16(part1Hi, part2Hi));
+
+        // If the alpha mask was 0, then just use image1 and not image2.
+        __m128i useImage1 = _mm_cmpeq_epi8(m, zero);
+        blended = _mm_or_si128(_mm_and_si128(useImage1, a), _mm_andnot_si128(useImage1, blended));
+        _mm_storeu_si128((__m128i*)(pBlended + i), blended);
+    }
+#endif
+    // Do the remaining bytes one at a time.
+    for (; i < n; i++) {
+        int m = mask3[i];
+        if (m)
+            pBlended[i] = ((p1[i] * (255 - m)) >> 8) + ((p2[i] * (m + 1)) >> 8);
+        else
+            pBlended[i] = p1[i];
+    }
+}
+
+// Blends a range of rows, so that cv::parallel_for_ can split the image across threads.
+class BlendRowsBody : public cv::ParallelLoopBody
+{
+public:
+    BlendRowsBody(const cv::Mat &image1, const cv::Mat &image2, const cv::Mat &imageAlphaMask, cv::Mat &imageBlended)
+        : m_image1(image1), m_image2(image2), m_mask(imageAlphaMask), m_blended(imageBlended) {}
+
+    virtual void operator()(const cv::Range &rows) const
+    {
+        int width = m_image1.cols;
+        // Spread each alpha mask value to all 3 channels, so that the blend can work on 16 bytes at a time.
+        cv::AutoBuffer<uchar> mask3(width * 3);
+        for (int y = rows.start; y < rows.end; y++) {
+            const uchar *pM = m_mask.ptr<uchar>(y);
+            for (int x=0; x < width; x++) {
+                mask3[x*3+0] = pM[x];
+                mask3[x*3+1] = pM[x];
+                mask3[x*3+2] = pM[x];
+            }
+            blendRow(m_image1.ptr<uchar>(y), m_image2.ptr<uchar>(y), mask3, m_blended.ptr<uchar>(y), width * 3);
+        }
+    }
+
+private:
+    const cv::Mat &m_image1;
+    const cv::Mat &m_image2;
+    const cv::Mat &m_mask;
+    cv::Mat &m_blended;
+};
+
+// Blend color images 'image1' and 'image2' using an 8-bit alpha-blending mask channel, into 'imageBlended'.
+// Same as the IplImage version of 'blendImage()', but 'imageBlended' is only allocated if it isn't already the right size & type,
+// so it can be reused for every frame (or be 'image1' itself).
+bool blendImage(const cv::Mat &image1, const cv::Mat &image2, const cv::Mat &imageAlphaMask, cv::Mat &imageBlended, bool useThreads)
+{
+    // Make sure that image1 & image2 are RGB UCHAR images, and imageAlphaMask is an 8-bit UCHAR image, all with the same dimensions.
+    if (image1.empty() || image1.type() != CV_8UC3) {
+        std::cout << "Error in blendImage(): Bad parameter 'image1'." << std::endl;
+        printMatInfo(image1, "image1");
+        return false;
+    }
+    if (image2.type() != CV_8UC3 || image2.size() != image1.size()) {
+        std::cout << "Error in blendImage(): Bad parameter 'image2'." << std::endl;
+        printMatInfo(image2, "image2");
+        return false;
+    }
+    if (imageAlphaMask.type() != CV_8UC1 || imageAlphaMask.size() != image1.size()) {
+        std::cout << "Error in blendImage(): Bad parameter 'imageAlphaMask'." << std::endl;
+        printMatInfo(imageAlphaMask, "imageAlphaMask");
+        return false;
+    }
+
+    imageBlended.create(image1.size(), CV_8UC3);
+    BlendRowsBody body(image1, image2, imageAlphaMask, imageBlended);
+    if (useThreads)
+        cv::parallel_for_(cv::Range(0, image1.rows), body);
+    else
+        body(cv::Range(0, image1.rows));
+    return true;
+}
+
 
 // Save the given image to a JPG or BMP file, even if its format isn't an 8-bit image, such as a 32bit float image.
 int saveImage(const char *filename, const IplImage *image)
@@ -0,0 +1,238 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const int LOG_BUFFER_ENTRIES = 256;     // Mensagens que cada thread pode ter esperando para serem escritas. Deve ser uma potência de 2.
+const int LOG_ENTRY_SIZE = 240;         // Tamanho máximo de uma mensagem (as maiores são cortadas).
+const int LOG_DRAIN_INTERVAL_MS = 20;   // A cada quanto tempo a thread em segundo plano escreve as mensagens.
+
+
+#include "asyncLog.h"       // Log assíncrono com um buffer sem locks por thread.
+
+#include <stdarg.h>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+using namespace std;
+
+
+namespace {
+
+const char* LEVEL_NAMES[] = {"DEBUG", "INFO", "WARNING", "ERROR", "NONE"};
+
+struct LogEntry
+{
+    int64_t timeMs;
+    LogLevel level;
+    int threadNumber;
+    char text[LOG_ENTRY_SIZE];
+};
+
+// Buffer circular de uma thread: só a thread dona escreve 'head', e só quem está esvaziando o buffer escreve 'tail'.
+struct ThreadBuffer
+{
+    LogEntry entries[LOG_BUFFER_ENTRIES];
+    atomic<unsigned> head;
+    atomic<unsigned> tail;
+    atomic<int> dropped;
+    int threadNumber;
+
+    ThreadBuffer(int number) : head(0), tail(0), dropped(0), threadNumber(number) {}
+};
+
+int64_t getLogTimeMs()
+{
+    static const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+}
+
+bool compareEntryTime(const LogEntry *a, const LogEntry *b)
+{
+    return a->timeMs < b->timeMs;
+}
+
+class AsyncLogger
+{
+public:
+    AsyncLogger() : m_level(LOG_LEVEL_INFO), m_running(true), m_threadCount(0)
+    {
+        getLogTimeMs();
+        m_thread = thread(&AsyncLogger::run, this);
+    }
+
+    ~AsyncLogger()
+    {
+        m_running = false;
+        m_wakeup.notify_one();
+        m_thread.join();
+        drain();
+    }
+
+    atomic<int> m_level;
+
+    // Retorna o buffer da thread atual, criando-o na primeira mensagem da thread. Só essa primeira vez usa um lock.
+    ThreadBuffer *getThreadBuffer()
+    {
+        thread_local shared_ptr<ThreadBuffer> buffer;
+        if (!buffer) {
+            buffer = make_shared<ThreadBuffer>(++m_threadCount);
+            lock_guard<mutex> lock(m_buffersMutex);
+            m_buffers.push_back(buffer);
+        }
+        return buffer.get();
+    }
+
+    void wakeup()
+    {
+        m_wakeup.notify_one();
+    }
+
+    // Escreve as mensagens de todas as threads, em ordem de tempo. Pode ser chamado pela thread em segundo plano ou por flushLog().
+    void drain()
+    {
+        lock_guard<mutex> drainLock(m_drainMutex);
+        {
+            lock_guard<mutex> lock(m_buffersMutex);
+            m_drainBuffers = m_buffers;
+        }
+
+        m_batch.clear();
+        m_batchEnds.clear();
+        for (size_t i = 0; i < m_drainBuffers.size(); i++) {
+            ThreadBuffer *b = m_drainBuffers[i].get();
+            unsigned tail = b->tail.load(memory_order_relaxed);
+            unsigned head = b->head.load(memory_order_acquire);
+            for (unsigned j = tail; j != head; j++)
+                m_batch.push_back(&b->entries[j & (LOG_BUFFER_ENTRIES - 1)]);
+            m_batchEnds.push_back(head);
+        }
+        stable_sort(m_batch.begin(), m_batch.end(), compareEntryTime);
+
+        for (size_t i = 0; i < m_batch.size(); i++) {
+            const LogEntry *e = m_batch[i];
+            fprintf(stdout, "[%8.3fs] [%s] [thread %d] %s\n", e->timeMs * 0.001, LEVEL_NAMES[e->level], e->threadNumber, e->text);
+        }
+
+        // Só libera as posições dos buffers depois de escrever as mensagens.
+        for (size_t i = 0; i < m_drainBuffers.size(); i++) {
+            ThreadBuffer *b = m_drainBuffers[i].get();
+            b->tail.store(m_batchEnds[i], memory_order_release);
+            int dropped = b->dropped.exchange(0);
+            if (dropped > 0)
+                fprintf(stdout, "[%8.3fs] [WARNING] [thread %d] %d log messages were dropped because the log buffer was full.\n", getLogTimeMs() * 0.001, b->threadNumber, dropped);
+        }
+        if (!m_batch.empty())
+            fflush(stdout);
+        m_drainBuffers.clear();
+
+        // Remove os buffers das threads que já terminaram (só 'm_buffers' ainda os referencia) e que não têm mais nada para escrever.
+        // Sem isso, cada thread que já escreveu no log (por exemplo uma por treinamento) deixaria o seu buffer para sempre.
+        lock_guard<mutex> lock(m_buffersMutex);
+        for (size_t i = 0; i < m_buffers.size(); ) {
+            ThreadBuffer *b = m_buffers[i].get();
+            if (m_buffers[i].use_count() == 1 && b->head.load(memory_order_acquire) == b->tail.load(memory_order_relaxed) && b->dropped.load() == 0) {
+                m_buffers[i] = m_buffers.back();
+                m_buffers.pop_back();
+            }
+            else {
+                i++;
+            }
+        }
+    }
+
+private:
+    void run()
+    {
+        while (m_running) {
+            {
+                unique_lock<mutex> lock(m_wakeupMutex);
+                m_wakeup.wait_for(lock, chrono::milliseconds(LOG_DRAIN_INTERVAL_MS));
+            }
+            drain();
+        }
+    }
+
+    atomic<bool> m_running;
+    atomic<int> m_threadCount;
+    thread m_thread;
+    mutex m_wakeupMutex;
+    condition_variable m_wakeup;
+    mutex m_buffersMutex;
+    vector<shared_ptr<ThreadBuffer> > m_buffers;
+    mutex m_drainMutex;
+    vector<shared_ptr<ThreadBuffer> > m_drainBuffers;     // Cópia de 'm_buffers' usada ao esvaziar, para não segurar o lock enquanto escreve.
+    vector<const LogEntry*> m_batch;
+    vector<unsigned> m_batchEnds;
+};
+
+AsyncLogger &getLogger()
+{
+    static AsyncLogger logger;
+    return logger;
+}
+
+} // namespace
+
+
+void setLogLevel(LogLevel level)
+{
+    getLogger().m_level = level;
+}
+
+bool isLogLevelEnabled(LogLevel level)
+{
+    return level >= getLogger().m_level.load(memory_order_relaxed);
+}
+
+void asyncLog(LogLevel level, const char *fmt, ...)
+{
+    if (level < LOG_LEVEL_DEBUG || level >= LOG_LEVEL_NONE)
+        return;
+    AsyncLogger &logger = getLogger();
+    ThreadBuffer *b = logger.getThreadBuffer();
+
+    unsigned head = b->head.load(memory_order_relaxed);
+    unsigned tail = b->tail.load(memory_order_acquire);
+    if (head - tail >= (unsigned)LOG_BUFFER_ENTRIES) {
+        // O buffer está cheio: descarta a mensagem em vez de esperar.
+        b->dropped++;
+        return;
+    }
+
+    LogEntry &e = b->entries[head & (LOG_BUFFER_ENTRIES - 1)];
+    e.timeMs = getLogTimeMs();
+    e.level = level;
+    e.threadNumber = b->threadNumber;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(e.text, LOG_ENTRY_SIZE, fmt, args);
+    va_end(args);
+    b->head.store(head + 1, memory_order_release);
+
+    // Os erros são escritos logo, sem esperar o próximo intervalo.
+    if (level >= LOG_LEVEL_ERROR)
+        logger.wakeup();
+}
+
+void flushLog()
+{
+    getLogger().drain();
+}
+
+bool shouldLogRateLimited(atomic<int64_t> &lastTime, atomic<int> &suppressed, int intervalMs, int *suppressedCount)
+{
+    int64_t now = getLogTimeMs();
+    int64_t last = lastTime.load(memory_order_relaxed);
+    // A primeira mensagem sempre é escrita.
+    if ((last != 0 && now - last < intervalMs) || !lastTime.compare_exchange_strong(last, max(now, (int64_t)1))) {
+        suppressed++;
+        return false;
+    }
+    *suppressedCount = suppressed.exchange(0);
+    return true;
+}
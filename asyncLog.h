@@ -0,0 +1,42 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <atomic>
+#include <stdint.h>
+
+
+// Log assíncrono para as partes do programa que rodam a cada frame (captura, detecção e reconhecimento).
+// Cada thread escreve suas mensagens em seu próprio buffer circular sem locks, e uma thread em segundo plano as escreve no stdout.
+// Se o buffer de uma thread estiver cheio, a mensagem é descartada (e contada) em vez de bloquear a thread.
+enum LogLevel {LOG_LEVEL_DEBUG=0, LOG_LEVEL_INFO, LOG_LEVEL_WARNING, LOG_LEVEL_ERROR, LOG_LEVEL_NONE};
+
+// Mensagens com nível abaixo deste são ignoradas (sem nem formatar o texto). O padrão é LOG_LEVEL_INFO.
+void setLogLevel(LogLevel level);
+bool isLogLevelEnabled(LogLevel level);
+
+// Formata a mensagem (como printf) e a coloca no buffer da thread atual. Normalmente é usado através das macros ALOG abaixo.
+void asyncLog(LogLevel level, const char *fmt, ...);
+
+// Espera até que todas as mensagens já enviadas tenham sido escritas. Use antes de sair do programa ou de escrever com cout.
+void flushLog();
+
+// Retorna true no máximo uma vez a cada 'intervalMs' milissegundos para cada 'lastTime', contando as chamadas puladas em 'suppressed'.
+bool shouldLogRateLimited(std::atomic<int64_t> &lastTime, std::atomic<int> &suppressed, int intervalMs, int *suppressedCount);
+
+
+#define ALOG(level, fmt, ...)   do {    if (isLogLevelEnabled(level)) asyncLog(level, fmt, ##__VA_ARGS__);    } while (0)
+
+// Para as mensagens de cada frame: escreve no máximo uma mensagem a cada 'intervalMs' milissegundos deste ponto do código,
+// mostrando quantas mensagens foram puladas desde a anterior.
+#define ALOG_EVERY_MS(intervalMs, level, fmt, ...)   do {    \
+        static std::atomic<int64_t> alogLastTime_(0);   \
+        static std::atomic<int> alogSuppressed_(0);     \
+        int alogSkipped_;   \
+        if (isLogLevelEnabled(level) && shouldLogRateLimited(alogLastTime_, alogSuppressed_, intervalMs, &alogSkipped_))  {  \
+            if (alogSkipped_ > 0)   \
+                asyncLog(level, fmt " (%d similar messages skipped)", ##__VA_ARGS__, alogSkipped_);    \
+            else    \
+                asyncLog(level, fmt, ##__VA_ARGS__);    \
+        }   \
+    } while (0)
@@ -0,0 +1,251 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+// Benchmark das funções do ImageUtils: compara as funções antigas (IplImage, um pixel por vez) com as novas versões cv::Mat
+// (SSE2 + cv::parallel_for_) usando frames de 1080p, e verifica se os resultados são iguais.
+// Funções medidas: conversões de cor HSV/YIQ, blendImage(), recorte + redimensionamento de rostos e o mosaico (combineImagesResized() vs MosaicBuilder).
+// Uso: benchImageUtils [imagem.jpg] [repeticoes]
+
+const int BENCH_WIDTH = 1920;
+const int BENCH_HEIGHT = 1080;
+const int DEFAULT_REPETITIONS = 20;
+
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <iostream>
+
+
+#include "opencv2/opencv.hpp"
+
+
+#include "mosaic.h"
+
+#include "ImageUtils.h"
+
+using namespace cv;
+using namespace std;
+
+
+typedef IplImage* (*LegacyConverter)(const IplImage *src);
+typedef bool (*MatConverter)(const Mat &src, Mat &dst);
+
+
+// Mostra quantos valores são diferentes entre o resultado antigo e o novo, e a maior diferença entre eles.
+void compareResults(const Mat &legacyResult, const Mat &matResult, const char *name)
+{
+    Mat diff;
+    absdiff(legacyResult, matResult, diff);
+    diff = diff.reshape(1);
+    double maxDiff = 0;
+    minMaxLoc(diff, 0, &maxDiff);
+    LOG("%s: %d of %d values are different (max difference = %d).", name, countNonZero(diff), (int)diff.total(), cvRound(maxDiff));
+}
+
+// Mede o tempo da função antiga (que aloca uma nova imagem por chamada) e da nova (que reutiliza a imagem de saída).
+void benchmarkConverter(const char *name, LegacyConverter legacyFunc, MatConverter matFunc, const Mat &input, int repetitions)
+{
+    IplImage iplInput = input;
+    IplImage *legacyOutput = 0;
+    Mat matOutput;
+
+    DECLARE_TIMING(legacy);
+    for (int i=0; i<repetitions; i++) {
+        if (legacyOutput)
+            cvReleaseImage(&legacyOutput);
+        START_TIMING(legacy);
+        legacyOutput = legacyFunc(&iplInput);
+        STOP_TIMING(legacy);
+    }
+
+    // Uma chamada de aquecimento, para que a imagem de saída seja alocada antes da medição.
+    matFunc(input, matOutput);
+    DECLARE_TIMING(mat);
+    for (int i=0; i<repetitions; i++) {
+        START_TIMING(mat);
+        matFunc(input, matOutput);
+        STOP_TIMING(mat);
+    }
+
+    LOG("%s (%dx%d): IplImage ave=%.2fms min=%.2fms, cv::Mat ave=%.2fms min=%.2fms, speedup = %.1fx", name, input.cols, input.rows,
+        GET_AVERAGE_TIMING(legacy), GET_MIN_TIMING(legacy), GET_AVERAGE_TIMING(mat), GET_MIN_TIMING(mat),
+        GET_AVERAGE_TIMING(legacy) / MAX(GET_AVERAGE_TIMING(mat), 1e-6));
+
+    if (legacyOutput) {
+        compareResults(Mat(legacyOutput), matOutput, name);
+        cvReleaseImage(&legacyOutput);
+    }
+}
+
+// Mede o tempo da mistura (alpha-blending) antiga, e da nova com e sem threads, usando uma máscara com bordas suaves.
+void benchmarkBlend(const Mat &frame, int repetitions)
+{
+    Mat overlay = Mat(frame.size(), CV_8UC3, Scalar(40, 200, 255));
+    Mat mask = Mat(frame.size(), CV_8UC1, Scalar(0));
+    ellipse(mask, Point(frame.cols/2, frame.rows/2), Size(frame.cols/3, frame.rows/3), 0, 0, 360, Scalar(255), CV_FILLED);
+    GaussianBlur(mask, mask, Size(51, 51), 0);
+    IplImage iplFrame = frame;
+    IplImage iplOverlay = overlay;
+    IplImage iplMask = mask;
+
+    IplImage *legacyOutput = 0;
+    DECLARE_TIMING(legacy);
+    for (int i=0; i<repetitions; i++) {
+        if (legacyOutput)
+            cvReleaseImage(&legacyOutput);
+        START_TIMING(legacy);
+        legacyOutput = blendImage(&iplFrame, &iplOverlay, &iplMask);
+        STOP_TIMING(legacy);
+    }
+
+    Mat blended;
+    blendImage(frame, overlay, mask, blended, false);
+    DECLARE_TIMING(single);
+    for (int i=0; i<repetitions; i++) {
+        START_TIMING(single);
+        blendImage(frame, overlay, mask, blended, false);
+        STOP_TIMING(single);
+    }
+    DECLARE_TIMING(threaded);
+    for (int i=0; i<repetitions; i++) {
+        START_TIMING(threaded);
+        blendImage(frame, overlay, mask, blended, true);
+        STOP_TIMING(threaded);
+    }
+
+    LOG("blendImage (%dx%d): IplImage ave=%.2fms, cv::Mat 1 thread ave=%.2fms (%.1fx), cv::Mat threads ave=%.2fms (%.1fx)", frame.cols, frame.rows,
+        GET_AVERAGE_TIMING(legacy), GET_AVERAGE_TIMING(single), GET_AVERAGE_TIMING(legacy) / MAX(GET_AVERAGE_TIMING(single), 1e-6),
+        GET_AVERAGE_TIMING(threaded), GET_AVERAGE_TIMING(legacy) / MAX(GET_AVERAGE_TIMING(threaded), 1e-6));
+
+    if (legacyOutput) {
+        compareResults(Mat(legacyOutput), blended, "blendImage");
+        cvReleaseImage(&legacyOutput);
+    }
+}
+
+// Mede o tempo de recortar e redimensionar um rosto para 70x70 (como no pré-processamento), com as funções IplImage
+// (que copiam o recorte e alocam a saída) e as funções cv::Mat (recorte sem cópia e saída reutilizada).
+void benchmarkCropResize(const Mat &frame, int repetitions)
+{
+    const int FACE_SIZE = 70;
+    const int CROPS_PER_FRAME = 20;
+    Rect faceRect = Rect(frame.cols/3, frame.rows/4, 300, 340);
+    IplImage iplFrame = frame;
+
+    DECLARE_TIMING(legacy);
+    for (int i=0; i<repetitions; i++) {
+        START_TIMING(legacy);
+        for (int j = 0; j < CROPS_PER_FRAME; j++) {
+            IplImage *crop = cropImage(&iplFrame, faceRect);
+            IplImage *face = resizeImage(crop, FACE_SIZE, FACE_SIZE, true);
+            cvReleaseImage(&face);
+            cvReleaseImage(&crop);
+        }
+        STOP_TIMING(legacy);
+    }
+
+    Mat face;
+    DECLARE_TIMING(mat);
+    for (int i=0; i<repetitions; i++) {
+        START_TIMING(mat);
+        for (int j = 0; j < CROPS_PER_FRAME; j++)
+            resizeImage(cropImage(frame, faceRect), face, Size(FACE_SIZE, FACE_SIZE), true);
+        STOP_TIMING(mat);
+    }
+
+    LOG("cropImage + resizeImage (%d faces): IplImage ave=%.2fms, cv::Mat ave=%.2fms, speedup = %.1fx", CROPS_PER_FRAME,
+        GET_AVERAGE_TIMING(legacy), GET_AVERAGE_TIMING(mat), GET_AVERAGE_TIMING(legacy) / MAX(GET_AVERAGE_TIMING(mat), 1e-6));
+}
+
+// Mede o tempo de montar um mosaico de câmeras: combineImagesResized() (no máximo 12 imagens, um novo canvas por chamada)
+// vs MosaicBuilder com 12 e 64 tiles, onde apenas 1 em cada 4 câmeras tem um novo frame em cada composição.
+void benchmarkMosaic(const Mat &frame, int repetitions)
+{
+    const int CAMERA_WIDTH = 640;
+    const int CAMERA_HEIGHT = 480;
+    const int MAX_TILES = 64;
+    vector<Mat> cameras(MAX_TILES);
+    for (int i = 0; i < MAX_TILES; i++) {
+        // Cada câmera vê uma parte diferente do frame.
+        int x = (i * 97) % (frame.cols - CAMERA_WIDTH);
+        int y = (i * 53) % (frame.rows - CAMERA_HEIGHT);
+        cameras[i] = frame(Rect(x, y, CAMERA_WIDTH, CAMERA_HEIGHT)).clone();
+    }
+    vector<IplImage> iplCameras(MAX_TILES);
+    for (int i = 0; i < MAX_TILES; i++)
+        iplCameras[i] = cameras[i];
+
+    DECLARE_TIMING(legacy);
+    for (int i=0; i<repetitions; i++) {
+        START_TIMING(legacy);
+        IplImage *combined = combineImagesResized(12, &iplCameras[0], &iplCameras[1], &iplCameras[2], &iplCameras[3], &iplCameras[4], &iplCameras[5],
+                                                  &iplCameras[6], &iplCameras[7], &iplCameras[8], &iplCameras[9], &iplCameras[10], &iplCameras[11]);
+        STOP_TIMING(legacy);
+        cvReleaseImage(&combined);
+    }
+    LOG("combineImagesResized (12 tiles): ave=%.2fms", GET_AVERAGE_TIMING(legacy));
+
+    int tileCounts[] = {12, MAX_TILES};
+    for (int t = 0; t < 2; t++) {
+        int nTiles = tileCounts[t];
+        MosaicBuilder mosaic(Size(200, 150));
+        mosaic.setTileCount(nTiles);
+        for (int i = 0; i < nTiles; i++)
+            mosaic.setTile(i, cameras[i], 0);
+        DECLARE_TIMING(all);
+        START_TIMING(all);
+        mosaic.composite();
+        STOP_TIMING(all);
+
+        DECLARE_TIMING(changed);
+        int64 frameNumber = 1;
+        for (int i=0; i<repetitions; i++) {
+            for (int j = i % 4; j < nTiles; j += 4)
+                mosaic.setTile(j, cameras[j], frameNumber);
+            frameNumber++;
+            START_TIMING(changed);
+            mosaic.composite();
+            STOP_TIMING(changed);
+        }
+        LOG("MosaicBuilder (%d tiles): first composite (all tiles + tables) = %.2fms, 1/4 of tiles changed ave=%.2fms (%d tiles rendered)",
+            nTiles, GET_TIMING(all), GET_AVERAGE_TIMING(changed), mosaic.getRenderedTileCount());
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    // Usa uma foto dada pelo usuário (redimensionada para 1080p) ou uma imagem aleatória.
+    Mat frame;
+    if (argc > 1) {
+        Mat photo = imread(argv[1]);
+        if (photo.empty()) {
+            cerr << "ERROR: Could not load the image [" << argv[1] << "]!" << endl;
+            return 1;
+        }
+        resize(photo, frame, Size(BENCH_WIDTH, BENCH_HEIGHT));
+    }
+    else {
+        frame = Mat(BENCH_HEIGHT, BENCH_WIDTH, CV_8UC3);
+        randu(frame, Scalar::all(0), Scalar::all(256));
+    }
+    int repetitions = DEFAULT_REPETITIONS;
+    if (argc > 2) {
+        repetitions = MAX(atoi(argv[2]), 1);
+    }
+
+    cout << "Compiled with OpenCV version " << CV_VERSION << ", using " << getNumThreads() << " threads." << endl;
+    cout << "SSE2: " << (checkHardwareSupport(CV_CPU_SSE2) ? "yes" : "no") << endl << endl;
+
+    benchmarkConverter("convertImageRGBtoHSV", convertImageRGBtoHSV, convertImageRGBtoHSV, frame, repetitions);
+    benchmarkConverter("convertImageHSVtoRGB", convertImageHSVtoRGB, convertImageHSVtoRGB, frame, repetitions);
+    benchmarkConverter("convertImageRGBtoYIQ", convertImageRGBtoYIQ, convertImageRGBtoYIQ, frame, repetitions);
+    benchmarkConverter("convertImageYIQtoRGB", convertImageYIQtoRGB, convertImageYIQtoRGB, frame, repetitions);
+    benchmarkBlend(frame, repetitions);
+    benchmarkCropResize(frame, repetitions);
+    benchmarkMosaic(frame, repetitions);
+
+    return 0;
+}
@@ -0,0 +1,300 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+// Microbenchmark de cada etapa do pré-processamento de getPreprocessedFace() e de getSimilarity(), isoladas, para medir com precisão
+// o efeito de cada otimização (vetorização, tabelas, etc.) em uma etapa:
+// - equalizeLeftAndRightHalves() no rosto alinhado.
+// - bilateralFilter(warped, filtered, 0, 20.0, 2.0) no rosto equalizado, e denoiseFace() com as tabelas e com SSE2, com a maior
+//   diferença e a diferença média para o bilateralFilter().
+// - warpAffine() da região do rosto em tons de cinza para o rosto alinhado, com a mesma matriz que getPreprocessedFace() monta, também
+//   com o cvtColor() da região colorida antes, e warpFace() direto da região colorida, com a diferença para o cvtColor() e warpAffine().
+// - A máscara elíptica: desenhar a elipse e copiar o rosto filtrado através dela para a imagem cinza.
+// - getSimilarity() entre dois rostos.
+// Cada etapa roda com rostos sintéticos e, se uma lista for dada, com rostos reais, para vários tamanhos de rosto e números de threads
+// (cv::setNumThreads). Cada medida tem algumas execuções de aquecimento que não contam, e depois várias repetições medidas uma a uma,
+// com a média, o desvio padrão, o mínimo, a mediana, o percentil 95 e o máximo, em microssegundos. Também mostra as instruções
+// que o processador e o OpenCV suportam, para saber qual código foi medido.
+// Uso: benchKernels [rostos.csv] [repeticoes]
+
+const int FACE_SIZES[] = {50, 70, 100, 140};     // 70 é o tamanho do main.cpp.
+const int NUM_FACE_SIZES = sizeof(FACE_SIZES) / sizeof(FACE_SIZES[0]);
+const int FACE_ROI_SCALE = 3;           // A região do rosto na imagem da câmera é cerca de 3x maior que o rosto alinhado.
+const int WARMUP_RUNS = 10;
+const int DEFAULT_REPETITIONS = 200;
+const int MAX_REAL_FACES = 32;
+
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+
+#include "opencv2/opencv.hpp"
+
+
+#include "preprocessFace.h"
+#include "faceDenoise.h"
+#include "faceWarp.h"
+#include "recognition.h"
+
+#include "ImageUtils.h"
+
+using namespace cv;
+using namespace std;
+
+
+// Resumo das medidas de uma etapa, em microssegundos.
+struct KernelStats
+{
+    double mean;
+    double stddev;
+    double min;
+    double median;
+    double p95;
+    double max;
+};
+
+// Roda 'prepare' (sem medir) e depois 'kernel' (medido), WARMUP_RUNS vezes sem contar e 'repetitions' vezes medindo cada execução.
+KernelStats runKernel(const std::function<void()> &prepare, const std::function<void()> &kernel, int repetitions)
+{
+    for (int i = 0; i < WARMUP_RUNS; i++) {
+        prepare();
+        kernel();
+    }
+    vector<double> samples(repetitions);
+    for (int i = 0; i < repetitions; i++) {
+        prepare();
+        int64 start = getTickCount();
+        kernel();
+        samples[i] = (getTickCount() - start) * 1000000.0 / getTickFrequency();
+    }
+
+    KernelStats stats;
+    double sum = 0, sum2 = 0;
+    for (int i = 0; i < repetitions; i++) {
+        sum += samples[i];
+        sum2 += samples[i] * samples[i];
+    }
+    stats.mean = sum / repetitions;
+    stats.stddev = sqrt(max(sum2 / repetitions - stats.mean * stats.mean, 0.0));
+    sort(samples.begin(), samples.end());
+    stats.min = samples[0];
+    stats.median = samples[repetitions / 2];
+    stats.p95 = samples[min((int)ceil(0.95 * repetitions) - 1, repetitions - 1)];
+    stats.max = samples[repetitions - 1];
+    return stats;
+}
+
+void showStats(const char *kernel, const char *input, int faceSize, int threads, const KernelStats &stats)
+{
+    LOG("%-20s %-9s %3dx%-3d %2d threads: mean %8.2fus (sd %7.2f)  min %8.2f  median %8.2f  p95 %8.2f  max %8.2f",
+        kernel, input, faceSize, faceSize, threads, stats.mean, stats.stddev, stats.min, stats.median, stats.p95, stats.max);
+}
+
+// As instruções que o processador suporta, e se o OpenCV está usando o código otimizado.
+void showCPUFeatures()
+{
+    const int features[] = {CV_CPU_SSE, CV_CPU_SSE2, CV_CPU_SSE3, CV_CPU_SSSE3, CV_CPU_SSE4_1, CV_CPU_SSE4_2, CV_CPU_POPCNT, CV_CPU_AVX};
+    const char *names[] = {"SSE", "SSE2", "SSE3", "SSSE3", "SSE4.1", "SSE4.2", "POPCNT", "AVX"};
+    string supported;
+    for (int i = 0; i < (int)(sizeof(features) / sizeof(features[0])); i++) {
+        if (checkHardwareSupport(features[i]))
+            supported += string(" ") + names[i];
+    }
+    LOG("OpenCV %s, %d CPUs, %d threads by default, optimized code %s.", CV_VERSION, getNumberOfCPUs(), getNumThreads(), useOptimized() ? "on" : "off");
+    LOG("CPU supports:%s", supported.c_str());
+    LOG("This program was compiled with SSE2 %s.", CV_SSE2 ? "on" : "off");
+}
+
+// Regiões de rosto sintéticas e coloridas: uma imagem aleatória suave, como os rostos sintéticos de benchRecognition.
+void makeSyntheticFaces(int roiSize, vector<Mat> &faces)
+{
+    RNG rng(12345);
+    for (int i = 0; i < 4; i++) {
+        Mat face = Mat(roiSize, roiSize, CV_32FC3);
+        rng.fill(face, RNG::NORMAL, Scalar(110, 128, 150), Scalar(60, 60, 60));
+        GaussianBlur(face, face, Size(9, 9), 0);
+        Mat face8U;
+        face.convertTo(face8U, CV_8U);
+        faces.push_back(face8U);
+    }
+}
+
+// Carrega até MAX_REAL_FACES rostos de um CSV no formato "caminho;pessoa", coloridos (as imagens em tons de cinza ficam com 3 canais iguais).
+bool loadRealFaces(const char *filename, vector<Mat> &faces)
+{
+    ifstream file(filename);
+    if (!file) {
+        cerr << "ERROR: Could not open the file [" << filename << "]!" << endl;
+        return false;
+    }
+    string line;
+    while (getline(file, line) && (int)faces.size() < MAX_REAL_FACES) {
+        size_t separator = line.find(';');
+        Mat img = imread(line.substr(0, separator), CV_LOAD_IMAGE_COLOR);
+        if (!img.empty())
+            faces.push_back(img);
+    }
+    return !faces.empty();
+}
+
+// A mesma matriz que getPreprocessedFace() monta, para olhos em posições típicas da região do rosto.
+Mat getFaceWarpMatrix(Size roiSize, int faceSize)
+{
+    Point2f leftEye(roiSize.width * 0.31f, roiSize.height * 0.39f);
+    Point2f rightEye(roiSize.width * 0.69f, roiSize.height * 0.41f);
+    return getFaceAlignmentMatrix(leftEye, rightEye, faceSize, faceSize);
+}
+
+// Mede todas as etapas para as regiões de rosto 'rois', com rostos de 'faceSize' pixels, usando 'threads' threads.
+void benchmarkKernels(const char *input, const vector<Mat> &rois, int faceSize, int threads, int repetitions)
+{
+    setNumThreads(threads);
+
+    // As entradas de cada etapa são as saídas reais da etapa anterior, como em getPreprocessedFace().
+    vector<Mat> colorRois, grays, warpedFaces, equalizedFaces, filteredFaces;
+    vector<Mat> warpMatrices;
+    for (size_t i = 0; i < rois.size(); i++) {
+        Mat colorRoi, gray;
+        resize(rois[i], colorRoi, Size(faceSize * FACE_ROI_SCALE, faceSize * FACE_ROI_SCALE), 0, 0, INTER_AREA);
+        cvtColor(colorRoi, gray, CV_BGR2GRAY);
+        Mat rot_mat = getFaceWarpMatrix(gray.size(), faceSize);
+        Mat warped = Mat(faceSize, faceSize, CV_8U, Scalar(128));
+        warpAffine(gray, warped, rot_mat, warped.size());
+        Mat equalized = warped.clone();
+        equalizeLeftAndRightHalves(equalized);
+        Mat filtered;
+        bilateralFilter(equalized, filtered, 0, 20.0, 2.0);
+        colorRois.push_back(colorRoi);
+        grays.push_back(gray);
+        warpMatrices.push_back(rot_mat);
+        warpedFaces.push_back(warped);
+        equalizedFaces.push_back(equalized);
+        filteredFaces.push_back(filtered);
+    }
+
+    size_t n = rois.size();
+    size_t index = 0;
+    Mat work;
+    Mat output;
+    double checksum = 0;     // Usa os resultados, para que nenhuma etapa possa ser eliminada pelo compilador.
+
+    // warpAffine() para um rosto novo preenchido com cinza, como em getPreprocessedFace().
+    showStats("warpAffine", input, faceSize, threads, runKernel(
+        [&]() { index = (index + 1) % n; },
+        [&]() {
+            output = Mat(faceSize, faceSize, CV_8U, Scalar(128));
+            warpAffine(grays[index], output, warpMatrices[index], output.size());
+        }, repetitions));
+    checksum += sum(output)[0];
+
+    // O que getPreprocessedFace() fazia antes de warpFace(): converter a região do rosto inteira para tons de cinza e depois alinhar.
+    showStats("cvtColor+warpAffine", input, faceSize, threads, runKernel(
+        [&]() { index = (index + 1) % n; },
+        [&]() {
+            Mat gray;
+            cvtColor(colorRois[index], gray, CV_BGR2GRAY);
+            output = Mat(faceSize, faceSize, CV_8U, Scalar(128));
+            warpAffine(gray, output, warpMatrices[index], output.size());
+        }, repetitions));
+    checksum += sum(output)[0];
+
+    showStats("warpFace", input, faceSize, threads, runKernel(
+        [&]() { index = (index + 1) % n; },
+        [&]() { warpFace(colorRois[index], warpMatrices[index], output, Size(faceSize, faceSize)); }, repetitions));
+    checksum += sum(output)[0];
+    double maxWarpDiff = 0;
+    for (size_t i = 0; i < n; i++) {
+        Mat warped;
+        warpFace(colorRois[i], warpMatrices[i], warped, Size(faceSize, faceSize));
+        maxWarpDiff = max(maxWarpDiff, norm(warped, warpedFaces[i], NORM_INF));
+    }
+    LOG("%-20s %-9s %3dx%-3d difference to cvtColor+warpAffine: max %.0f", "warpFace", input, faceSize, faceSize, maxWarpDiff);
+
+    // equalizeLeftAndRightHalves() modifica o rosto, então cada execução recebe uma cópia do rosto alinhado (feita sem medir).
+    showStats("equalizeLeftRight", input, faceSize, threads, runKernel(
+        [&]() { index = (index + 1) % n; warpedFaces[index].copyTo(work); },
+        [&]() { equalizeLeftAndRightHalves(work); }, repetitions));
+    checksum += sum(work)[0];
+
+    showStats("bilateralFilter", input, faceSize, threads, runKernel(
+        [&]() { index = (index + 1) % n; },
+        [&]() {
+            output = Mat(faceSize, faceSize, CV_8U);
+            bilateralFilter(equalizedFaces[index], output, 0, 20.0, 2.0);
+        }, repetitions));
+    checksum += sum(output)[0];
+
+    // O mesmo filtro com denoiseFace(), e a diferença para o bilateralFilter() em todos os rostos.
+    const int denoiseModes[] = {FACE_DENOISE_QUALITY, FACE_DENOISE_FAST};
+    const char *denoiseNames[] = {"denoiseFace quality", "denoiseFace fast"};
+    for (int m = 0; m < 2; m++) {
+        showStats(denoiseNames[m], input, faceSize, threads, runKernel(
+            [&]() { index = (index + 1) % n; },
+            [&]() {
+                output = Mat(faceSize, faceSize, CV_8U);
+                denoiseFace(equalizedFaces[index], output, denoiseModes[m]);
+            }, repetitions));
+        checksum += sum(output)[0];
+        double maxDiff = 0, meanDiff = 0;
+        for (size_t i = 0; i < n; i++) {
+            Mat denoised;
+            denoiseFace(equalizedFaces[i], denoised, denoiseModes[m]);
+            maxDiff = max(maxDiff, norm(denoised, filteredFaces[i], NORM_INF));
+            meanDiff += norm(denoised, filteredFaces[i], NORM_L1) / (faceSize * faceSize * n);
+        }
+        LOG("%-20s %-9s %3dx%-3d difference to bilateralFilter: max %.0f, mean %.5f", denoiseNames[m], input, faceSize, faceSize, maxDiff, meanDiff);
+    }
+
+    // A máscara elíptica como em getPreprocessedFace(): desenha a máscara e copia o rosto filtrado através dela.
+    showStats("ellipseMask", input, faceSize, threads, runKernel(
+        [&]() { index = (index + 1) % n; },
+        [&]() { applyFaceEllipseMask(filteredFaces[index], output); }, repetitions));
+    checksum += sum(output)[0];
+
+    double similarity = 0;
+    showStats("getSimilarity", input, faceSize, threads, runKernel(
+        [&]() { index = (index + 1) % n; },
+        [&]() { similarity += getSimilarity(filteredFaces[index], equalizedFaces[(index + 1) % n]); }, repetitions));
+    checksum += similarity;
+
+    if (checksum < 0)
+        LOG("Checksum: %f", checksum);
+}
+
+
+int main(int argc, char *argv[])
+{
+    int repetitions = DEFAULT_REPETITIONS;
+    if (argc > 2)
+        repetitions = MAX(atoi(argv[2]), 1);
+
+    showCPUFeatures();
+
+    vector<Mat> syntheticRois;
+    makeSyntheticFaces(FACE_SIZES[NUM_FACE_SIZES - 1] * FACE_ROI_SCALE, syntheticRois);
+    vector<Mat> realRois;
+    if (argc > 1 && !loadRealFaces(argv[1], realRois))
+        return 1;
+
+    // 1 thread, algumas potências de 2, e todas as CPUs.
+    vector<int> threadCounts;
+    int cpus = getNumberOfCPUs();
+    for (int t = 1; t < cpus; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(cpus);
+
+    for (size_t t = 0; t < threadCounts.size(); t++) {
+        for (int s = 0; s < NUM_FACE_SIZES; s++) {
+            benchmarkKernels("synthetic", syntheticRois, FACE_SIZES[s], threadCounts[t], repetitions);
+            if (!realRois.empty())
+                benchmarkKernels("real", realRois, FACE_SIZES[s], threadCounts[t], repetitions);
+        }
+    }
+    return 0;
+}
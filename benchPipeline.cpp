@@ -0,0 +1,507 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+// Benchmark de ponta a ponta do pipeline do main.cpp, sobre vídeos e imagens gravados em vez da câmera, para comparar commits:
+// - Cada frame passa por detectLargestObject() (com o MultiScaleCascade do main.cpp e com o CascadeClassifier do OpenCV, para comparar),
+//   detectManyObjects(), TiledDetector::detect(), detectBothEyes() no rosto encontrado e
+//   getPreprocessedFace(), e os rostos encontrados são separados
+//   em treinamento e teste (1 de cada TEST_EVERY frames de cada origem vai para o teste). O modelo é treinado com learnCollectedFaces(),
+//   e cada rosto é reconhecido com o RecognizerBackend do modelo (createRecognizerBackend() e recognize()), como no loop do main.cpp.
+//   O reconhecimento através das propriedades do FaceRecognizer (reconstructFace(), getSimilarity() e predict()) é medido à parte, para
+//   comparar, e não entra no tempo de cada frame.
+// - Mostra a vazão (frames por segundo do loop do main.cpp: getPreprocessedFace() e o reconhecimento), os percentis da latência de
+//   cada etapa, o pico de memória (RSS) depois de ler os frames e o quanto o pipeline o aumentou, as alocações por frame, e a precisão
+//   da detecção e do reconhecimento.
+// - Mede a detecção em tiles com 1, 2, 4... threads, até o número de CPUs, para ver se ela escala com os núcleos. Com cada número de
+//   threads, verifica que os tiles encontram os mesmos rostos que com 1 thread, e que detectManyObjects() com o MultiScaleCascade
+//   encontra os mesmos rostos que com o CascadeClassifier do OpenCV. O programa retorna 1 se algum frame for diferente.
+// - Os mesmos resultados são escritos em um arquivo JSON.
+// Os frames são todos lidos antes de medir, então a leitura dos arquivos não entra nos tempos, e processados sempre na mesma ordem,
+// então a detecção e o reconhecimento dão os mesmos resultados a cada execução.
+//
+// A lista de origens tem uma linha "origem;pessoa" por vídeo ou imagem, como os CSV dos exemplos de reconhecimento de face do OpenCV:
+// 'origem' é uma imagem, um vídeo, ou uma sequência de imagens no formato do VideoCapture (por exemplo "pessoa3/frame_%04d.png"), e
+// 'pessoa' é o número da pessoa que aparece em todos os frames da origem, ou -1 se os frames não têm nenhum rosto.
+// Usa os mesmos arquivos XML dos detectores que o main.cpp, no diretório atual.
+// O modo do filtro bilateral (FaceDenoiseMode: 0 = bilateralFilter() do OpenCV, 1 = tabelas, 2 = SSE2) pode ser escolhido, para comparar
+// a precisão do reconhecimento com cada um.
+// Uso: benchPipeline origens.txt [resultado.json] [repeticoes] [algoritmo] [modo do filtro]
+
+const int FACE_SIZE = 70;                   // Mesmo tamanho dos rostos pré-processados do main.cpp.
+const int DETECTION_WIDTH = 320;            // Mesma largura da detecção de rostos do main.cpp.
+const int MAX_FRAMES_PER_SOURCE = 300;      // Quantos frames de cada vídeo são usados, no máximo.
+const int TEST_EVERY = 4;                   // 1 de cada 4 frames de cada origem vai para o conjunto de teste.
+const int DEFAULT_REPETITIONS = 3;
+const float UNKNOWN_PERSON_THRESHOLD = 0.7f;    // O mesmo do main.cpp.
+const double UNKNOWN_PERSON_LBPH_THRESHOLD = 123.0;     // O mesmo do main.cpp (chi-quadrado assimétrico do LBPH do OpenCV).
+const double UNKNOWN_PERSON_FASTLBPH_THRESHOLD = 60.0;  // O mesmo do main.cpp (chi-quadrado simétrico do FastLBPH).
+const bool preprocessLeftAndRightSeparately = true;
+const char *DEFAULT_JSON_FILE = "benchPipeline.json";
+const char *DEFAULT_ALGORITHM = "FaceRecognizer.FastFisherfaces";   // O mesmo 'facerecAlgorithm' do main.cpp.
+const int DEFAULT_DENOISE_MODE = 2;         // FACE_DENOISE_FAST, o mesmo 'faceDenoiseMode' do main.cpp.
+const int TILED_MIN_FACE_SIZE = 24;         // Menor rosto procurado pela detecção em tiles, na resolução original dos frames.
+
+const char *faceCascadeFilename = "lbpcascade_frontalface.xml";
+const char *eyeCascadeFilename1 = "haarcascade_eye.xml";
+const char *eyeCascadeFilename2 = "haarcascade_eye_tree_eyeglasses.xml";
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+
+#if !defined(_WIN32)
+    #include <sys/resource.h>
+#endif
+
+
+#include "opencv2/opencv.hpp"
+
+
+#include "detectObject.h"
+#include "tiledDetection.h"
+#include "multiScaleCascade.h"
+#include "preprocessFace.h"
+#include "recognition.h"
+#include "recognizerBackend.h"
+
+#include "ImageUtils.h"
+
+using namespace cv;
+using namespace std;
+
+
+// Conta todas as alocações do processo (inclusive as dos Mat do OpenCV, que usam malloc), substituindo malloc, calloc e realloc
+// da glibc. Em outras plataformas as alocações não são contadas.
+static std::atomic<long long> g_allocations(0);
+#if defined(__GLIBC__)
+    #define HAVE_ALLOCATION_COUNT 1
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *malloc(size_t size) __THROW { g_allocations++; return __libc_malloc(size); }
+void *calloc(size_t n, size_t size) __THROW { g_allocations++; return __libc_calloc(n, size); }
+void *realloc(void *p, size_t size) __THROW { g_allocations++; return __libc_realloc(p, size); }
+}
+#else
+    #define HAVE_ALLOCATION_COUNT 0
+#endif
+
+// Pico da memória residente do processo, em KB (ou -1 se não for possível saber).
+long getPeakRSSKB()
+{
+#if defined(_WIN32)
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+    #if defined(__APPLE__)
+        return (long)(usage.ru_maxrss / 1024);      // No macOS, ru_maxrss está em bytes.
+    #else
+        return (long)usage.ru_maxrss;
+    #endif
+#endif
+}
+
+
+// Latências de uma etapa, em ms.
+struct StageLatency
+{
+    string name;
+    vector<double> samples;
+
+    double percentile(double p) const
+    {
+        if (samples.empty())
+            return 0;
+        vector<double> sorted = samples;
+        sort(sorted.begin(), sorted.end());
+        int index = (int)ceil(p / 100.0 * sorted.size()) - 1;
+        return sorted[min(max(index, 0), (int)sorted.size() - 1)];
+    }
+
+    double mean() const
+    {
+        double sum = 0;
+        for (size_t i = 0; i < samples.size(); i++)
+            sum += samples[i];
+        return samples.empty() ? 0 : sum / samples.size();
+    }
+};
+
+enum STAGES {STAGE_DETECT_LARGEST=0, STAGE_DETECT_LARGEST_OPENCV, STAGE_DETECT_MANY, STAGE_DETECT_TILED, STAGE_DETECT_EYES, STAGE_PREPROCESS, STAGE_TRAIN, STAGE_PREPROCESS_RECOGNITION, STAGE_RECOGNIZE, STAGE_RECOGNIZE_OPENCV, STAGE_END};
+const char* STAGE_NAMES[] = {"detectLargestObject", "detectLargestObject (OpenCV)", "detectManyObjects", "TiledDetector::detect", "detectBothEyes", "getPreprocessedFace", "learnCollectedFaces", "getPreprocessedFace (recognition)", "RecognizerBackend::recognize", "reconstructFace+predict"};
+
+struct Frame
+{
+    Mat image;
+    int label;      // A pessoa do frame, ou -1 se ele não tem nenhum rosto.
+    bool isTest;    // Se o rosto do frame é usado no teste em vez do treinamento.
+};
+
+static double elapsedMs(int64 start)
+{
+    return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
+// Escreve uma string JSON, com as aspas e as barras escapadas.
+static string jsonString(const string &s)
+{
+    string out = "\"";
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '"' || s[i] == '\\')
+            out += '\\';
+        out += s[i];
+    }
+    return out + "\"";
+}
+
+
+static bool compareRects(const Rect &a, const Rect &b)
+{
+    if (a.y != b.y)
+        return a.y < b.y;
+    if (a.x != b.x)
+        return a.x < b.x;
+    return (a.width != b.width) ? a.width < b.width : a.height < b.height;
+}
+
+// Se as duas listas têm os mesmos retângulos. A ordem não conta, já que o detectMultiScale() do OpenCV junta os candidatos das faixas de
+// cada escala na ordem em que as threads terminam.
+static bool sameRects(vector<Rect> a, vector<Rect> b)
+{
+    sort(a.begin(), a.end(), compareRects);
+    sort(b.begin(), b.end(), compareRects);
+    return a == b;
+}
+
+
+// Lê todos os frames das origens da lista, na ordem da lista.
+bool loadSources(const char *filename, vector<Frame> &frames, int &numSources)
+{
+    ifstream file(filename);
+    if (!file) {
+        cerr << "ERROR: Could not open the file [" << filename << "]!" << endl;
+        return false;
+    }
+    numSources = 0;
+    string line;
+    while (getline(file, line)) {
+        size_t separator = line.find(';');
+        if (separator == string::npos)
+            continue;
+        string source = line.substr(0, separator);
+        int label = atoi(line.substr(separator + 1).c_str());
+
+        // Uma imagem só, ou um vídeo (ou sequência de imagens).
+        vector<Mat> images;
+        Mat img;
+        if (source.find('%') == string::npos)
+            img = imread(source);
+        if (!img.empty()) {
+            images.push_back(img);
+        }
+        else {
+            VideoCapture video(source);
+            while (video.isOpened() && (int)images.size() < MAX_FRAMES_PER_SOURCE) {
+                Mat frame;
+                if (!video.read(frame) || frame.empty())
+                    break;
+                images.push_back(frame.clone());
+            }
+        }
+        if (images.empty()) {
+            cerr << "WARNING: Could not read any frame from [" << source << "]." << endl;
+            continue;
+        }
+
+        for (size_t i = 0; i < images.size(); i++) {
+            Frame frame;
+            frame.image = images[i];
+            frame.label = label;
+            frame.isTest = (i % TEST_EVERY == TEST_EVERY - 1);
+            frames.push_back(frame);
+        }
+        numSources++;
+    }
+    return !frames.empty();
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: benchPipeline sources.txt [results.json] [repetitions] [algorithm] [denoise mode]" << endl;
+        return 1;
+    }
+    const char *jsonFilename = (argc > 2) ? argv[2] : DEFAULT_JSON_FILE;
+    int repetitions = (argc > 3) ? MAX(atoi(argv[3]), 1) : DEFAULT_REPETITIONS;
+    string facerecAlgorithm = (argc > 4) ? argv[4] : DEFAULT_ALGORITHM;
+    int denoiseMode = (argc > 5) ? atoi(argv[5]) : DEFAULT_DENOISE_MODE;
+
+    MultiScaleCascade faceCascade;      // O mesmo detector de rostos do main.cpp.
+    CascadeClassifier opencvFaceCascade, eyeCascade1, eyeCascade2;
+    if (!faceCascade.load(faceCascadeFilename) || !opencvFaceCascade.load(faceCascadeFilename) || !eyeCascade1.load(eyeCascadeFilename1)) {
+        cerr << "ERROR: Could not load the detectors [" << faceCascadeFilename << "] and [" << eyeCascadeFilename1 << "]!" << endl;
+        return 1;
+    }
+    eyeCascade2.load(eyeCascadeFilename2);      // Opcional, como no main.cpp.
+    TiledDetector tiledDetector;
+    tiledDetector.load(faceCascadeFilename);
+
+    vector<Frame> frames;
+    int numSources = 0;
+    if (!loadSources(argv[1], frames, numSources))
+        return 1;
+    // Os frames ficam todos na memória, então o pico de RSS do pipeline é medido a partir daqui.
+    long loadedRSS = getPeakRSSKB();
+    LOG("Loaded %d frames from %d sources, peak RSS %ld KB.", (int)frames.size(), numSources, loadedRSS);
+
+    vector<StageLatency> stages(STAGE_END);
+    for (int s = 0; s < STAGE_END; s++)
+        stages[s].name = STAGE_NAMES[s];
+    vector<double> frameMs;
+    vector<long long> frameAllocations;
+
+    // Detecção: os mesmos resultados em todas as repetições, então a precisão é contada só na primeira.
+    int framesWithFace = 0, detected = 0, framesWithoutFace = 0, falsePositives = 0, preprocessed = 0;
+    int opencvDetected = 0, opencvAgreement = 0;    // Com o detectMultiScale() do OpenCV, e em quantos frames os dois dão o mesmo rosto.
+    vector<Mat> trainFaces, testFaces;
+    vector<int> trainLabels, testLabels;
+    for (int r = 0; r < repetitions; r++) {
+        for (size_t i = 0; i < frames.size(); i++) {
+            Rect largest;
+            int64 start = getTickCount();
+            detectLargestObject(frames[i].image, faceCascade, largest, DETECTION_WIDTH);
+            stages[STAGE_DETECT_LARGEST].samples.push_back(elapsedMs(start));
+
+            Rect opencvLargest;
+            start = getTickCount();
+            detectLargestObject(frames[i].image, opencvFaceCascade, opencvLargest, DETECTION_WIDTH);
+            stages[STAGE_DETECT_LARGEST_OPENCV].samples.push_back(elapsedMs(start));
+
+            vector<Rect> objects;
+            start = getTickCount();
+            detectManyObjects(frames[i].image, faceCascade, objects, DETECTION_WIDTH);
+            stages[STAGE_DETECT_MANY].samples.push_back(elapsedMs(start));
+
+            vector<Rect> tiledObjects;
+            start = getTickCount();
+            tiledDetector.detect(frames[i].image, tiledObjects, TILED_MIN_FACE_SIZE);
+            stages[STAGE_DETECT_TILED].samples.push_back(elapsedMs(start));
+
+            // A busca dos olhos sozinha, no rosto encontrado, para ver se o custo depende da resolução da câmera.
+            if (largest.width > 0) {
+                Point2f leftEye, rightEye;
+                start = getTickCount();
+                detectBothEyes(frames[i].image(largest), eyeCascade1, eyeCascade2, leftEye, rightEye);
+                stages[STAGE_DETECT_EYES].samples.push_back(elapsedMs(start));
+            }
+
+            start = getTickCount();
+            Mat face = getPreprocessedFace(frames[i].image, FACE_SIZE, faceCascade, eyeCascade1, eyeCascade2, preprocessLeftAndRightSeparately,
+                                           NULL, NULL, NULL, NULL, NULL, false, denoiseMode);
+            stages[STAGE_PREPROCESS].samples.push_back(elapsedMs(start));
+
+            if (r == 0) {
+                // O mesmo rosto: nenhum nos dois, ou retângulos que se cobrem em mais da metade.
+                bool sameFace = (largest.width <= 0 && opencvLargest.width <= 0);
+                if (largest.width > 0 && opencvLargest.width > 0)
+                    sameFace = (largest & opencvLargest).area() > 0.5 * max(largest.area(), opencvLargest.area());
+                opencvAgreement += sameFace ? 1 : 0;
+                if (frames[i].label >= 0) {
+                    framesWithFace++;
+                    detected += (largest.width > 0) ? 1 : 0;
+                    opencvDetected += (opencvLargest.width > 0) ? 1 : 0;
+                }
+                else {
+                    framesWithoutFace++;
+                    falsePositives += (largest.width > 0) ? 1 : 0;
+                }
+                if (face.data && frames[i].label >= 0) {
+                    preprocessed++;
+                    (frames[i].isTest ? testFaces : trainFaces).push_back(face);
+                    (frames[i].isTest ? testLabels : trainLabels).push_back(frames[i].label);
+                }
+            }
+        }
+    }
+
+    // A detecção em tiles com cada número de threads, uma passada por todos os frames para cada um. Depois, fora do tempo, os resultados
+    // com esse número de threads são comparados com os de 1 thread (os tiles) e com os do OpenCV (o MultiScaleCascade).
+    vector<int> threadCounts;
+    vector<double> tiledMs;
+    vector<int> tiledMismatches, cascadeMismatches;
+    vector<vector<Rect> > singleThreadTiled(frames.size());
+    int defaultThreads = getNumThreads();
+    int cpus = getNumberOfCPUs();
+    for (int t = 1; t < cpus; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(cpus);
+    for (size_t t = 0; t < threadCounts.size(); t++) {
+        setNumThreads(threadCounts[t]);
+        vector<vector<Rect> > tiledObjects(frames.size());
+        int64 start = getTickCount();
+        for (size_t i = 0; i < frames.size(); i++)
+            tiledDetector.detect(frames[i].image, tiledObjects[i], TILED_MIN_FACE_SIZE);
+        tiledMs.push_back(elapsedMs(start) / frames.size());
+        if (t == 0)
+            singleThreadTiled = tiledObjects;
+
+        tiledMismatches.push_back(0);
+        cascadeMismatches.push_back(0);
+        for (size_t i = 0; i < frames.size(); i++) {
+            tiledMismatches[t] += sameRects(tiledObjects[i], singleThreadTiled[i]) ? 0 : 1;
+            vector<Rect> objects, opencvObjects;
+            detectManyObjects(frames[i].image, faceCascade, objects, DETECTION_WIDTH);
+            detectManyObjects(frames[i].image, opencvFaceCascade, opencvObjects, DETECTION_WIDTH);
+            cascadeMismatches[t] += sameRects(objects, opencvObjects) ? 0 : 1;
+        }
+        LOG("TiledDetector::detect with %2d threads: %8.2fms per frame (%.2fx the speed of 1 thread), %d frames differ from 1 thread, "
+            "MultiScaleCascade differs from OpenCV in %d frames (both must be 0).", threadCounts[t], tiledMs[t], tiledMs[0] / tiledMs[t],
+            tiledMismatches[t], cascadeMismatches[t]);
+    }
+    setNumThreads(defaultThreads);
+
+    // Treinamento, uma vez por repetição, com o limite do LBPH ou do FastLBPH que o main.cpp usa para o algoritmo.
+    double lbphThreshold = (facerecAlgorithm == "FaceRecognizer.FastLBPH") ? UNKNOWN_PERSON_FASTLBPH_THRESHOLD : UNKNOWN_PERSON_LBPH_THRESHOLD;
+    Ptr<FaceRecognizer> model;
+    if (!trainFaces.empty()) {
+        for (int r = 0; r < repetitions; r++) {
+            int64 start = getTickCount();
+            model = learnCollectedFaces(trainFaces, trainLabels, facerecAlgorithm, 0, 0.0, false, lbphThreshold);
+            stages[STAGE_TRAIN].samples.push_back(elapsedMs(start));
+        }
+    }
+    if (model.empty())
+        LOG("WARNING: No model could be trained from the %d training faces, skipping the recognition.", (int)trainFaces.size());
+    // O main.cpp cria o backend uma vez para cada modelo publicado, então isso não entra no tempo dos frames.
+    std::shared_ptr<RecognizerBackend> backend;
+    if (!model.empty())
+        backend = createRecognizerBackend(model, facerecAlgorithm, Size(FACE_SIZE, FACE_SIZE));
+
+    // O loop de cada frame do main.cpp, no modo de reconhecimento: getPreprocessedFace() e recognize().
+    int correct = 0, unknown = 0, tested = 0;
+    for (int r = 0; r < repetitions && !model.empty(); r++) {
+        for (size_t i = 0; i < frames.size(); i++) {
+            long long allocationsBefore = g_allocations;
+            int64 frameStart = getTickCount();
+
+            int64 start = getTickCount();
+            Mat face = getPreprocessedFace(frames[i].image, FACE_SIZE, faceCascade, eyeCascade1, eyeCascade2, preprocessLeftAndRightSeparately,
+                                           NULL, NULL, NULL, NULL, NULL, false, denoiseMode);
+            stages[STAGE_PREPROCESS_RECOGNITION].samples.push_back(elapsedMs(start));
+            if (face.data) {
+                start = getTickCount();
+                RecognitionResult result = backend->recognize(face);
+                stages[STAGE_RECOGNIZE].samples.push_back(elapsedMs(start));
+
+                if (r == 0 && frames[i].isTest && frames[i].label >= 0) {
+                    tested++;
+                    if (result.similarity >= UNKNOWN_PERSON_THRESHOLD || result.label < 0)
+                        unknown++;
+                    else if (result.label == frames[i].label)
+                        correct++;
+                }
+            }
+
+            frameMs.push_back(elapsedMs(frameStart));
+            frameAllocations.push_back(g_allocations - allocationsBefore);
+
+            // O mesmo reconhecimento lendo as propriedades do FaceRecognizer a cada frame, fora do tempo do frame.
+            if (face.data) {
+                start = getTickCount();
+                Mat reconstructedFace = reconstructFace(model, face);
+                getSimilarity(face, reconstructedFace);
+                int label;
+                double distance;
+                model->predict(face, label, distance);
+                stages[STAGE_RECOGNIZE_OPENCV].samples.push_back(elapsedMs(start));
+            }
+        }
+    }
+
+    double totalMs = 0;
+    long long totalAllocations = 0, maxAllocations = 0;
+    for (size_t i = 0; i < frameMs.size(); i++) {
+        totalMs += frameMs[i];
+        totalAllocations += frameAllocations[i];
+        maxAllocations = max(maxAllocations, frameAllocations[i]);
+    }
+    double fps = (totalMs > 0) ? frameMs.size() * 1000.0 / totalMs : 0;
+    double allocationsPerFrame = frameMs.empty() ? 0 : (double)totalAllocations / frameMs.size();
+    long peakRSS = getPeakRSSKB();
+    long pipelineRSS = (peakRSS >= 0 && loadedRSS >= 0) ? peakRSS - loadedRSS : -1;
+
+    LOG("Pipeline: %.1f frames/s, peak RSS %ld KB (%ld KB above the %ld KB after loading the frames), %.1f allocations per frame (max %d).",
+        fps, peakRSS, pipelineRSS, loadedRSS, allocationsPerFrame, (int)maxAllocations);
+    for (int s = 0; s < STAGE_END; s++) {
+        LOG("%-34s %5d runs: mean %7.2fms, p50 %7.2fms, p90 %7.2fms, p99 %7.2fms, max %7.2fms", stages[s].name.c_str(), (int)stages[s].samples.size(),
+            stages[s].mean(), stages[s].percentile(50), stages[s].percentile(90), stages[s].percentile(99), stages[s].percentile(100));
+    }
+    LOG("Detection: %d of %d frames with a face detected, %d false positives in %d frames without a face, %d faces preprocessed.",
+        detected, framesWithFace, falsePositives, framesWithoutFace, preprocessed);
+    LOG("Detection with OpenCV's detectMultiScale(): %d of %d frames with a face detected, the same face as MultiScaleCascade in %d of %d frames.",
+        opencvDetected, framesWithFace, opencvAgreement, (int)frames.size());
+    LOG("Recognition [%s, denoise mode %d]: %d training faces, %d of %d test faces correct (%.1f%%), %d unknown.", facerecAlgorithm.c_str(), denoiseMode,
+        (int)trainFaces.size(), correct, tested, 100.0 * correct / MAX(tested, 1), unknown);
+
+    FILE *json = fopen(jsonFilename, "w");
+    if (!json) {
+        cerr << "ERROR: Could not write the results to [" << jsonFilename << "]!" << endl;
+        return 1;
+    }
+    fprintf(json, "{\n");
+    fprintf(json, "  \"sources_file\": %s,\n", jsonString(argv[1]).c_str());
+    fprintf(json, "  \"algorithm\": %s,\n", jsonString(facerecAlgorithm).c_str());
+    fprintf(json, "  \"denoise_mode\": %d,\n", denoiseMode);
+    fprintf(json, "  \"opencv_version\": %s,\n", jsonString(CV_VERSION).c_str());
+    fprintf(json, "  \"threads\": %d,\n", getNumThreads());
+    fprintf(json, "  \"repetitions\": %d,\n", repetitions);
+    fprintf(json, "  \"sources\": %d,\n", numSources);
+    fprintf(json, "  \"frames\": %d,\n", (int)frames.size());
+    fprintf(json, "  \"throughput_fps\": %.3f,\n", fps);
+    fprintf(json, "  \"peak_rss_kb\": %ld,\n", peakRSS);
+    fprintf(json, "  \"loaded_rss_kb\": %ld,\n", loadedRSS);
+    fprintf(json, "  \"pipeline_rss_kb\": %ld,\n", pipelineRSS);
+    if (HAVE_ALLOCATION_COUNT)
+        fprintf(json, "  \"allocations_per_frame\": {\"mean\": %.2f, \"max\": %lld},\n", allocationsPerFrame, maxAllocations);
+    else
+        fprintf(json, "  \"allocations_per_frame\": null,\n");
+    fprintf(json, "  \"stages\": {\n");
+    for (int s = 0; s < STAGE_END; s++) {
+        fprintf(json, "    %s: {\"count\": %d, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f}%s\n",
+                jsonString(stages[s].name).c_str(), (int)stages[s].samples.size(), stages[s].mean(), stages[s].percentile(50),
+                stages[s].percentile(90), stages[s].percentile(99), stages[s].percentile(100), (s < STAGE_END - 1) ? "," : "");
+    }
+    fprintf(json, "  },\n");
+    fprintf(json, "  \"tiled_detection\": {\"min_face_size\": %d, \"threads\": [", TILED_MIN_FACE_SIZE);
+    for (size_t t = 0; t < threadCounts.size(); t++)
+        fprintf(json, "{\"threads\": %d, \"mean_ms\": %.4f, \"frames_differing_from_1_thread\": %d, \"multiscale_frames_differing_from_opencv\": %d}%s",
+                threadCounts[t], tiledMs[t], tiledMismatches[t], cascadeMismatches[t], (t < threadCounts.size() - 1) ? ", " : "");
+    fprintf(json, "]},\n");
+    fprintf(json, "  \"detection\": {\"frames_with_face\": %d, \"detected\": %d, \"detection_rate\": %.4f, \"frames_without_face\": %d, \"false_positives\": %d, \"preprocessed\": %d, \"opencv_detected\": %d, \"opencv_agreement\": %d},\n",
+            framesWithFace, detected, (double)detected / MAX(framesWithFace, 1), framesWithoutFace, falsePositives, preprocessed, opencvDetected, opencvAgreement);
+    fprintf(json, "  \"recognition\": {\"train_faces\": %d, \"test_faces\": %d, \"correct\": %d, \"unknown\": %d, \"accuracy\": %.4f}\n",
+            (int)trainFaces.size(), tested, correct, unknown, (double)correct / MAX(tested, 1));
+    fprintf(json, "}\n");
+    fclose(json);
+    LOG("Wrote the results to [%s].", jsonFilename);
+
+    int mismatches = 0;
+    for (size_t t = 0; t < threadCounts.size(); t++)
+        mismatches += tiledMismatches[t] + cascadeMismatches[t];
+    if (mismatches > 0) {
+        LOG("ERROR: The detections changed with the number of threads or differ from OpenCV in %d frames.", mismatches);
+        return 1;
+    }
+    return 0;
+}
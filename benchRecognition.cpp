@@ -0,0 +1,824 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+// Benchmark do reconhecimento (FastEigenfaces e FastFisherfaces): precisão e velocidade da projeção com os autovetores float, float16 e int8,
+// a vazão do reconhecimento em lotes (BatchRecognizer) comparado com o reconhecimento rosto por rosto do main.cpp,
+// a precisão e a latência do modo de posto reduzido, para vários números de componentes e frações da variância explicada,
+// o LBPH do OpenCV comparado com o FastLBPH, e o reconhecimento de cada frame do main.cpp através das propriedades do FaceRecognizer
+// comparado com os RecognizerBackend genéricos e especializados para rostos 70x70, e o tamanho da galeria, o tempo de treinamento e a
+// precisão com e sem o GalleryDedupIndex ao coletar rostos, e a memória e o tempo de treinamento com as cópias espelhadas guardadas
+// comparados com os rostos espelhados lidos dos originais durante o treinamento, a galeria em vector<Mat> comparada com o FaceGallery,
+// e a remoção de uma pessoa do modelo (sem treinar de novo) enquanto outra thread continua reconhecendo, e a calibração dos limites de
+// distância do LBPH e do FastLBPH para as pessoas desconhecidas.
+// A precisão é medida em um conjunto separado: 1 de cada 4 rostos de cada pessoa não é usado no treinamento, só no teste.
+// Usa um arquivo CSV no formato dos exemplos de reconhecimento de face do OpenCV (uma linha "caminho/da/imagem.png;pessoa" por rosto),
+// ou rostos sintéticos se nenhum arquivo for dado.
+// Uso: benchRecognition [rostos.csv] [repeticoes]
+//      benchRecognition --check-person-removal    (só a verificação da remoção de pessoas, com os rostos sintéticos; usado pelo CTest)
+
+const int FACE_SIZE = 70;               // Mesmo tamanho dos rostos pré-processados do main.cpp.
+const int SYNTHETIC_PERSONS = 40;
+const int SYNTHETIC_FACES_PER_PERSON = 16;
+const int TEST_EVERY = 4;               // 1 de cada 4 rostos de cada pessoa vai para o conjunto de teste.
+const int DEFAULT_REPETITIONS = 10;
+const int DUPLICATES_PER_FACE = 3;      // Na simulação da coleta, quantas cópias quase iguais de cada rosto a câmera "vê".
+const double UNKNOWN_PERSON_LBPH_THRESHOLD = 123.0;     // O mesmo do main.cpp (chi-quadrado assimétrico do LBPH do OpenCV).
+const double UNKNOWN_PERSON_FASTLBPH_THRESHOLD = 60.0;  // O mesmo do main.cpp (chi-quadrado simétrico do FastLBPH).
+const int UNKNOWN_EVERY = 4;            // Na calibração dos limites, 1 de cada 4 pessoas fica fora do treinamento, como desconhecida.
+const double KNOWN_ACCEPTED = 0.95;     // O limite sugerido aceita 95% dos rostos das pessoas conhecidas reconhecidos corretamente.
+
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <algorithm>
+
+
+#include "opencv2/opencv.hpp"
+
+
+#include "fastFaceRecognizer.h"
+#include "fastLBPHFaceRecognizer.h"
+#include "recognition.h"
+#include "recognizerBackend.h"
+#include "galleryDedup.h"
+#include "faceGallery.h"
+
+#include "ImageUtils.h"
+
+using namespace cv;
+using namespace std;
+
+
+const char* QUANTIZATION_NAMES[] = {"float32", "float16", "int8"};
+
+
+// Carrega os rostos de um CSV no formato "caminho;pessoa", convertendo para tons de cinza de FACE_SIZE x FACE_SIZE.
+bool loadDataset(const char *filename, vector<Mat> &faces, vector<int> &labels)
+{
+    ifstream file(filename);
+    if (!file) {
+        cerr << "ERROR: Could not open the file [" << filename << "]!" << endl;
+        return false;
+    }
+    string line;
+    while (getline(file, line)) {
+        size_t separator = line.find(';');
+        if (separator == string::npos)
+            continue;
+        Mat img = imread(line.substr(0, separator), CV_LOAD_IMAGE_GRAYSCALE);
+        if (img.empty()) {
+            cerr << "WARNING: Could not load the image [" << line.substr(0, separator) << "]." << endl;
+            continue;
+        }
+        Mat face;
+        resize(img, face, Size(FACE_SIZE, FACE_SIZE), 0, 0, INTER_AREA);
+        faces.push_back(face);
+        labels.push_back(atoi(line.substr(separator + 1).c_str()));
+    }
+    return !faces.empty();
+}
+
+// Gera rostos sintéticos: cada pessoa é uma imagem aleatória suave, e cada rosto dela tem ruído, outro brilho e um pequeno deslocamento.
+void makeSyntheticDataset(vector<Mat> &faces, vector<int> &labels)
+{
+    RNG rng(12345);
+    for (int p = 0; p < SYNTHETIC_PERSONS; p++) {
+        Mat person = Mat(FACE_SIZE, FACE_SIZE, CV_32F);
+        rng.fill(person, RNG::NORMAL, 128, 60);
+        GaussianBlur(person, person, Size(9, 9), 0);
+        for (int i = 0; i < SYNTHETIC_FACES_PER_PERSON; i++) {
+            Mat noise = Mat(FACE_SIZE, FACE_SIZE, CV_32F);
+            rng.fill(noise, RNG::NORMAL, rng.uniform(-20.0, 20.0), 20);
+            Mat shift = (Mat_<double>(2,3) << 1, 0, rng.uniform(-2.0, 2.0), 0, 1, rng.uniform(-2.0, 2.0));
+            Mat shifted;
+            warpAffine(person, shifted, shift, person.size(), INTER_LINEAR, BORDER_REPLICATE);
+            Mat face;
+            Mat(shifted + noise).convertTo(face, CV_8U);
+            faces.push_back(face);
+            labels.push_back(p);
+        }
+    }
+}
+
+// Separa 1 de cada TEST_EVERY rostos de cada pessoa para o teste.
+void splitDataset(const vector<Mat> &faces, const vector<int> &labels, vector<Mat> &trainFaces, vector<int> &trainLabels, vector<Mat> &testFaces, vector<int> &testLabels)
+{
+    map<int, int> count;
+    for (size_t i = 0; i < faces.size(); i++) {
+        if (count[labels[i]]++ % TEST_EVERY == TEST_EVERY - 1) {
+            testFaces.push_back(faces[i]);
+            testLabels.push_back(labels[i]);
+        }
+        else {
+            trainFaces.push_back(faces[i]);
+            trainLabels.push_back(labels[i]);
+        }
+    }
+}
+
+// Mede a precisão no conjunto de teste e o tempo da projeção de cada rosto, para cada tipo de autovetor.
+void benchmarkQuantization(const char *name, FastSubspaceFaceRecognizer &model, const vector<Mat> &testFaces, const vector<int> &testLabels, int repetitions)
+{
+    int n = (int)testFaces.size();
+    vector<int> floatPredictions(n);
+    Mat eigenvectors = model.get<Mat>("eigenvectors");
+    for (int q = PROJECTION_FLOAT32; q <= PROJECTION_INT8; q++) {
+        model.setProjectionQuantization(q);
+
+        DECLARE_TIMING(projection);
+        for (int r = 0; r < repetitions; r++) {
+            START_TIMING(projection);
+            for (int i = 0; i < n; i++)
+                model.project(testFaces[i]);
+            STOP_TIMING(projection);
+        }
+
+        int correct = 0;
+        int sameAsFloat = 0;
+        for (int i = 0; i < n; i++) {
+            int label = model.predict(testFaces[i]);
+            if (q == PROJECTION_FLOAT32)
+                floatPredictions[i] = label;
+            if (label == testLabels[i])
+                correct++;
+            if (label == floatPredictions[i])
+                sameAsFloat++;
+        }
+
+        int bytesPerValue = (q == PROJECTION_FLOAT32) ? 4 : ((q == PROJECTION_FLOAT16) ? 2 : 1);
+        LOG("%s %s: accuracy = %.1f%% (%d of %d), same prediction as float32 = %.1f%%, projection ave=%.1fus per face, eigenvectors = %d KB",
+            name, QUANTIZATION_NAMES[q], 100.0 * correct / n, correct, n, 100.0 * sameAsFloat / n,
+            1000.0 * GET_AVERAGE_TIMING(projection) / n, (int)(eigenvectors.total() * bytesPerValue / 1024));
+    }
+    model.setProjectionQuantization(PROJECTION_FLOAT32);
+}
+
+// Mede quantos rostos por segundo são reconhecidos rosto por rosto (reconstructFace() + getSimilarity() + predict(), como no main.cpp)
+// e em lotes de 1, 8, 64 e 512 rostos, e verifica se os resultados dos lotes são os mesmos.
+void benchmarkBatch(const char *name, const Ptr<FaceRecognizer> &model, const vector<Mat> &testFaces, int repetitions)
+{
+    int batchSizes[] = {1, 8, 64, 512};
+    BatchRecognizer batchRecognizer(model);
+    for (int b = 0; b < 4; b++) {
+        int batchSize = batchSizes[b];
+        vector<Mat> batch(batchSize);
+        for (int i = 0; i < batchSize; i++)
+            batch[i] = testFaces[i % testFaces.size()];
+
+        vector<int> singleLabels(batchSize);
+        vector<double> singleSimilarities(batchSize);
+        DECLARE_TIMING(single);
+        for (int r = 0; r < repetitions; r++) {
+            START_TIMING(single);
+            for (int i = 0; i < batchSize; i++) {
+                Mat reconstructedFace = reconstructFace(model, batch[i]);
+                singleSimilarities[i] = getSimilarity(batch[i], reconstructedFace);
+                singleLabels[i] = model->predict(batch[i]);
+            }
+            STOP_TIMING(single);
+        }
+
+        vector<RecognitionResult> results;
+        DECLARE_TIMING(batched);
+        for (int r = 0; r < repetitions; r++) {
+            START_TIMING(batched);
+            batchRecognizer.recognize(batch, results);
+            STOP_TIMING(batched);
+        }
+
+        int sameLabel = 0;
+        double maxSimilarityDiff = 0;
+        for (int i = 0; i < batchSize; i++) {
+            if (results[i].label == singleLabels[i])
+                sameLabel++;
+            maxSimilarityDiff = MAX(maxSimilarityDiff, fabs(results[i].similarity - singleSimilarities[i]));
+        }
+
+        double singleRate = batchSize / MAX(GET_AVERAGE_TIMING(single) * 0.001, 1e-9);
+        double batchRate = batchSize / MAX(GET_AVERAGE_TIMING(batched) * 0.001, 1e-9);
+        LOG("%s batch of %d: one by one = %.0f faces/s, batched = %.0f faces/s (%.1fx), same label for %d of %d faces, max similarity difference = %g",
+            name, batchSize, singleRate, batchRate, batchRate / singleRate, sameLabel, batchSize, maxSimilarityDiff);
+    }
+}
+
+// Treina o FastEigenfaces mantendo apenas parte dos componentes (por fração da variância explicada ou por um número máximo),
+// e mede a precisão e a latência de reconhecer cada rosto (projeção + busca na galeria, e a reconstrução usada por getSimilarity()).
+void benchmarkComponents(const vector<Mat> &trainFaces, const vector<int> &trainLabels, const vector<Mat> &testFaces, const vector<int> &testLabels, int repetitions)
+{
+    double variances[] = {0.0, 0.99, 0.95, 0.9, 0.8, 0.0, 0.0, 0.0, 0.0};
+    int maxComponents[] = {0, 0, 0, 0, 0, 64, 32, 16, 8};
+    int n = (int)testFaces.size();
+    for (int c = 0; c < 9; c++) {
+        Ptr<FaceRecognizer> model = createFastEigenFaceRecognizer(maxComponents[c]);
+        model->set("variance", variances[c]);
+        DECLARE_TIMING(train);
+        START_TIMING(train);
+        model->train(trainFaces, trainLabels);
+        STOP_TIMING(train);
+
+        DECLARE_TIMING(predict);
+        DECLARE_TIMING(reconstruct);
+        int correct = 0;
+        for (int r = 0; r < repetitions; r++) {
+            START_TIMING(predict);
+            for (int i = 0; i < n; i++) {
+                int label = model->predict(testFaces[i]);
+                if (r == 0 && label == testLabels[i])
+                    correct++;
+            }
+            STOP_TIMING(predict);
+            START_TIMING(reconstruct);
+            for (int i = 0; i < n; i++)
+                reconstructFace(model, testFaces[i]);
+            STOP_TIMING(reconstruct);
+        }
+
+        char setting[64];
+        if (variances[c] > 0)
+            snprintf(setting, sizeof(setting), "variance %.0f%%", variances[c] * 100);
+        else if (maxComponents[c] > 0)
+            snprintf(setting, sizeof(setting), "at most %d components", maxComponents[c]);
+        else
+            snprintf(setting, sizeof(setting), "all components");
+        LOG("FastEigenfaces with %s: %d components, trained in %.1fms, accuracy = %.1f%% (%d of %d), predict ave=%.1fus, reconstruct ave=%.1fus per face",
+            setting, model->get<Mat>("eigenvectors").cols, GET_TIMING(train), 100.0 * correct / n, correct, n,
+            1000.0 * GET_AVERAGE_TIMING(predict) / n, 1000.0 * GET_AVERAGE_TIMING(reconstruct) / n);
+    }
+}
+
+// Compara o LBPH do OpenCV com o FastLBPH: tempo de treinamento, precisão, e tempo para reconhecer cada rosto. Para o FastLBPH,
+// também mostra quanto desse tempo é o histograma do rosto e quanto é a distância para toda a galeria.
+void benchmarkLBPH(const vector<Mat> &trainFaces, const vector<int> &trainLabels, const vector<Mat> &testFaces, const vector<int> &testLabels, int repetitions)
+{
+    Ptr<FaceRecognizer> models[] = {createLBPHFaceRecognizer(), createFastLBPHFaceRecognizer()};
+    const char *names[] = {"LBPH", "FastLBPH"};
+    int n = (int)testFaces.size();
+    for (int m = 0; m < 2; m++) {
+        DECLARE_TIMING(train);
+        START_TIMING(train);
+        models[m]->train(trainFaces, trainLabels);
+        STOP_TIMING(train);
+
+        DECLARE_TIMING(predict);
+        int correct = 0;
+        for (int r = 0; r < repetitions; r++) {
+            START_TIMING(predict);
+            for (int i = 0; i < n; i++) {
+                int label = models[m]->predict(testFaces[i]);
+                if (r == 0 && label == testLabels[i])
+                    correct++;
+            }
+            STOP_TIMING(predict);
+        }
+        LOG("%s: trained in %.1fms, accuracy = %.1f%% (%d of %d), predict ave=%.1fus per face",
+            names[m], GET_TIMING(train), 100.0 * correct / n, correct, n, 1000.0 * GET_AVERAGE_TIMING(predict) / n);
+    }
+
+    FastLBPH &fastLBPH = *(FastLBPH*)(FaceRecognizer*)models[1];
+    vector<Mat> histograms(n);
+    vector<float> distances;
+    DECLARE_TIMING(histogram);
+    DECLARE_TIMING(distance);
+    for (int r = 0; r < repetitions; r++) {
+        START_TIMING(histogram);
+        for (int i = 0; i < n; i++)
+            histograms[i] = fastLBPH.computeHistogram(testFaces[i]);
+        STOP_TIMING(histogram);
+        START_TIMING(distance);
+        for (int i = 0; i < n; i++)
+            fastLBPH.computeDistances(histograms[i], distances);
+        STOP_TIMING(distance);
+    }
+    LOG("FastLBPH: histogram ave=%.1fus, chi-square to %d gallery faces ave=%.1fus per face",
+        1000.0 * GET_AVERAGE_TIMING(histogram) / n, (int)trainFaces.size(), 1000.0 * GET_AVERAGE_TIMING(distance) / n);
+}
+
+// Calibra o limite de distância do LBPH e do FastLBPH para o main.cpp. 1 de cada UNKNOWN_EVERY pessoas fica fora do treinamento, e os
+// rostos de teste dessa pessoa são as pessoas desconhecidas. Mostra o limite que aceita KNOWN_ACCEPTED dos rostos de teste das pessoas
+// conhecidas reconhecidos corretamente, e quantos rostos conhecidos são aceitos e desconhecidos são rejeitados com esse limite e com o
+// limite do main.cpp.
+void benchmarkUnknownThreshold(const vector<Mat> &trainFaces, const vector<int> &trainLabels, const vector<Mat> &testFaces, const vector<int> &testLabels)
+{
+    vector<int> persons;
+    for (size_t i = 0; i < trainLabels.size(); i++) {
+        if (find(persons.begin(), persons.end(), trainLabels[i]) == persons.end())
+            persons.push_back(trainLabels[i]);
+    }
+    vector<int> unknownPersons;
+    for (size_t p = UNKNOWN_EVERY - 1; p < persons.size(); p += UNKNOWN_EVERY)
+        unknownPersons.push_back(persons[p]);
+    if (unknownPersons.empty() || unknownPersons.size() == persons.size()) {
+        LOG("Unknown person threshold: needs at least %d people.", UNKNOWN_EVERY);
+        return;
+    }
+    vector<Mat> knownFaces;
+    vector<int> knownLabels;
+    for (size_t i = 0; i < trainFaces.size(); i++) {
+        if (find(unknownPersons.begin(), unknownPersons.end(), trainLabels[i]) == unknownPersons.end()) {
+            knownFaces.push_back(trainFaces[i]);
+            knownLabels.push_back(trainLabels[i]);
+        }
+    }
+
+    Ptr<FaceRecognizer> models[] = {createLBPHFaceRecognizer(), createFastLBPHFaceRecognizer()};
+    const char *names[] = {"LBPH", "FastLBPH"};
+    const double currentThresholds[] = {UNKNOWN_PERSON_LBPH_THRESHOLD, UNKNOWN_PERSON_FASTLBPH_THRESHOLD};
+    for (int m = 0; m < 2; m++) {
+        models[m]->train(knownFaces, knownLabels);
+        vector<double> knownDistances, unknownDistances;
+        for (size_t i = 0; i < testFaces.size(); i++) {
+            int label;
+            double distance;
+            models[m]->predict(testFaces[i], label, distance);
+            if (find(unknownPersons.begin(), unknownPersons.end(), testLabels[i]) != unknownPersons.end())
+                unknownDistances.push_back(distance);
+            else if (label == testLabels[i])
+                knownDistances.push_back(distance);
+        }
+        if (knownDistances.empty() || unknownDistances.empty())
+            continue;
+        sort(knownDistances.begin(), knownDistances.end());
+        double suggested = knownDistances[min((size_t)(KNOWN_ACCEPTED * knownDistances.size()), knownDistances.size() - 1)];
+        double thresholds[] = {suggested, currentThresholds[m]};
+        const char *thresholdNames[] = {"suggested", "main.cpp"};
+        for (int t = 0; t < 2; t++) {
+            int accepted = 0, rejected = 0;
+            for (size_t i = 0; i < knownDistances.size(); i++)
+                accepted += (knownDistances[i] < thresholds[t]) ? 1 : 0;
+            for (size_t i = 0; i < unknownDistances.size(); i++)
+                rejected += (unknownDistances[i] >= thresholds[t]) ? 1 : 0;
+            LOG("%s: %-9s threshold %8.2f accepts %.1f%% of the known faces and rejects %.1f%% of the %d unknown faces.", names[m], thresholdNames[t],
+                thresholds[t], 100.0 * accepted / knownDistances.size(), 100.0 * rejected / unknownDistances.size(), (int)unknownDistances.size());
+        }
+    }
+}
+
+// Compara, para cada algoritmo, o reconhecimento de um rosto como o main.cpp fazia (reconstructFace() + getSimilarity() + predict(),
+// buscando as propriedades do modelo pelo nome a cada rosto) com o RecognizerBackend genérico e o especializado para o tamanho do rosto,
+// e para FastEigenfaces e FastFisherfaces também o backend com os autovetores float16 e int8.
+void benchmarkBackends(const vector<Mat> &trainFaces, const vector<int> &trainLabels, const vector<Mat> &testFaces, int repetitions)
+{
+    const char *algorithms[] = {"FaceRecognizer.Eigenfaces", "FaceRecognizer.FastEigenfaces", "FaceRecognizer.FastFisherfaces", "FaceRecognizer.FastLBPH"};
+    int n = (int)testFaces.size();
+    for (int a = 0; a < 4; a++) {
+        Ptr<FaceRecognizer> model = learnCollectedFaces(trainFaces, trainLabels, algorithms[a]);
+        if (model.empty())
+            continue;
+        std::shared_ptr<RecognizerBackend> backends[] = {createRecognizerBackend(model, algorithms[a], trainFaces[0].size(), false),
+                                                         createRecognizerBackend(model, algorithms[a], trainFaces[0].size())};
+
+        vector<int> labels(n);
+        DECLARE_TIMING(properties);
+        for (int r = 0; r < repetitions; r++) {
+            START_TIMING(properties);
+            for (int i = 0; i < n; i++) {
+                Mat reconstructedFace = reconstructFace(model, testFaces[i]);
+                getSimilarity(testFaces[i], reconstructedFace);
+                labels[i] = model->predict(testFaces[i]);
+            }
+            STOP_TIMING(properties);
+        }
+        LOG("%s through the FaceRecognizer properties: ave=%.1fus per face", algorithms[a], 1000.0 * GET_AVERAGE_TIMING(properties) / n);
+
+        for (int b = 0; b < 2; b++) {
+            int sameLabel = 0;
+            DECLARE_TIMING(backend);
+            for (int r = 0; r < repetitions; r++) {
+                START_TIMING(backend);
+                for (int i = 0; i < n; i++) {
+                    RecognitionResult result = backends[b]->recognize(testFaces[i]);
+                    if (r == 0 && result.label == labels[i])
+                        sameLabel++;
+                }
+                STOP_TIMING(backend);
+            }
+            LOG("%s with the %s backend: ave=%.1fus per face, same label for %d of %d faces",
+                algorithms[a], backends[b]->isFixedSize() ? "fixed-size" : "generic", 1000.0 * GET_AVERAGE_TIMING(backend) / n, sameLabel, n);
+        }
+
+        // Com os autovetores quantizados, o backend deve dar o mesmo resultado que o predict() quantizado do modelo.
+        if (!dynamic_cast<FastSubspaceFaceRecognizer*>((FaceRecognizer*)model))
+            continue;
+        for (int q = PROJECTION_FLOAT16; q <= PROJECTION_INT8; q++) {
+            model->set("quantization", q);
+            std::shared_ptr<RecognizerBackend> backend = createRecognizerBackend(model, algorithms[a], trainFaces[0].size());
+            for (int i = 0; i < n; i++)
+                labels[i] = model->predict(testFaces[i]);
+            int sameLabel = 0;
+            DECLARE_TIMING(quantized);
+            for (int r = 0; r < repetitions; r++) {
+                START_TIMING(quantized);
+                for (int i = 0; i < n; i++) {
+                    RecognitionResult result = backend->recognize(testFaces[i]);
+                    if (r == 0 && result.label == labels[i])
+                        sameLabel++;
+                }
+                STOP_TIMING(quantized);
+            }
+            LOG("%s with the %s backend and %s eigenvectors: ave=%.1fus per face, same label as the quantized predict() for %d of %d faces",
+                algorithms[a], backend->isFixedSize() ? "fixed-size" : "generic", QUANTIZATION_NAMES[q], 1000.0 * GET_AVERAGE_TIMING(quantized) / n, sameLabel, n);
+        }
+        model->set("quantization", (int)PROJECTION_FLOAT32);
+    }
+}
+
+// Simula a coleta de rostos do main.cpp, em que a câmera vê cada rosto várias vezes com pequenas diferenças, e compara a galeria
+// sem o GalleryDedupIndex e com várias distâncias mínimas: quantos rostos são guardados, quanto tempo o treinamento (com os rostos
+// espelhados, como no main.cpp) leva, e a precisão.
+void benchmarkDedup(const vector<Mat> &trainFaces, const vector<int> &trainLabels, const vector<Mat> &testFaces, const vector<int> &testLabels)
+{
+    RNG rng(54321);
+    vector<Mat> stream;
+    vector<int> streamLabels;
+    for (size_t i = 0; i < trainFaces.size(); i++) {
+        for (int c = 0; c <= DUPLICATES_PER_FACE; c++) {
+            Mat face = trainFaces[i];
+            if (c > 0) {
+                Mat noise = Mat(face.size(), CV_16S);
+                rng.fill(noise, RNG::NORMAL, 0, 2);
+                Mat noisy;
+                add(face, noise, noisy, noArray(), CV_8U);
+                face = noisy;
+            }
+            stream.push_back(face);
+            streamLabels.push_back(trainLabels[i]);
+        }
+    }
+
+    double minDistances[] = {0.0, 0.05, 0.1, 0.2};
+    for (int m = 0; m < 4; m++) {
+        GalleryDedupIndex dedup(minDistances[m]);
+        vector<Mat> gallery;
+        vector<int> galleryLabels;
+        for (size_t i = 0; i < stream.size(); i++) {
+            if (minDistances[m] > 0 && !dedup.addIfDiverse(stream[i], streamLabels[i]))
+                continue;
+            gallery.push_back(stream[i]);
+            galleryLabels.push_back(streamLabels[i]);
+        }
+
+        Ptr<FaceRecognizer> model = createFastEigenFaceRecognizer();
+        model->set("mirror", true);
+        DECLARE_TIMING(train);
+        START_TIMING(train);
+        model->train(gallery, galleryLabels);
+        STOP_TIMING(train);
+        int correct = 0;
+        for (size_t i = 0; i < testFaces.size(); i++) {
+            if (model->predict(testFaces[i]) == testLabels[i])
+                correct++;
+        }
+        char setting[64];
+        if (minDistances[m] > 0)
+            snprintf(setting, sizeof(setting), "dedup distance %.2f", minDistances[m]);
+        else
+            snprintf(setting, sizeof(setting), "no dedup");
+        LOG("Collection with %s: %d of %d faces kept, trained with %d faces in %.1fms, accuracy = %.1f%% (%d of %d)",
+            setting, (int)gallery.size(), (int)stream.size(), 2 * (int)gallery.size(), GET_TIMING(train),
+            100.0 * correct / testFaces.size(), correct, (int)testFaces.size());
+    }
+}
+
+// Memória usada pelas imagens de uma galeria: os pixels mais o cabeçalho de cada Mat e seu contador de referências.
+size_t getGalleryBytes(const vector<Mat> &gallery)
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < gallery.size(); i++)
+        bytes += gallery[i].total() * gallery[i].elemSize() + sizeof(Mat) + sizeof(int);
+    return bytes;
+}
+
+// Compara o treinamento com as cópias espelhadas guardadas na galeria (como o main.cpp fazia) com o treinamento em que o FastEigenfaces
+// e o FastFisherfaces leem os rostos espelhados dos originais: memória da galeria, tempo de treinamento e precisão.
+void benchmarkMirroring(const vector<Mat> &trainFaces, const vector<int> &trainLabels, const vector<Mat> &testFaces, const vector<int> &testLabels, int repetitions)
+{
+    vector<Mat> storedGallery = trainFaces;
+    vector<int> storedLabels = trainLabels;
+    for (size_t i = 0; i < trainFaces.size(); i++) {
+        Mat mirroredFace;
+        flip(trainFaces[i], mirroredFace, 1);
+        storedGallery.push_back(mirroredFace);
+        storedLabels.push_back(trainLabels[i]);
+    }
+
+    const char *algorithms[] = {"FastEigenfaces", "FastFisherfaces"};
+    for (int a = 0; a < 2; a++) {
+        Ptr<FaceRecognizer> models[2];
+        double trainingMs[2];
+        for (int v = 0; v < 2; v++) {
+            models[v] = (a == 0) ? createFastEigenFaceRecognizer() : createFastFisherFaceRecognizer();
+            models[v]->set("mirror", v == 1);
+            DECLARE_TIMING(train);
+            for (int r = 0; r < repetitions; r++) {
+                START_TIMING(train);
+                if (v == 0)
+                    models[v]->train(storedGallery, storedLabels);
+                else
+                    models[v]->train(trainFaces, trainLabels);
+                STOP_TIMING(train);
+            }
+            trainingMs[v] = GET_AVERAGE_TIMING(train);
+        }
+
+        int correct[2] = {0, 0};
+        int sameLabel = 0;
+        for (size_t i = 0; i < testFaces.size(); i++) {
+            int labels[2] = {models[0]->predict(testFaces[i]), models[1]->predict(testFaces[i])};
+            for (int v = 0; v < 2; v++) {
+                if (labels[v] == testLabels[i])
+                    correct[v]++;
+            }
+            if (labels[0] == labels[1])
+                sameLabel++;
+        }
+        int n = (int)testFaces.size();
+        LOG("%s with stored mirrored copies: gallery = %d KB, training ave=%.1fms, accuracy = %.1f%%",
+            algorithms[a], (int)(getGalleryBytes(storedGallery) / 1024), trainingMs[0], 100.0 * correct[0] / n);
+        LOG("%s with mirrored faces read on the fly: gallery = %d KB, training ave=%.1fms, accuracy = %.1f%%, same label for %d of %d faces",
+            algorithms[a], (int)(getGalleryBytes(trainFaces) / 1024), trainingMs[1], 100.0 * correct[1] / n, sameLabel, n);
+    }
+}
+
+// Compara a galeria em vector<Mat> (como o main.cpp fazia) com o FaceGallery: memória, tempo para adicionar os rostos, para percorrer
+// todos os rostos (a soma das diferenças para um rosto), para treinar a partir da galeria, e para apagar uma pessoa.
+// Também verifica se a galeria salva e carregada de volta tem os mesmos rostos.
+void benchmarkGallery(const vector<Mat> &trainFaces, const vector<int> &trainLabels, int repetitions)
+{
+    int n = (int)trainFaces.size();
+    Mat probe = trainFaces[0];
+
+    vector<Mat> faces;
+    vector<int> labels;
+    FaceGallery gallery(trainFaces[0].size());
+    DECLARE_TIMING(addVector);
+    DECLARE_TIMING(addGallery);
+    for (int r = 0; r < repetitions; r++) {
+        faces.clear();
+        labels.clear();
+        START_TIMING(addVector);
+        for (int i = 0; i < n; i++) {
+            faces.push_back(trainFaces[i].clone());
+            labels.push_back(trainLabels[i]);
+        }
+        STOP_TIMING(addVector);
+        gallery.clear();
+        START_TIMING(addGallery);
+        for (int i = 0; i < n; i++)
+            gallery.add(trainFaces[i], trainLabels[i]);
+        STOP_TIMING(addGallery);
+    }
+
+    double sums[2] = {0, 0};
+    DECLARE_TIMING(scanVector);
+    DECLARE_TIMING(scanGallery);
+    for (int r = 0; r < repetitions; r++) {
+        START_TIMING(scanVector);
+        sums[0] = 0;
+        for (int i = 0; i < n; i++)
+            sums[0] += norm(faces[i], probe, NORM_L1);
+        STOP_TIMING(scanVector);
+        START_TIMING(scanGallery);
+        sums[1] = 0;
+        for (int i = 0; i < n; i++)
+            sums[1] += norm(gallery.getFace(i), probe, NORM_L1);
+        STOP_TIMING(scanGallery);
+    }
+
+    vector<Mat> views;
+    vector<int> viewLabels;
+    gallery.getFaces(views, viewLabels);
+    Ptr<FaceRecognizer> model = createFastEigenFaceRecognizer();
+    DECLARE_TIMING(trainVector);
+    DECLARE_TIMING(trainGallery);
+    START_TIMING(trainVector);
+    model->train(faces, labels);
+    STOP_TIMING(trainVector);
+    START_TIMING(trainGallery);
+    model->train(views, viewLabels);
+    STOP_TIMING(trainGallery);
+
+    size_t vectorBytes = 0;
+    for (int i = 0; i < n; i++)
+        vectorBytes += faces[i].total() + sizeof(Mat) + sizeof(int);
+    LOG("Gallery of %d faces as vector<Mat>: %d KB, add all ave=%.2fms, scan all ave=%.2fms, train %.1fms",
+        n, (int)(vectorBytes / 1024), GET_AVERAGE_TIMING(addVector), GET_AVERAGE_TIMING(scanVector), GET_TIMING(trainVector));
+    LOG("Gallery of %d faces as FaceGallery: %d KB, add all ave=%.2fms, scan all ave=%.2fms, train %.1fms, same scan result: %s",
+        n, (int)(gallery.getAllocatedBytes() / 1024), GET_AVERAGE_TIMING(addGallery), GET_AVERAGE_TIMING(scanGallery), GET_TIMING(trainGallery),
+        (sums[0] == sums[1]) ? "yes" : "NO");
+
+    // Apaga a primeira pessoa: a galeria só esquece seus intervalos, e compacta o atlas quando metade dos slots estão livres.
+    DECLARE_TIMING(removePerson);
+    START_TIMING(removePerson);
+    gallery.removePerson(trainLabels[0]);
+    STOP_TIMING(removePerson);
+    DECLARE_TIMING(compact);
+    START_TIMING(compact);
+    gallery.compact();
+    STOP_TIMING(compact);
+
+    const char *filename = "benchRecognition_gallery.bin";
+    bool same = gallery.save(filename);
+    FaceGallery loaded;
+    same = same && loaded.load(filename) && loaded.size() == gallery.size();
+    for (int i = 0; same && i < gallery.size(); i++)
+        same = loaded.getLabel(i) == gallery.getLabel(i) && norm(loaded.getFace(i), gallery.getFace(i), NORM_INF) == 0;
+    remove(filename);
+    LOG("FaceGallery: remove person ave=%.3fms, compact ave=%.3fms, %d faces left, saved and loaded back the same faces: %s",
+        GET_TIMING(removePerson), GET_TIMING(compact), gallery.size(), same ? "yes" : "NO");
+}
+
+// Remove uma pessoa e depois junta outras duas no modelo publicado, com TrainingEngine::removePerson() e relabelPerson(), enquanto outra
+// thread continua reconhecendo os rostos de teste com o modelo atual, como o loop do main.cpp. Verifica que nenhum modelo publicado
+// depois da remoção reconhece a pessoa removida (nem a pessoa juntada pelo nome antigo), e compara o tempo da atualização do modelo
+// com o tempo de treinar de novo sem a pessoa. Retorna false se a pessoa removida ou juntada foi reconhecida (ou se o treinamento falhou).
+bool benchmarkPersonRemoval(const char *facerecAlgorithm, const vector<Mat> &trainFaces, const vector<int> &trainLabels, const vector<Mat> &testFaces, const vector<int> &testLabels)
+{
+    RecognizerHandle handle;
+    TrainingEngine engine(handle);
+    engine.startTraining(trainFaces, trainLabels, facerecAlgorithm);
+    while (engine.isTraining())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::shared_ptr<const RecognizerModel> trained = handle.get();
+    if (!trained) {
+        LOG("%s: training failed, skipping the person removal.", facerecAlgorithm);
+        return false;
+    }
+
+    // A primeira pessoa é removida, e a segunda é juntada à terceira.
+    vector<int> persons;
+    for (size_t i = 0; i < trainLabels.size(); i++) {
+        if (find(persons.begin(), persons.end(), trainLabels[i]) == persons.end())
+            persons.push_back(trainLabels[i]);
+    }
+    if (persons.size() < 4) {
+        LOG("%s: needs at least 4 people to test the person removal.", facerecAlgorithm);
+        return false;
+    }
+    int removedLabel = persons[0];
+    int mergedLabel = persons[1];
+    int mergeTarget = persons[2];
+
+    // As versões dos modelos que serão publicados pela remoção e pela junção.
+    const int removedVersion = trained->version + 1;
+    const int mergedVersion = trained->version + 2;
+    std::atomic<bool> stop(false);
+    std::atomic<int> recognitions(0);
+    std::atomic<int> removedRecognitions(0);
+    std::atomic<int> mergedRecognitions(0);
+    std::atomic<int> violations(0);
+    std::thread recognizer([&]() {
+        while (!stop) {
+            for (size_t i = 0; i < testFaces.size() && !stop; i++) {
+                std::shared_ptr<const RecognizerModel> model = handle.get();
+                if (!model || !model->backend)
+                    continue;
+                RecognitionResult result = model->backend->recognize(testFaces[i]);
+                recognitions++;
+                if (model->version >= removedVersion)
+                    removedRecognitions++;
+                if (model->version >= mergedVersion)
+                    mergedRecognitions++;
+                if ((model->version >= removedVersion && result.label == removedLabel) || (model->version >= mergedVersion && result.label == mergedLabel))
+                    violations++;
+            }
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    DECLARE_TIMING(removePerson);
+    START_TIMING(removePerson);
+    bool downdated = engine.removePerson(removedLabel);
+    STOP_TIMING(removePerson);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    DECLARE_TIMING(mergePerson);
+    START_TIMING(mergePerson);
+    engine.relabelPerson(mergedLabel, mergeTarget);
+    STOP_TIMING(mergePerson);
+    // Espera a outra thread reconhecer alguns rostos com o modelo da junção, senão o teste não verificou nada.
+    for (int waited = 0; mergedRecognitions < 10 && waited < 2000; waited++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    stop = true;
+    recognizer.join();
+
+    std::shared_ptr<const RecognizerModel> model = handle.get();
+    if (!model || !model->backend || model->version < mergedVersion) {
+        LOG("%s: the removal and the merge did not publish new models.", facerecAlgorithm);
+        return false;
+    }
+    if (removedRecognitions == 0 || mergedRecognitions == 0) {
+        LOG("%s: no face was recognized after the removal (%d) or after the merge (%d), so nothing was tested.",
+            facerecAlgorithm, (int)removedRecognitions, (int)mergedRecognitions);
+        return false;
+    }
+
+    // Todos os rostos de teste com o modelo final, incluindo os da pessoa removida: nenhum pode voltar com os nomes que sumiram.
+    // A precisão conta só as outras pessoas, com a pessoa juntada reconhecida pelo novo nome.
+    int correct = 0, total = 0;
+    for (size_t i = 0; i < testFaces.size(); i++) {
+        int label = model->backend->recognize(testFaces[i]).label;
+        if (label == removedLabel || label == mergedLabel)
+            violations++;
+        if (testLabels[i] == removedLabel)
+            continue;
+        int expected = (testLabels[i] == mergedLabel) ? mergeTarget : testLabels[i];
+        correct += (label == expected) ? 1 : 0;
+        total++;
+    }
+
+    // O mesmo que treinar de novo a galeria sem a pessoa.
+    vector<Mat> faces;
+    vector<int> labels;
+    for (size_t i = 0; i < trainFaces.size(); i++) {
+        if (trainLabels[i] != removedLabel) {
+            faces.push_back(trainFaces[i]);
+            labels.push_back(trainLabels[i]);
+        }
+    }
+    DECLARE_TIMING(retrain);
+    START_TIMING(retrain);
+    learnCollectedFaces(faces, labels, facerecAlgorithm);
+    STOP_TIMING(retrain);
+
+    LOG("%s: removed a person in %.2fms (%s), merged two people in %.2fms, retraining without the person takes %.1fms.",
+        facerecAlgorithm, GET_TIMING(removePerson), downdated ? "gallery downdated" : "results relabeled", GET_TIMING(mergePerson), GET_TIMING(retrain));
+    LOG("%s: %d faces recognized during the changes (%d after the removal, %d after the merge), removed or merged person returned %d times (must be 0), accuracy afterwards %.1f%%.",
+        facerecAlgorithm, (int)recognitions, (int)removedRecognitions, (int)mergedRecognitions, (int)violations, 100.0 * correct / MAX(total, 1));
+    return violations == 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    vector<Mat> faces;
+    vector<int> labels;
+    bool checkPersonRemoval = (argc > 1 && string(argv[1]) == "--check-person-removal");
+    if (argc > 1 && !checkPersonRemoval) {
+        if (!loadDataset(argv[1], faces, labels))
+            return 1;
+    }
+    else {
+        makeSyntheticDataset(faces, labels);
+    }
+    int repetitions = DEFAULT_REPETITIONS;
+    if (argc > 2) {
+        repetitions = MAX(atoi(argv[2]), 1);
+    }
+
+    vector<Mat> trainFaces, testFaces;
+    vector<int> trainLabels, testLabels;
+    splitDataset(faces, labels, trainFaces, trainLabels, testFaces, testLabels);
+
+    cout << "Compiled with OpenCV version " << CV_VERSION << ", using " << getNumThreads() << " threads." << endl;
+    cout << trainFaces.size() << " training faces and " << testFaces.size() << " test faces of " << FACE_SIZE << "x" << FACE_SIZE << " pixels." << endl << endl;
+
+    // A remoção de pessoas é uma verificação, não só uma medida: o programa falha se a pessoa removida ainda for reconhecida.
+    const char *removalAlgorithms[] = {"FaceRecognizer.FastEigenfaces", "FaceRecognizer.FastLBPH", "FaceRecognizer.Eigenfaces"};
+    bool removalOk = true;
+    if (checkPersonRemoval) {
+        for (int a = 0; a < 3; a++)
+            removalOk = benchmarkPersonRemoval(removalAlgorithms[a], trainFaces, trainLabels, testFaces, testLabels) && removalOk;
+        return removalOk ? 0 : 1;
+    }
+
+    FastEigenfaces eigenfaces;
+    FastFisherfaces fisherfaces;
+    FastSubspaceFaceRecognizer *models[] = {&eigenfaces, &fisherfaces};
+    const char *names[] = {"FastEigenfaces", "FastFisherfaces"};
+    for (int m = 0; m < 2; m++) {
+        DECLARE_TIMING(train);
+        START_TIMING(train);
+        models[m]->train(trainFaces, trainLabels);
+        STOP_TIMING(train);
+        LOG("%s: trained in %.1fms, %d components.", names[m], GET_TIMING(train), models[m]->get<Mat>("eigenvectors").cols);
+        benchmarkQuantization(names[m], *models[m], testFaces, testLabels, repetitions);
+    }
+
+    // O reconhecimento em lotes com os modelos do OpenCV, que usam CV_64F, e com os modelos rápidos.
+    Ptr<FaceRecognizer> batchModels[] = {createEigenFaceRecognizer(), createFisherFaceRecognizer(), createFastEigenFaceRecognizer(), createFastFisherFaceRecognizer()};
+    const char *batchNames[] = {"Eigenfaces", "Fisherfaces", "FastEigenfaces", "FastFisherfaces"};
+    for (int m = 0; m < 4; m++) {
+        batchModels[m]->train(trainFaces, trainLabels);
+        benchmarkBatch(batchNames[m], batchModels[m], testFaces, repetitions);
+    }
+
+    benchmarkComponents(trainFaces, trainLabels, testFaces, testLabels, repetitions);
+    benchmarkLBPH(trainFaces, trainLabels, testFaces, testLabels, repetitions);
+    benchmarkUnknownThreshold(trainFaces, trainLabels, testFaces, testLabels);
+    benchmarkBackends(trainFaces, trainLabels, testFaces, repetitions);
+    benchmarkDedup(trainFaces, trainLabels, testFaces, testLabels);
+    benchmarkMirroring(trainFaces, trainLabels, testFaces, testLabels, repetitions);
+    benchmarkGallery(trainFaces, trainLabels, repetitions);
+    for (int a = 0; a < 3; a++)
+        removalOk = benchmarkPersonRemoval(removalAlgorithms[a], trainFaces, trainLabels, testFaces, testLabels) && removalOk;
+
+    return removalOk ? 0 : 1;
+}
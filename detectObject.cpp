@@ -1,9 +1,14 @@
 #include "detectObject.h"
+#include "skinDetection.h"     // Encontra as regiões com cor de pele, para reduzir a área onde o detector procura.
+
+// Se as regiões de pele cobrem mais do que essa fração da imagem, é mais rápido procurar na imagem toda de uma vez.
+const double MAX_SKIN_AREA_FRACTION = 0.6;
 
 // Procurar por objetos, como rostos na imagem usando os parâmetros dados, armazenando o cv::Rects em 'objetcs'.
 // Pode usar Haar cascades ou LBP cascades para detecção de rosto, ou mesmo olho, boca, ou a detecção de carro.
 // A entrada é temporariamente reduzido para 'scaledWidth' para a detecção mais rápida, uma vez que 200 é o suficiente para encontrar rostos.
-void detectObjectsCustom(const Mat &img, CascadeClassifier &cascade, vector<Rect> &objects, int scaledWidth, int flags, Size minFeatureSize, float searchScaleFactor, int minNeighbors)
+// 'minFeatureSize' e 'maxFeatureSize' são medidos na imagem reduzida, e um 'maxFeatureSize' vazio não limita o tamanho dos objetos.
+void detectObjectsCustom(const Mat &img, CascadeClassifier &cascade, vector<Rect> &objects, int scaledWidth, int flags, Size minFeatureSize, Size maxFeatureSize, float searchScaleFactor, int minNeighbors)
 {
     // Se a imagem de entrada não está em tons de cinza, em seguida, converter a imagem colorida BGR ou BGRA em tons de cinza.
     Mat gray;
@@ -36,7 +41,7 @@ void detectObjectsCustom(const Mat &img, CascadeClassifier &cascade, vector<Rect
     equalizeHist(inputImg, equalizedImg);
 
     // Detectar objetos na pequena imagem em tons de cinza.
-    cascade.detectMultiScale(equalizedImg, objects, searchScaleFactor, minNeighbors, flags, minFeatureSize);
+    cascade.detectMultiScale(equalizedImg, objects, searchScaleFactor, minNeighbors, flags, minFeatureSize, maxFeatureSize);
 
     // Aumentar os resultados se a imagem foi temporariamente reduzido antes da detecção.
     if (img.cols > scaledWidth) {
@@ -63,17 +68,66 @@ void detectObjectsCustom(const Mat &img, CascadeClassifier &cascade, vector<Rect
     // Retorna com os retângulos de rosto detectados armazenados em "objetcs".
 }
 
+// Igual a detectObjectsCustom(), mas procura apenas dentro das regiões com cor de pele da imagem colorida.
+// Cada região é reduzida com a mesma escala que a imagem toda seria, então os mesmos tamanhos de objeto são encontrados,
+// mas o detector só precisa procurar em uma fração da imagem (já que normalmente a maior parte da imagem é o fundo).
+void detectObjectsInSkinRegions(const Mat &img, CascadeClassifier &cascade, vector<Rect> &objects, int scaledWidth, int flags, Size minFeatureSize, Size maxFeatureSize, float searchScaleFactor, int minNeighbors)
+{
+    vector<Rect> skinRegions;
+    double skinFraction = detectSkinRegions(img, skinRegions);
+    if (skinFraction > MAX_SKIN_AREA_FRACTION) {
+        detectObjectsCustom(img, cascade, objects, scaledWidth, flags, minFeatureSize, maxFeatureSize, searchScaleFactor, minNeighbors);
+        return;
+    }
+
+    // A mesma escala que detectObjectsCustom() usaria para a imagem toda.
+    float scale = 1.0f;
+    if (img.cols > scaledWidth)
+        scale = img.cols / (float)scaledWidth;
+
+    objects.clear();
+    for (int i = 0; i < (int)skinRegions.size(); i++) {
+        Rect region = skinRegions[i];
+        // Ignora as regiões onde nem o menor objeto caberia.
+        if (region.width < minFeatureSize.width * scale || region.height < minFeatureSize.height * scale)
+            continue;
+
+        vector<Rect> regionObjects;
+        int regionScaledWidth = cvRound(region.width / scale);
+        detectObjectsCustom(img(region), cascade, regionObjects, regionScaledWidth, flags, minFeatureSize, maxFeatureSize, searchScaleFactor, minNeighbors);
+
+        // Converte os resultados para as coordenadas da imagem toda.
+        for (int j = 0; j < (int)regionObjects.size(); j++) {
+            regionObjects[j].x += region.x;
+            regionObjects[j].y += region.y;
+            objects.push_back(regionObjects[j]);
+        }
+    }
+
+    // Quando procurando apenas o maior objeto, retorna o maior entre todas as regiões.
+    if ((flags & CASCADE_FIND_BIGGEST_OBJECT) && objects.size() > 1) {
+        int largest = 0;
+        for (int i = 1; i < (int)objects.size(); i++) {
+            if (objects[i].area() > objects[largest].area())
+                largest = i;
+        }
+        Rect largestObject = objects[largest];
+        objects.clear();
+        objects.push_back(largestObject);
+    }
+}
+
 
 // Procurar por apenas um único objeto na imagem, tais como a maior cara, armazenando o resultado na 'largestObject'.
 // Pode usar Haar cascades ou LBP cascades para detecção de rosto, ou mesmo olho, boca, ou a detecção de carro.
 // A entrada é temporariamente reduzido para 'scaledWidth' para a detecção mais rápida, uma vez que 200 é o suficiente para encontrar rostos.
+// Se 'useSkinFilter' é verdade, procura apenas nas regiões com cor de pele (veja detectObjectsInSkinRegions()).
+// Só procura objetos entre 'minFeatureSize' e 'maxFeatureSize' (na imagem reduzida), e um 'maxFeatureSize' vazio não tem limite.
 // Nota: detectLargestObject () deve ser mais rápido do que detectManyObjects ().
-void detectLargestObject(const Mat &img, CascadeClassifier &cascade, Rect &largestObject, int scaledWidth)
+void detectLargestObject(const Mat &img, CascadeClassifier &cascade, Rect &largestObject, int scaledWidth, bool useSkinFilter, Size minFeatureSize, Size maxFeatureSize)
 {
     // Apenas busca para apenas um objeto (o maior na imagem).
     int flags = CASCADE_FIND_BIGGEST_OBJECT; // | CASCADE_DO_ROUGH_SEARCH;
-    // Tamanho do menor objeto.
-    Size minFeatureSize = Size(20, 20);
     // Como detalhado deve ser a busca. Deve ser maior do que 1,0.
     float searchScaleFactor = 1.1f;
     // Quanto as detecções devem ser filtradas. Isso deve depender de quão ruim são as falsas detecções são para o sistema.
@@ -82,7 +136,10 @@ void detectLargestObject(const Mat &img, CascadeClassifier &cascade, Rect &large
 
     // Execute objeto ou de Detecção de Rosto, procurando apenas um objeto (o maior na imagem).
     vector<Rect> objects;
-    detectObjectsCustom(img, cascade, objects, scaledWidth, flags, minFeatureSize, searchScaleFactor, minNeighbors);
+    if (useSkinFilter)
+        detectObjectsInSkinRegions(img, cascade, objects, scaledWidth, flags, minFeatureSize, maxFeatureSize, searchScaleFactor, minNeighbors);
+    else
+        detectObjectsCustom(img, cascade, objects, scaledWidth, flags, minFeatureSize, maxFeatureSize, searchScaleFactor, minNeighbors);
     if (objects.size() > 0) {
         // Retorna o único objeto detectado.
         largestObject = (Rect)objects.at(0);
@@ -96,8 +153,9 @@ void detectLargestObject(const Mat &img, CascadeClassifier &cascade, Rect &large
 // Procurar por apenas um único objeto na imagem, tais como a maior cara, armazenando o resultado na 'largestObject'.
 // Pode usar Haar cascades ou LBP cascades para detecção de rosto, ou mesmo olho, boca, ou a detecção de carro.
 // A entrada é temporariamente reduzido para 'scaledWidth' para a detecção mais rápida, uma vez que 200 é o suficiente para encontrar rostos.
+// Se 'useSkinFilter' é verdade, procura apenas nas regiões com cor de pele (veja detectObjectsInSkinRegions()).
 // Nota: detectLargestObject () deve ser mais rápido do que detectManyObjects ().
-void detectManyObjects(const Mat &img, CascadeClassifier &cascade, vector<Rect> &objects, int scaledWidth)
+void detectManyObjects(const Mat &img, CascadeClassifier &cascade, vector<Rect> &objects, int scaledWidth, bool useSkinFilter)
 {
     // Procura de muitos objetos em uma imagem.
     int flags = CASCADE_SCALE_IMAGE;
@@ -110,6 +168,12 @@ void detectManyObjects(const Mat &img, CascadeClassifier &cascade, vector<Rect>
     // MinNeighbors = 2 significa muito bom + más detecções e minNeighbors = 6 significa apenas boas detecções são dadas, mas alguns são perdidas.
     int minNeighbors = 4;
 
+    // Sem limite para o tamanho do maior objeto.
+    Size maxFeatureSize = Size();
+
     // Execute objeto ou a Detecção de Rosto, à procura de muitos objetos na imagem um.
-    detectObjectsCustom(img, cascade, objects, scaledWidth, flags, minFeatureSize, searchScaleFactor, minNeighbors);
+    if (useSkinFilter)
+        detectObjectsInSkinRegions(img, cascade, objects, scaledWidth, flags, minFeatureSize, maxFeatureSize, searchScaleFactor, minNeighbors);
+    else
+        detectObjectsCustom(img, cascade, objects, scaledWidth, flags, minFeatureSize, maxFeatureSize, searchScaleFactor, minNeighbors);
 }
@@ -10,5 +10,6 @@
 using namespace cv;
 using namespace std;
 
-void detectLargestObject(const Mat &img, CascadeClassifier &cascade, Rect &largestObject, int scaledWidth = 320);
-void detectManyObjects(const Mat &img, CascadeClassifier &cascade, vector<Rect> &objects, int scaledWidth = 320);
+void detectObjectsCustom(const Mat &img, CascadeClassifier &cascade, vector<Rect> &objects, int scaledWidth, int flags, Size minFeatureSize, Size maxFeatureSize, float searchScaleFactor, int minNeighbors);
+void detectLargestObject(const Mat &img, CascadeClassifier &cascade, Rect &largestObject, int scaledWidth = 320, bool useSkinFilter = false, Size minFeatureSize = Size(20, 20), Size maxFeatureSize = Size());
+void detectManyObjects(const Mat &img, CascadeClassifier &cascade, vector<Rect> &objects, int scaledWidth = 320, bool useSkinFilter = false);
@@ -0,0 +1,202 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const double FACE_DENOISE_SIGMA_COLOR = 20.0;   // Os mesmos valores do bilateralFilter() de getPreprocessedFace().
+const double FACE_DENOISE_SIGMA_SPACE = 2.0;
+const int FACE_DENOISE_RADIUS = 3;              // cvRound(sigmaSpace * 1.5), como o bilateralFilter() calcula quando d = 0.
+const int FACE_DENOISE_MAX_TAPS = (2 * FACE_DENOISE_RADIUS + 1) * (2 * FACE_DENOISE_RADIUS + 1);
+
+
+#include "faceDenoise.h"        // Filtro bilateral especializado para os rostos pré-processados.
+
+#include <math.h>
+
+#if CV_SSE2
+    #include <emmintrin.h>
+#endif
+
+
+// As tabelas do filtro, calculadas uma única vez como o bilateralFilter() calcula a cada chamada.
+struct DenoiseTables
+{
+    int taps;                                           // Quantos vizinhos estão dentro do raio (29 para raio 3).
+    Point offsets[FACE_DENOISE_MAX_TAPS];               // A posição de cada vizinho, na mesma ordem do bilateralFilter().
+    float spaceExponent[FACE_DENOISE_MAX_TAPS];         // -r^2 / (2 * sigmaSpace^2), para o modo rápido.
+    float weights[FACE_DENOISE_MAX_TAPS][256];          // Peso espacial * peso da cor, para cada vizinho e cada diferença de cor.
+    float colorCoeff;                                   // -1 / (2 * sigmaColor^2).
+
+    DenoiseTables()
+    {
+        double colorCoeff64 = -0.5 / (FACE_DENOISE_SIGMA_COLOR * FACE_DENOISE_SIGMA_COLOR);
+        double spaceCoeff64 = -0.5 / (FACE_DENOISE_SIGMA_SPACE * FACE_DENOISE_SIGMA_SPACE);
+        colorCoeff = (float)colorCoeff64;
+        float colorWeight[256];
+        for (int i = 0; i < 256; i++)
+            colorWeight[i] = (float)exp(i * i * colorCoeff64);
+
+        taps = 0;
+        for (int i = -FACE_DENOISE_RADIUS; i <= FACE_DENOISE_RADIUS; i++) {
+            for (int j = -FACE_DENOISE_RADIUS; j <= FACE_DENOISE_RADIUS; j++) {
+                double r = sqrt((double)i * i + (double)j * j);
+                if (r > FACE_DENOISE_RADIUS)
+                    continue;
+                float spaceWeight = (float)exp(r * r * spaceCoeff64);
+                offsets[taps] = Point(j, i);
+                spaceExponent[taps] = (float)(r * r * spaceCoeff64);
+                for (int d = 0; d < 256; d++)
+                    weights[taps][d] = spaceWeight * colorWeight[d];
+                taps++;
+            }
+        }
+    }
+};
+
+static const DenoiseTables &getDenoiseTables()
+{
+    static const DenoiseTables tables;
+    return tables;
+}
+
+// Copia 'src' para 'padded' com FACE_DENOISE_RADIUS pixels de borda em cada lado, com a mesma borda do bilateralFilter() (BORDER_REFLECT_101).
+template<typename T>
+static void makePaddedImage(const Mat &src, T *padded, int paddedStep)
+{
+    const int r = FACE_DENOISE_RADIUS;
+    for (int y = -r; y < src.rows + r; y++) {
+        const uchar *srcRow = src.ptr<uchar>(borderInterpolate(y, src.rows, BORDER_REFLECT_101));
+        T *row = padded + (y + r) * paddedStep + r;
+        for (int x = 0; x < src.cols; x++)
+            row[x] = (T)srcRow[x];
+        for (int x = 1; x <= r; x++) {
+            row[-x] = (T)srcRow[borderInterpolate(-x, src.cols, BORDER_REFLECT_101)];
+            row[src.cols - 1 + x] = (T)srcRow[borderInterpolate(src.cols - 1 + x, src.cols, BORDER_REFLECT_101)];
+        }
+    }
+}
+
+// Um pixel com as tabelas, somando na mesma ordem e com as mesmas operações float do bilateralFilter().
+static inline uchar denoisePixel(const DenoiseTables &tables, const uchar *center, const int *tapOffsets)
+{
+    int val0 = center[0];
+    float sum = 0, wsum = 0;
+    for (int k = 0; k < tables.taps; k++) {
+        int val = center[tapOffsets[k]];
+        float w = tables.weights[k][std::abs(val - val0)];
+        sum += val * w;
+        wsum += w;
+    }
+    return (uchar)cvRound(sum / wsum);
+}
+
+static void denoiseFaceQuality(const Mat &src, Mat &dst)
+{
+    const DenoiseTables &tables = getDenoiseTables();
+    const int r = FACE_DENOISE_RADIUS;
+    int paddedStep = src.cols + 2 * r;
+    AutoBuffer<uchar, (70 + 2 * FACE_DENOISE_RADIUS) * (70 + 2 * FACE_DENOISE_RADIUS)> buffer(paddedStep * (src.rows + 2 * r));
+    uchar *padded = buffer;
+    makePaddedImage(src, padded, paddedStep);
+
+    int tapOffsets[FACE_DENOISE_MAX_TAPS];
+    for (int k = 0; k < tables.taps; k++)
+        tapOffsets[k] = tables.offsets[k].y * paddedStep + tables.offsets[k].x;
+
+    for (int y = 0; y < src.rows; y++) {
+        const uchar *center = padded + (y + r) * paddedStep + r;
+        uchar *out = dst.ptr<uchar>(y);
+        for (int x = 0; x < src.cols; x++)
+            out[x] = denoisePixel(tables, center + x, tapOffsets);
+    }
+}
+
+#if CV_SSE2
+// exp(x) para x <= 0, com erro relativo de no máximo 5e-6: x = n * ln(2) + f * ln(2), com n inteiro e |f| <= 0.5,
+// 2^f por um polinômio de grau 5 e 2^n direto nos bits do expoente.
+static inline __m128 expNegative(__m128 x)
+{
+    x = _mm_max_ps(x, _mm_set1_ps(-87.0f));
+    __m128 t = _mm_mul_ps(x, _mm_set1_ps(1.44269504f));
+    __m128i n = _mm_cvtps_epi32(t);
+    __m128 f = _mm_sub_ps(t, _mm_cvtepi32_ps(n));
+    __m128 p = _mm_set1_ps(1.3333558e-3f);
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.6181291e-3f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.5504109e-2f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.4022651e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.9314718e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+    __m128i exponent = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(p, _mm_castsi128_ps(exponent));
+}
+#endif
+
+static void denoiseFaceFast(const Mat &src, Mat &dst)
+{
+    const DenoiseTables &tables = getDenoiseTables();
+    const int r = FACE_DENOISE_RADIUS;
+    int paddedStep = src.cols + 2 * r;
+    int paddedSize = paddedStep * (src.rows + 2 * r);
+    AutoBuffer<uchar, (70 + 2 * FACE_DENOISE_RADIUS) * (70 + 2 * FACE_DENOISE_RADIUS)> buffer(paddedSize);
+    uchar *padded = buffer;
+    makePaddedImage(src, padded, paddedStep);
+    int tapOffsets[FACE_DENOISE_MAX_TAPS];
+    for (int k = 0; k < tables.taps; k++)
+        tapOffsets[k] = tables.offsets[k].y * paddedStep + tables.offsets[k].x;
+
+#if CV_SSE2
+    // Uma cópia float da imagem com borda, para carregar 4 vizinhos de cada vez.
+    AutoBuffer<float, (70 + 2 * FACE_DENOISE_RADIUS) * (70 + 2 * FACE_DENOISE_RADIUS)> floatBuffer(paddedSize);
+    float *paddedFloat = floatBuffer;
+    for (int i = 0; i < paddedSize; i++)
+        paddedFloat[i] = padded[i];
+    __m128 colorCoeff = _mm_set1_ps(tables.colorCoeff);
+#endif
+
+    for (int y = 0; y < src.rows; y++) {
+        const uchar *center = padded + (y + r) * paddedStep + r;
+        uchar *out = dst.ptr<uchar>(y);
+        int x = 0;
+#if CV_SSE2
+        const float *centerFloat = paddedFloat + (y + r) * paddedStep + r;
+        for (; x <= src.cols - 4; x += 4) {
+            __m128 val0 = _mm_loadu_ps(centerFloat + x);
+            __m128 sum = _mm_setzero_ps();
+            __m128 wsum = _mm_setzero_ps();
+            for (int k = 0; k < tables.taps; k++) {
+                __m128 val = _mm_loadu_ps(centerFloat + x + tapOffsets[k]);
+                __m128 diff = _mm_sub_ps(val, val0);
+                // Peso espacial * peso da cor = exp(expoente espacial + diferença^2 * coeficiente da cor).
+                __m128 exponent = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(diff, diff), colorCoeff), _mm_set1_ps(tables.spaceExponent[k]));
+                __m128 w = expNegative(exponent);
+                sum = _mm_add_ps(sum, _mm_mul_ps(val, w));
+                wsum = _mm_add_ps(wsum, w);
+            }
+            __m128i result = _mm_cvtps_epi32(_mm_div_ps(sum, wsum));
+            result = _mm_packs_epi32(result, result);
+            result = _mm_packus_epi16(result, result);
+            *(int*)(out + x) = _mm_cvtsi128_si32(result);
+        }
+#endif
+        for (; x < src.cols; x++)
+            out[x] = denoisePixel(tables, center + x, tapOffsets);
+    }
+}
+
+void denoiseFace(const Mat &src, Mat &dst, int mode)
+{
+    CV_Assert(src.type() == CV_8UC1 && src.data != dst.data);
+    if (mode == FACE_DENOISE_OPENCV) {
+        bilateralFilter(src, dst, 0, FACE_DENOISE_SIGMA_COLOR, FACE_DENOISE_SIGMA_SPACE);
+        return;
+    }
+    // Rostos menores que a janela do filtro não têm a borda que makePaddedImage() precisa.
+    if (src.rows <= FACE_DENOISE_RADIUS || src.cols <= FACE_DENOISE_RADIUS) {
+        bilateralFilter(src, dst, 0, FACE_DENOISE_SIGMA_COLOR, FACE_DENOISE_SIGMA_SPACE);
+        return;
+    }
+    dst.create(src.size(), CV_8U);
+    if (mode == FACE_DENOISE_FAST)
+        denoiseFaceFast(src, dst);
+    else
+        denoiseFaceQuality(src, dst);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+
+using namespace cv;
+using namespace std;
+
+// Modos do filtro que tira o ruído dos rostos pré-processados em getPreprocessedFace():
+// - FACE_DENOISE_OPENCV: bilateralFilter(src, dst, 0, 20.0, 2.0) do OpenCV, como antes.
+// - FACE_DENOISE_QUALITY: o mesmo filtro, com o mesmo resultado, mas com as tabelas de pesos calculadas uma vez só (em vez de a cada
+//   rosto) e o peso espacial e o de cor juntos em uma única tabela, sem alocar nada para rostos de até 70x70.
+// - FACE_DENOISE_FAST: o mesmo filtro com SSE2, 4 pixels de cada vez, calculando os pesos com uma aproximação da exponencial em vez
+//   das tabelas. A diferença para o bilateralFilter() é no máximo 1 nível de cinza em poucos pixels (veja benchKernels).
+enum FaceDenoiseMode {FACE_DENOISE_OPENCV=0, FACE_DENOISE_QUALITY, FACE_DENOISE_FAST};
+
+// Filtro bilateral com sigmaColor = 20 e sigmaSpace = 2 (uma janela circular de raio 3), para imagens de 8 bits em tons de cinza.
+// 'dst' é alocado se for preciso, e não pode ser a mesma imagem que 'src'.
+void denoiseFace(const Mat &src, Mat &dst, int mode = FACE_DENOISE_QUALITY);
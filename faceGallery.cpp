@@ -0,0 +1,338 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const int GALLERY_ALIGNMENT = 64;           // Alinhamento do atlas e de cada rosto (uma linha de cache).
+const int GALLERY_MIN_CAPACITY = 16;        // Quantos rostos cabem na primeira alocação do atlas.
+const char GALLERY_FILE_MAGIC[8] = {'F', 'A', 'C', 'E', 'G', 'A', 'L', '1'};
+
+
+#include "faceGallery.h"        // Galeria de rostos em um único atlas alinhado de 8 bits.
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Cabeçalho do arquivo da galeria. Depois dele vêm os nomes (int32, um por rosto) e, em 'atlasOffset', o atlas.
+struct FaceGalleryFileHeader
+{
+    char magic[8];
+    int32_t width;
+    int32_t height;
+    int32_t stride;
+    int32_t count;
+    int64_t labelsOffset;
+    int64_t atlasOffset;
+};
+// O arquivo é lido e escrito com a estrutura inteira, então o layout dela não pode depender do compilador: os campos de 64 bits já
+// caem em posições múltiplas de 8, sem nenhum preenchimento.
+static_assert(offsetof(FaceGalleryFileHeader, width) == 8 && offsetof(FaceGalleryFileHeader, count) == 20, "Unexpected gallery header layout");
+static_assert(offsetof(FaceGalleryFileHeader, labelsOffset) == 24 && offsetof(FaceGalleryFileHeader, atlasOffset) == 32, "Unexpected gallery header layout");
+static_assert(sizeof(FaceGalleryFileHeader) == 40, "Unexpected gallery header size");
+
+struct SlotRange
+{
+    cv::Range slots;
+    int label;
+};
+
+static bool compareSlotRanges(const SlotRange &a, const SlotRange &b)
+{
+    return a.slots.start < b.slots.start;
+}
+
+// Todos os intervalos de todas as pessoas, em ordem de slot.
+static void getSortedRanges(const map<int, vector<cv::Range> > &ranges, vector<SlotRange> &sorted)
+{
+    sorted.clear();
+    for (map<int, vector<cv::Range> >::const_iterator it = ranges.begin(); it != ranges.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            SlotRange r;
+            r.slots = it->second[i];
+            r.label = it->first;
+            sorted.push_back(r);
+        }
+    }
+    sort(sorted.begin(), sorted.end(), compareSlotRanges);
+}
+
+
+FaceGallery::FaceGallery(Size faceSize)
+    : m_faceSize(faceSize), m_stride((int)alignSize(faceSize.area(), GALLERY_ALIGNMENT)), m_offset(0), m_capacity(0), m_used(0), m_free(0)
+{
+}
+
+// Copia a galeria para um novo atlas com 'capacity' slots. Se 'compactSlots' for true, só os rostos das pessoas que ainda existem
+// são copiados, em sequência. O atlas antigo nunca é modificado, então os Mat retornados antes continuam válidos.
+void FaceGallery::moveToNewStorage(int capacity, bool compactSlots)
+{
+    Mat storage = Mat::zeros(1, capacity * m_stride + GALLERY_ALIGNMENT, CV_8U);
+    int offset = (int)(alignPtr(storage.data, GALLERY_ALIGNMENT) - storage.data);
+
+    if (!compactSlots) {
+        if (m_used > 0)
+            memcpy(storage.data + offset, getSlotPtr(0), (size_t)m_used * m_stride);
+    }
+    else {
+        vector<SlotRange> sorted;
+        getSortedRanges(m_ranges, sorted);
+        vector<int> labels;
+        map<int, vector<cv::Range> > ranges;
+        int used = 0;
+        for (size_t i = 0; i < sorted.size(); i++) {
+            int count = sorted[i].slots.size();
+            memcpy(storage.data + offset + (size_t)used * m_stride, getSlotPtr(sorted[i].slots.start), (size_t)count * m_stride);
+            vector<cv::Range> &personRanges = ranges[sorted[i].label];
+            if (!personRanges.empty() && personRanges.back().end == used)
+                personRanges.back().end += count;
+            else
+                personRanges.push_back(cv::Range(used, used + count));
+            labels.insert(labels.end(), count, sorted[i].label);
+            used += count;
+        }
+        m_labels.swap(labels);
+        m_ranges.swap(ranges);
+        m_used = used;
+        m_free = 0;
+    }
+
+    m_storage = storage;
+    m_offset = offset;
+    m_capacity = capacity;
+}
+
+void FaceGallery::reserve(int capacity)
+{
+    if (capacity <= m_capacity)
+        return;
+    moveToNewStorage(max(max(capacity, 2 * m_capacity), GALLERY_MIN_CAPACITY), false);
+}
+
+int FaceGallery::add(const Mat &face, int label)
+{
+    if (face.size() != m_faceSize || face.type() != CV_8UC1)
+        CV_Error(CV_StsBadArg, format("The gallery only stores %dx%d 8-bit faces, but got a %dx%d face of type %d.",
+                                      m_faceSize.width, m_faceSize.height, face.cols, face.rows, face.type()));
+    if (label < 0)
+        CV_Error(CV_StsBadArg, format("The gallery only stores faces with non-negative labels, but got label %d.", label));
+    if (m_used == m_capacity)
+        reserve(m_used + 1);
+
+    // O slot ainda não foi usado, então nenhum Mat já retornado aponta para ele.
+    int slot = m_used;
+    uchar *dst = getSlotPtr(slot);
+    for (int y = 0; y < face.rows; y++)
+        memcpy(dst + y * m_faceSize.width, face.ptr<uchar>(y), m_faceSize.width);
+    m_labels.push_back(label);
+    m_used++;
+
+    vector<cv::Range> &ranges = m_ranges[label];
+    if (!ranges.empty() && ranges.back().end == slot)
+        ranges.back().end++;
+    else
+        ranges.push_back(cv::Range(slot, slot + 1));
+    return slot;
+}
+
+void FaceGallery::removePerson(int label)
+{
+    map<int, vector<cv::Range> >::iterator it = m_ranges.find(label);
+    if (it == m_ranges.end())
+        return;
+    for (size_t i = 0; i < it->second.size(); i++) {
+        m_free += it->second[i].size();
+        for (int slot = it->second[i].start; slot < it->second[i].end; slot++)
+            m_labels[slot] = GALLERY_FREE_SLOT;
+    }
+    m_ranges.erase(it);
+
+    if (m_free > m_used / 2)
+        compact();
+}
+
+void FaceGallery::relabelPerson(int label, int newLabel)
+{
+    map<int, vector<cv::Range> >::iterator it = m_ranges.find(label);
+    if (it == m_ranges.end() || label == newLabel)
+        return;
+    if (newLabel < 0)
+        CV_Error(CV_StsBadArg, format("The gallery only stores faces with non-negative labels, but got label %d.", newLabel));
+    vector<cv::Range> moved;
+    moved.swap(it->second);
+    m_ranges.erase(it);
+
+    // Os intervalos das duas pessoas, em ordem de slot, juntando os que ficam lado a lado.
+    vector<cv::Range> &ranges = m_ranges[newLabel];
+    for (size_t i = 0; i < moved.size(); i++) {
+        for (int slot = moved[i].start; slot < moved[i].end; slot++)
+            m_labels[slot] = newLabel;
+        ranges.push_back(moved[i]);
+    }
+    vector<SlotRange> sorted(ranges.size());
+    for (size_t i = 0; i < ranges.size(); i++) {
+        sorted[i].slots = ranges[i];
+        sorted[i].label = newLabel;
+    }
+    sort(sorted.begin(), sorted.end(), compareSlotRanges);
+    ranges.clear();
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (!ranges.empty() && ranges.back().end == sorted[i].slots.start)
+            ranges.back().end = sorted[i].slots.end;
+        else
+            ranges.push_back(sorted[i].slots);
+    }
+}
+
+void FaceGallery::compact()
+{
+    if (m_free == 0)
+        return;
+    moveToNewStorage(max(m_capacity, GALLERY_MIN_CAPACITY), true);
+}
+
+void FaceGallery::clear()
+{
+    m_storage.release();
+    m_offset = 0;
+    m_capacity = 0;
+    m_used = 0;
+    m_free = 0;
+    m_labels.clear();
+    m_ranges.clear();
+}
+
+Mat FaceGallery::getFace(int slot) const
+{
+    CV_Assert(slot >= 0 && slot < m_used && m_labels[slot] != GALLERY_FREE_SLOT);
+    // Uma linha do atlas (compartilhando o contador de referências) vista como uma imagem do tamanho do rosto.
+    return m_storage.colRange(m_offset + slot * m_stride, m_offset + slot * m_stride + m_faceSize.area()).reshape(1, m_faceSize.height);
+}
+
+int FaceGallery::getLabel(int slot) const
+{
+    CV_Assert(slot >= 0 && slot < m_used && m_labels[slot] != GALLERY_FREE_SLOT);
+    return m_labels[slot];
+}
+
+void FaceGallery::getFaces(vector<Mat> &faces, vector<int> &labels) const
+{
+    faces.clear();
+    labels.clear();
+    vector<SlotRange> sorted;
+    getSortedRanges(m_ranges, sorted);
+    for (size_t i = 0; i < sorted.size(); i++) {
+        for (int slot = sorted[i].slots.start; slot < sorted[i].slots.end; slot++) {
+            faces.push_back(getFace(slot));
+            labels.push_back(sorted[i].label);
+        }
+    }
+}
+
+const vector<cv::Range> &FaceGallery::getPersonRanges(int label) const
+{
+    static const vector<cv::Range> noRanges;
+    map<int, vector<cv::Range> >::const_iterator it = m_ranges.find(label);
+    return (it != m_ranges.end()) ? it->second : noRanges;
+}
+
+int FaceGallery::getLatestFace(int label) const
+{
+    const vector<cv::Range> &ranges = getPersonRanges(label);
+    return ranges.empty() ? -1 : ranges.back().end - 1;
+}
+
+int FaceGallery::getPersonFaceCount(int label) const
+{
+    const vector<cv::Range> &ranges = getPersonRanges(label);
+    int count = 0;
+    for (size_t i = 0; i < ranges.size(); i++)
+        count += ranges[i].size();
+    return count;
+}
+
+// Salva os rostos em ordem de slot, sem os slots livres.
+bool FaceGallery::save(const string &filename) const
+{
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        cerr << "ERROR: Could not write the face gallery to [" << filename << "]!" << endl;
+        return false;
+    }
+
+    vector<SlotRange> sorted;
+    getSortedRanges(m_ranges, sorted);
+    vector<int32_t> labels;
+    for (size_t i = 0; i < sorted.size(); i++)
+        labels.insert(labels.end(), sorted[i].slots.size(), sorted[i].label);
+
+    FaceGalleryFileHeader header;
+    memcpy(header.magic, GALLERY_FILE_MAGIC, sizeof(header.magic));
+    header.width = m_faceSize.width;
+    header.height = m_faceSize.height;
+    header.stride = m_stride;
+    header.count = (int32_t)labels.size();
+    header.labelsOffset = sizeof(header);
+    header.atlasOffset = alignSize((size_t)header.labelsOffset + labels.size() * sizeof(int32_t), GALLERY_ALIGNMENT);
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (ok && !labels.empty())
+        ok = fwrite(&labels[0], sizeof(int32_t), labels.size(), file) == labels.size();
+    vector<uchar> padding((size_t)(header.atlasOffset - header.labelsOffset) - labels.size() * sizeof(int32_t), 0);
+    if (ok && !padding.empty())
+        ok = fwrite(&padding[0], 1, padding.size(), file) == padding.size();
+    for (size_t i = 0; ok && i < sorted.size(); i++) {
+        size_t bytes = (size_t)sorted[i].slots.size() * m_stride;
+        ok = fwrite(getSlotPtr(sorted[i].slots.start), 1, bytes, file) == bytes;
+    }
+    fclose(file);
+    if (!ok)
+        cerr << "ERROR: Could not write the face gallery to [" << filename << "]!" << endl;
+    return ok;
+}
+
+bool FaceGallery::load(const string &filename)
+{
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        cerr << "ERROR: Could not open the face gallery [" << filename << "]!" << endl;
+        return false;
+    }
+
+    FaceGalleryFileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, GALLERY_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+              header.width > 0 && header.height > 0 && header.stride >= header.width * header.height && header.count >= 0;
+    vector<int32_t> labels(ok ? header.count : 0);
+    if (ok && header.count > 0) {
+        ok = fseek(file, (long)header.labelsOffset, SEEK_SET) == 0 && fread(&labels[0], sizeof(int32_t), labels.size(), file) == labels.size();
+        for (size_t i = 0; ok && i < labels.size(); i++)
+            ok = labels[i] >= 0;
+    }
+    if (ok) {
+        clear();
+        m_faceSize = Size(header.width, header.height);
+        m_stride = header.stride;
+        if (header.count > 0) {
+            moveToNewStorage(header.count, false);
+            size_t bytes = (size_t)header.count * m_stride;
+            ok = fseek(file, (long)header.atlasOffset, SEEK_SET) == 0 && fread(getSlotPtr(0), 1, bytes, file) == bytes;
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        cerr << "ERROR: The face gallery [" << filename << "] is not valid!" << endl;
+        clear();
+        return false;
+    }
+
+    for (int slot = 0; slot < header.count; slot++) {
+        m_labels.push_back(labels[slot]);
+        vector<cv::Range> &ranges = m_ranges[labels[slot]];
+        if (!ranges.empty() && ranges.back().end == slot)
+            ranges.back().end++;
+        else
+            ranges.push_back(cv::Range(slot, slot + 1));
+    }
+    m_used = header.count;
+    return true;
+}
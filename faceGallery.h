@@ -0,0 +1,86 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include "opencv2/opencv.hpp"
+
+
+using namespace cv;
+using namespace std;
+
+// Nome guardado nos slots livres, então os nomes das pessoas não podem ser negativos.
+const int GALLERY_FREE_SLOT = -1;
+
+// Galeria de rostos coletados, guardada como um único atlas contínuo de 8 bits em vez de um vector<Mat> com uma alocação por rosto.
+// - Cada rosto ocupa um "slot" de 'getFaceStride()' bytes (o tamanho do rosto arredondado para 64 bytes), e o atlas começa em um
+//   endereço alinhado a 64 bytes, então cada rosto começa no início de uma linha de cache.
+// - Os nomes (labels) ficam em um array paralelo, um por slot, e cada pessoa tem a lista de intervalos de slots com seus rostos
+//   (normalmente um intervalo só, já que os rostos de uma pessoa são coletados em sequência).
+// - getFace() e getFaces() retornam cabeçalhos de Mat que apontam para o atlas, sem copiar os pixels. Eles compartilham o contador de
+//   referências do atlas, então continuam válidos (por exemplo, no treinamento em segundo plano) mesmo se a galeria crescer,
+//   for compactada ou apagada depois.
+// - removePerson() é O(1) no tamanho da galeria: só esquece os intervalos da pessoa. Os slots livres são recuperados por compact(),
+//   chamado automaticamente quando mais da metade dos slots estão livres.
+// - O arquivo salvo por save() é um cabeçalho, os nomes e o atlas, exatamente como na memória e com o atlas em uma posição alinhada
+//   a 64 bytes, então ele pode ser mapeado direto na memória (mmap). load() o lê com uma única leitura para o atlas.
+class FaceGallery
+{
+public:
+    FaceGallery(Size faceSize = Size(70, 70));
+
+    // Adiciona uma cópia do rosto (8 bits, do tamanho da galeria) e retorna seu slot. O(1) amortizado.
+    int add(const Mat &face, int label);
+
+    // Esquece todos os rostos de uma pessoa. Os slots deles ficam livres até o próximo compact().
+    void removePerson(int label);
+
+    // Junta os rostos de 'label' aos de 'newLabel' (os rostos ficam nos mesmos slots, só o nome muda).
+    void relabelPerson(int label, int newLabel);
+
+    // Move os rostos para o início do atlas, eliminando os slots livres. Os slots dos rostos mudam.
+    void compact();
+
+    void clear();
+
+    // Quantos rostos há na galeria (sem contar os slots livres).
+    int size() const { return m_used - m_free; }
+    Size getFaceSize() const { return m_faceSize; }
+    int getFaceStride() const { return m_stride; }
+
+    // O rosto e o nome de um slot, sem copiar os pixels. O slot precisa ter um rosto (não pode ser um slot livre).
+    Mat getFace(int slot) const;
+    int getLabel(int slot) const;
+
+    // Todos os rostos e nomes, em ordem de slot, sem copiar os pixels. Pode ser usado direto com FaceRecognizer::train().
+    void getFaces(vector<Mat> &faces, vector<int> &labels) const;
+
+    // Intervalos de slots com os rostos da pessoa (vazio se ela não tem rostos), e o slot do seu rosto mais recente (ou -1).
+    const vector<cv::Range> &getPersonRanges(int label) const;
+    int getLatestFace(int label) const;
+    int getPersonFaceCount(int label) const;
+
+    bool save(const string &filename) const;
+    bool load(const string &filename);
+
+    // Bytes alocados para o atlas (com os slots ainda não usados).
+    size_t getAllocatedBytes() const { return m_storage.empty() ? 0 : m_storage.total(); }
+
+private:
+    uchar *getSlotPtr(int slot) const { return m_storage.data + m_offset + (size_t)slot * m_stride; }
+    void reserve(int capacity);
+    void moveToNewStorage(int capacity, bool compactSlots);
+
+    Size m_faceSize;
+    int m_stride;
+    Mat m_storage;          // O atlas, com 64 bytes a mais para o alinhamento (1 x bytes, CV_8U).
+    int m_offset;           // Onde começa o atlas alinhado dentro de 'm_storage'.
+    int m_capacity;         // Quantos slots cabem em 'm_storage'.
+    int m_used;             // Quantos slots já foram usados (incluindo os livres).
+    int m_free;             // Quantos slots usados pertenciam a pessoas removidas.
+    vector<int> m_labels;   // O nome de cada slot usado (GALLERY_FREE_SLOT nos slots livres).
+    map<int, vector<cv::Range> > m_ranges;    // Os intervalos de slots de cada pessoa.
+};
@@ -0,0 +1,150 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const int FACE_WARP_BITS = 5;                   // As posições são arredondadas para 1/32 de pixel, como no warpAffine() (INTER_BITS).
+const int FACE_WARP_TAB_SIZE = 1 << FACE_WARP_BITS;
+const int FACE_WARP_AB_BITS = 10;               // Precisão das coordenadas em ponto fixo, a mesma do warpAffine().
+const int FACE_WARP_AB_SCALE = 1 << FACE_WARP_AB_BITS;
+const int FACE_WARP_COEF_BITS = 15;             // Pesos da interpolação em ponto fixo (INTER_REMAP_COEF_BITS).
+const int FACE_WARP_GRAY_SHIFT = 14;            // Os pesos de cvtColor(CV_BGR2GRAY) em ponto fixo.
+const int FACE_WARP_B2Y = 1868;
+const int FACE_WARP_G2Y = 9617;
+const int FACE_WARP_R2Y = 4899;
+const int FACE_WARP_MAX_WIDTH = 70;             // Até essa largura as tabelas de cada linha ficam na pilha (o tamanho do rosto do main.cpp).
+
+
+#include "faceWarp.h"           // Alinhamento do rosto direto da imagem colorida.
+
+
+// Os pesos bilineares de cada posição sub-pixel, calculados uma única vez.
+struct WarpTables
+{
+    int weights[FACE_WARP_TAB_SIZE * FACE_WARP_TAB_SIZE][4];
+
+    WarpTables()
+    {
+        // (1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy e fx * fy, que em 1/32 de pixel são exatos em 15 bits.
+        const int scale = (1 << FACE_WARP_COEF_BITS) / (FACE_WARP_TAB_SIZE * FACE_WARP_TAB_SIZE);
+        for (int ty = 0; ty < FACE_WARP_TAB_SIZE; ty++) {
+            for (int tx = 0; tx < FACE_WARP_TAB_SIZE; tx++) {
+                int *w = weights[ty * FACE_WARP_TAB_SIZE + tx];
+                w[0] = (FACE_WARP_TAB_SIZE - tx) * (FACE_WARP_TAB_SIZE - ty) * scale;
+                w[1] = tx * (FACE_WARP_TAB_SIZE - ty) * scale;
+                w[2] = (FACE_WARP_TAB_SIZE - tx) * ty * scale;
+                w[3] = tx * ty * scale;
+            }
+        }
+    }
+};
+
+static const WarpTables &getWarpTables()
+{
+    static const WarpTables tables;
+    return tables;
+}
+
+// O pixel em tons de cinza, com o mesmo arredondamento de cvtColor(CV_BGR2GRAY) e cvtColor(CV_BGRA2GRAY).
+template<int cn>
+static inline int grayAt(const uchar *p)
+{
+    if (cn == 1)
+        return p[0];
+    return (p[0] * FACE_WARP_B2Y + p[1] * FACE_WARP_G2Y + p[2] * FACE_WARP_R2Y + (1 << (FACE_WARP_GRAY_SHIFT - 1))) >> FACE_WARP_GRAY_SHIFT;
+}
+
+template<int cn>
+static inline int grayOrBorder(const Mat &src, int x, int y, int borderValue)
+{
+    if ((unsigned)x >= (unsigned)src.cols || (unsigned)y >= (unsigned)src.rows)
+        return borderValue;
+    return grayAt<cn>(src.ptr<uchar>(y) + x * cn);
+}
+
+// 'M' é a transformação inversa: do rosto alinhado para 'src'. As coordenadas de cada pixel são calculadas em ponto fixo
+// exatamente como o warpAffine() calcula, e as colunas de cada linha só somam uma tabela calculada uma vez por rosto.
+template<int cn>
+static void warpFaceRows(const Mat &src, const double *M, Mat &dst, int borderValue)
+{
+    const WarpTables &tables = getWarpTables();
+    const int width = dst.cols;
+    AutoBuffer<int, 2 * FACE_WARP_MAX_WIDTH> deltas(2 * width);
+    int *adelta = deltas;
+    int *bdelta = adelta + width;
+    for (int x = 0; x < width; x++) {
+        adelta[x] = saturate_cast<int>(M[0] * x * FACE_WARP_AB_SCALE);
+        bdelta[x] = saturate_cast<int>(M[3] * x * FACE_WARP_AB_SCALE);
+    }
+
+    const int roundDelta = FACE_WARP_AB_SCALE / FACE_WARP_TAB_SIZE / 2;
+    const int shift = FACE_WARP_AB_BITS - FACE_WARP_BITS;
+    const int delta = 1 << (FACE_WARP_COEF_BITS - 1);
+    const size_t step = src.step;
+    const unsigned innerWidth = (unsigned)max(src.cols - 1, 0);
+    const unsigned innerHeight = (unsigned)max(src.rows - 1, 0);
+    const uchar border = saturate_cast<uchar>(borderValue);
+
+    for (int y = 0; y < dst.rows; y++) {
+        int X0 = saturate_cast<int>((M[1] * y + M[2]) * FACE_WARP_AB_SCALE) + roundDelta;
+        int Y0 = saturate_cast<int>((M[4] * y + M[5]) * FACE_WARP_AB_SCALE) + roundDelta;
+        uchar *out = dst.ptr<uchar>(y);
+        for (int x = 0; x < width; x++) {
+            int X = (X0 + adelta[x]) >> shift;
+            int Y = (Y0 + bdelta[x]) >> shift;
+            int sx = X >> FACE_WARP_BITS;
+            int sy = Y >> FACE_WARP_BITS;
+            const int *w = tables.weights[(Y & (FACE_WARP_TAB_SIZE - 1)) * FACE_WARP_TAB_SIZE + (X & (FACE_WARP_TAB_SIZE - 1))];
+            int v0, v1, v2, v3;
+            if ((unsigned)sx < innerWidth && (unsigned)sy < innerHeight) {
+                const uchar *p = src.data + sy * step + sx * cn;
+                v0 = grayAt<cn>(p);
+                v1 = grayAt<cn>(p + cn);
+                v2 = grayAt<cn>(p + step);
+                v3 = grayAt<cn>(p + step + cn);
+            }
+            else if (sx >= src.cols || sx + 1 < 0 || sy >= src.rows || sy + 1 < 0) {
+                // Totalmente fora da região do rosto.
+                out[x] = border;
+                continue;
+            }
+            else {
+                // Na borda da região do rosto: os vizinhos de fora valem 'borderValue'.
+                v0 = grayOrBorder<cn>(src, sx, sy, border);
+                v1 = grayOrBorder<cn>(src, sx + 1, sy, border);
+                v2 = grayOrBorder<cn>(src, sx, sy + 1, border);
+                v3 = grayOrBorder<cn>(src, sx + 1, sy + 1, border);
+            }
+            out[x] = saturate_cast<uchar>((v0 * w[0] + v1 * w[1] + v2 * w[2] + v3 * w[3] + delta) >> FACE_WARP_COEF_BITS);
+        }
+    }
+}
+
+void warpFace(const Mat &faceImg, const Mat &transform, Mat &warped, Size faceSize, int borderValue)
+{
+    CV_Assert(faceImg.depth() == CV_8U && (faceImg.channels() == 1 || faceImg.channels() == 3 || faceImg.channels() == 4));
+    CV_Assert(transform.rows == 2 && transform.cols == 3 && faceImg.data != warped.data);
+
+    // Inverte a matriz como o warpAffine() faz sem WARP_INVERSE_MAP.
+    double M[6];
+    Mat matM(2, 3, CV_64F, M);
+    transform.convertTo(matM, CV_64F);
+    double D = M[0] * M[4] - M[1] * M[3];
+    D = (D != 0) ? 1.0 / D : 0;
+    double A11 = M[4] * D, A22 = M[0] * D;
+    M[0] = A11;
+    M[1] *= -D;
+    M[3] *= -D;
+    M[4] = A22;
+    double b1 = -M[0] * M[2] - M[1] * M[5];
+    double b2 = -M[3] * M[2] - M[4] * M[5];
+    M[2] = b1;
+    M[5] = b2;
+
+    warped.create(faceSize, CV_8U);
+    if (faceImg.channels() == 3)
+        warpFaceRows<3>(faceImg, M, warped, borderValue);
+    else if (faceImg.channels() == 4)
+        warpFaceRows<4>(faceImg, M, warped, borderValue);
+    else
+        warpFaceRows<1>(faceImg, M, warped, borderValue);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+
+using namespace cv;
+using namespace std;
+
+// Alinha o rosto em uma passada só: dá o mesmo resultado que converter 'faceImg' para tons de cinza com cvtColor() e depois chamar
+// warpAffine(gray, warped, transform, faceSize), com interpolação bilinear e 'borderValue' fora da imagem, como o warpAffine() faz.
+// Cada pixel do rosto alinhado lê os seus 4 vizinhos direto de 'faceImg' e converte só eles para cinza, então a região do rosto
+// inteira nunca é convertida. 'faceImg' pode ter 1, 3 (BGR) ou 4 (BGRA) canais de 8 bits, e 'transform' é a matriz 2x3 de
+// getRotationMatrix2D(), de 'faceImg' para o rosto alinhado. Para rostos de até 70 pixels de largura nada é alocado além de 'warped'.
+void warpFace(const Mat &faceImg, const Mat &transform, Mat &warped, Size faceSize, int borderValue = 0);
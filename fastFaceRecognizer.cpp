@@ -0,0 +1,563 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const double MIN_EIGENVALUE_RATIO = 1e-9;   // Autovalores menores que isso (relativo ao maior) são só erro numérico, e seus autovetores são ignorados.
+const int PIXELS_PER_STRIPE = 256;          // Quantos pixels cada thread leva de volta para o espaço dos pixels de uma vez.
+
+
+#include "fastFaceRecognizer.h"     // Eigenfaces e Fisherfaces com treinamento mais rápido, usando a matriz de Gram e várias threads.
+
+#include <algorithm>
+
+#include "opencv2/core/internal.hpp"    // Para CV_INIT_ALGORITHM.
+
+#if CV_SSE2
+    #include <emmintrin.h>
+#endif
+
+
+// Converte cada rosto diretamente para sua linha na matriz de dados (CV_32F), uma linha por rosto. Se 'mirror' for true, a imagem
+// espelhada do rosto i também é escrita na linha N + i, lendo os pixels do rosto original de trás para frente.
+class ConvertSamplesBody : public ParallelLoopBody
+{
+public:
+    ConvertSamplesBody(const vector<Mat> &samples, Mat &data, bool mirror) : m_samples(samples), m_data(data), m_mirror(mirror) {}
+
+    virtual void operator()(const Range &range) const
+    {
+        int n = (int)m_samples.size();
+        for (int i = range.start; i < range.end; i++) {
+            Mat row = m_data.row(i);
+            const Mat &sample = m_samples[i];
+            if (sample.isContinuous())
+                sample.reshape(1, 1).convertTo(row, CV_32F);
+            else
+                sample.clone().reshape(1, 1).convertTo(row, CV_32F);
+
+            if (m_mirror) {
+                Mat mirroredRow = m_data.row(n + i);
+                if (sample.type() == CV_8UC1) {
+                    float *dst = mirroredRow.ptr<float>(0);
+                    int w = sample.cols;
+                    for (int y = 0; y < sample.rows; y++, dst += w) {
+                        const uchar *src = sample.ptr<uchar>(y);
+                        for (int x = 0; x < w; x++)
+                            dst[x] = src[w - 1 - x];
+                    }
+                }
+                else {
+                    Mat mirrored;
+                    flip(sample, mirrored, 1);
+                    mirrored.reshape(1, 1).convertTo(mirroredRow, CV_32F);
+                }
+            }
+        }
+    }
+
+private:
+    const vector<Mat> &m_samples;
+    Mat &m_data;
+    bool m_mirror;
+};
+
+// Calcula as linhas da matriz de Gram G = X * X^T (N x N) de cada thread.
+class GramRowsBody : public ParallelLoopBody
+{
+public:
+    GramRowsBody(const Mat &data, Mat &gram) : m_data(data), m_gram(gram) {}
+
+    virtual void operator()(const Range &range) const
+    {
+        Mat rows = m_gram.rowRange(range.start, range.end);
+        gemm(m_data.rowRange(range.start, range.end), m_data, 1.0, noArray(), 0.0, rows, GEMM_2_T);
+    }
+
+private:
+    const Mat &m_data;
+    Mat &m_gram;
+};
+
+// Leva os autovetores da matriz de Gram de volta para o espaço dos pixels (U = X^T * V), dividindo os pixels entre as threads.
+class BackProjectBody : public ParallelLoopBody
+{
+public:
+    BackProjectBody(const Mat &data, const Mat &gramVectors, Mat &eigenvectors) : m_data(data), m_gramVectors(gramVectors), m_eigenvectors(eigenvectors) {}
+
+    virtual void operator()(const Range &range) const
+    {
+        Mat rows = m_eigenvectors.rowRange(range.start, range.end);
+        gemm(m_data.colRange(range.start, range.end), m_gramVectors, 1.0, noArray(), 0.0, rows, GEMM_1_T + GEMM_2_T);
+    }
+
+private:
+    const Mat &m_data;
+    const Mat &m_gramVectors;
+    Mat &m_eigenvectors;
+};
+
+
+// Converte um float para float16 (arredondando), zerando os valores pequenos demais para um float16 normal, como halfToFloat() faz.
+static inline ushort floatToHalf(float f)
+{
+    Cv32suf u;
+    u.f = f;
+    unsigned sign = (u.u >> 16) & 0x8000;
+    int exponent = (int)((u.u >> 23) & 0xff) - 127 + 15;
+    unsigned mantissa = u.u & 0x7fffff;
+    if (exponent <= 0)
+        return (ushort)sign;
+    // Arredonda a mantissa de 23 para 10 bits. Se ela passar de 10 bits, o carry aumenta o expoente, o que também está certo.
+    unsigned half = ((unsigned)exponent << 10) + (mantissa >> 13) + ((mantissa >> 12) & 1);
+    if (half >= 0x7c00)
+        half = 0x7bff;  // Maior float16 finito.
+    return (ushort)(sign | half);
+}
+
+static inline float halfToFloat(ushort h)
+{
+    Cv32suf u;
+    unsigned exponentMantissa = h & 0x7fff;
+    u.u = ((unsigned)(h & 0x8000) << 16) | ((h & 0x7c00) ? ((exponentMantissa << 13) + (112 << 23)) : 0);
+    return u.f;
+}
+
+// Produto escalar de pixels de 8 bits com um autovetor int8, em inteiros de 32 bits (4900 * 255 * 127 cabe com folga).
+static int dotProductU8S8(const uchar *x, const schar *q, int n)
+{
+    int i = 0;
+    int sum = 0;
+#if CV_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    for (; i <= n - 16; i += 16) {
+        __m128i xv = _mm_loadu_si128((const __m128i*)(x + i));
+        __m128i qv = _mm_loadu_si128((const __m128i*)(q + i));
+        // Pixels sem sinal para 16 bits, e os valores int8 para 16 bits com sinal.
+        __m128i xlo = _mm_unpacklo_epi8(xv, zero);
+        __m128i xhi = _mm_unpackhi_epi8(xv, zero);
+        __m128i qlo = _mm_srai_epi16(_mm_unpacklo_epi8(qv, qv), 8);
+        __m128i qhi = _mm_srai_epi16(_mm_unpackhi_epi8(qv, qv), 8);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(xlo, qlo));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(xhi, qhi));
+    }
+    int CV_DECL_ALIGNED(16) buf[4];
+    _mm_store_si128((__m128i*)buf, acc);
+    sum = buf[0] + buf[1] + buf[2] + buf[3];
+#endif
+    for (; i < n; i++)
+        sum += (int)x[i] * (int)q[i];
+    return sum;
+}
+
+// Produto escalar de um vetor float com um autovetor float16.
+static float dotProductF32F16(const float *x, const ushort *h, int n)
+{
+    int i = 0;
+    float sum = 0;
+#if CV_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i signMask = _mm_set1_epi32(0x8000);
+    __m128i exponentMask = _mm_set1_epi32(0x7c00);
+    __m128i valueMask = _mm_set1_epi32(0x7fff);
+    __m128i rebias = _mm_set1_epi32(112 << 23);
+    __m128 acc = _mm_setzero_ps();
+    for (; i <= n - 8; i += 8) {
+        __m128i hv = _mm_loadu_si128((const __m128i*)(h + i));
+        __m128i halves[2] = {_mm_unpacklo_epi16(hv, zero), _mm_unpackhi_epi16(hv, zero)};
+        for (int j = 0; j < 2; j++) {
+            // Mesma conversão que halfToFloat(), 4 valores de cada vez.
+            __m128i v = halves[j];
+            __m128i isNormal = _mm_cmpgt_epi32(_mm_and_si128(v, exponentMask), zero);
+            __m128i bits = _mm_add_epi32(_mm_slli_epi32(_mm_and_si128(v, valueMask), 13), rebias);
+            bits = _mm_or_si128(_mm_and_si128(bits, isNormal), _mm_slli_epi32(_mm_and_si128(v, signMask), 16));
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + i + j*4), _mm_castsi128_ps(bits)));
+        }
+    }
+    float CV_DECL_ALIGNED(16) buf[4];
+    _mm_store_ps(buf, acc);
+    sum = buf[0] + buf[1] + buf[2] + buf[3];
+#endif
+    for (; i < n; i++)
+        sum += x[i] * halfToFloat(h[i]);
+    return sum;
+}
+
+
+FastSubspaceFaceRecognizer::FastSubspaceFaceRecognizer(bool useFisher, int numComponents, double threshold)
+    : _useFisher(useFisher), _num_components(numComponents), _explained_variance(0.0), _threshold(threshold), _mirror(false), _quantization(PROJECTION_FLOAT32)
+{
+}
+
+// Quantos dos primeiros autovalores (do maior para o menor) são necessários para explicar a fração 'varianceFraction' da soma de todos.
+static int countComponentsForVariance(const Mat &eigenvalues, double varianceFraction)
+{
+    int k = (int)eigenvalues.total();
+    if (varianceFraction <= 0.0 || varianceFraction >= 1.0)
+        return k;
+    Mat values;
+    eigenvalues.reshape(1, 1).convertTo(values, CV_64F);
+    const double *v = values.ptr<double>(0);
+    double total = 0;
+    for (int i = 0; i < k; i++)
+        total += max(v[i], 0.0);
+    double sum = 0;
+    for (int i = 0; i < k; i++) {
+        sum += max(v[i], 0.0);
+        if (sum >= varianceFraction * total)
+            return i + 1;
+    }
+    return k;
+}
+
+void FastSubspaceFaceRecognizer::reduceComponents(int maxComponents, double varianceFraction)
+{
+    if (_eigenvectors.empty())
+        return;
+    int k = countComponentsForVariance(_eigenvalues, varianceFraction);
+    if (maxComponents > 0)
+        k = min(k, maxComponents);
+    k = max(k, 1);
+    if (k >= _eigenvectors.cols)
+        return;
+
+    _eigenvectors = _eigenvectors.colRange(0, k).clone();
+    _eigenvalues = _eigenvalues.reshape(1, (int)_eigenvalues.total()).rowRange(0, k).clone();
+    for (size_t i = 0; i < _projections.size(); i++)
+        _projections[i] = _projections[i].colRange(0, k).clone();
+    updateQuantizedEigenvectors();
+}
+
+void FastSubspaceFaceRecognizer::setProjectionQuantization(int quantization)
+{
+    if (quantization < PROJECTION_FLOAT32 || quantization > PROJECTION_INT8)
+        CV_Error(CV_StsBadArg, format("Unknown projection quantization %d.", quantization));
+    _quantization = quantization;
+    updateQuantizedEigenvectors();
+}
+
+// Quantiza cada autovetor (uma coluna de '_eigenvectors') com sua própria escala, para que seu maior valor use toda a faixa do tipo.
+void FastSubspaceFaceRecognizer::updateQuantizedEigenvectors()
+{
+    _qEigenvectors.release();
+    _qScales.clear();
+    _qOffsets.clear();
+    if (_quantization == PROJECTION_FLOAT32 || _eigenvectors.empty())
+        return;
+
+    int d = _eigenvectors.rows;
+    int k = _eigenvectors.cols;
+    Mat vectors = _eigenvectors.t();    // Um autovetor por linha, para que cada produto escalar leia memória contínua.
+    _qEigenvectors.create(k, d, _quantization == PROJECTION_INT8 ? CV_8S : CV_16U);
+    _qScales.resize(k);
+    _qOffsets.resize(k, 0.0f);
+    for (int i = 0; i < k; i++) {
+        const float *v = vectors.ptr<float>(i);
+        double maxAbs = 0;
+        minMaxLoc(abs(vectors.row(i)), 0, &maxAbs);
+        maxAbs = max(maxAbs, 1e-20);
+        if (_quantization == PROJECTION_INT8) {
+            float scale = (float)(maxAbs / 127.0);
+            schar *q = _qEigenvectors.ptr<schar>(i);
+            const float *mean = _mean.ptr<float>(0);
+            double offset = 0;
+            for (int j = 0; j < d; j++) {
+                q[j] = saturate_cast<schar>(v[j] / scale);
+                offset += mean[j] * q[j];
+            }
+            _qScales[i] = scale;
+            _qOffsets[i] = (float)(offset * scale);
+        }
+        else {
+            float scale = (float)maxAbs;
+            ushort *h = _qEigenvectors.ptr<ushort>(i);
+            for (int j = 0; j < d; j++)
+                h[j] = floatToHalf(v[j] / scale);
+            _qScales[i] = scale;
+        }
+    }
+}
+
+Mat FastSubspaceFaceRecognizer::project(const Mat &face) const
+{
+    Mat src = face;
+    if (!src.isContinuous())
+        src = src.clone();
+    src = src.reshape(1, 1);
+
+    // int8 precisa dos pixels de 8 bits originais, então usa float para outros tipos de imagem.
+    int quantization = _quantization;
+    if (quantization == PROJECTION_INT8 && src.type() != CV_8UC1)
+        quantization = PROJECTION_FLOAT32;
+    if (quantization == PROJECTION_FLOAT32 || _qEigenvectors.empty())
+        return subspaceProject(_eigenvectors, _mean, src);
+
+    int d = _eigenvectors.rows;
+    int k = _eigenvectors.cols;
+    Mat projection = Mat(1, k, CV_32F);
+    float *y = projection.ptr<float>(0);
+    if (quantization == PROJECTION_INT8) {
+        // (x - mean) . q * scale  =  x . q * scale - offset, então os pixels não precisam ser convertidos para float.
+        const uchar *x = src.ptr<uchar>(0);
+        for (int i = 0; i < k; i++)
+            y[i] = dotProductU8S8(x, _qEigenvectors.ptr<schar>(i), d) * _qScales[i] - _qOffsets[i];
+    }
+    else {
+        Mat centered;
+        src.convertTo(centered, CV_32F);
+        centered -= _mean;
+        const float *x = centered.ptr<float>(0);
+        for (int i = 0; i < k; i++)
+            y[i] = dotProductF32F16(x, _qEigenvectors.ptr<ushort>(i), d) * _qScales[i];
+    }
+    return projection;
+}
+
+// PCA dos dados (já sem a média, um rosto por linha) usando a matriz de Gram, já que há menos rostos (N) do que pixels (D).
+// Se v é um autovetor de X * X^T com autovalor L, então X^T * v / sqrt(L) é um autovetor unitário de X^T * X com o mesmo autovalor,
+// e a projeção do rosto i nesse autovetor é simplesmente sqrt(L) * v[i].
+void FastSubspaceFaceRecognizer::trainPCA(const Mat &data, int numComponents, double varianceFraction, Mat &eigenvectors, Mat &eigenvalues, Mat &projections)
+{
+    int n = data.rows;
+    int d = data.cols;
+
+    Mat gram = Mat(n, n, CV_32F);
+    parallel_for_(Range(0, n), GramRowsBody(data, gram));
+
+    Mat gram64, gramValues, gramVectors;
+    gram.convertTo(gram64, CV_64F);
+    eigen(gram64, gramValues, gramVectors);     // Os autovetores ficam nas linhas, do maior autovalor para o menor.
+
+    // Mantém apenas os autovalores que não são só erro numérico.
+    int k = 0;
+    double minEigenvalue = max(gramValues.at<double>(0), 0.0) * MIN_EIGENVALUE_RATIO;
+    while (k < n && gramValues.at<double>(k) > minEigenvalue)
+        k++;
+    // Só leva de volta para o espaço dos pixels os autovetores que serão mantidos.
+    k = min(k, countComponentsForVariance(gramValues.rowRange(0, max(k, 1)), varianceFraction));
+    if (numComponents > 0)
+        k = min(k, numComponents);
+    if (k <= 0)
+        CV_Error(CV_StsBadArg, "The training faces are all identical, so there is nothing to learn.");
+
+    Mat scaledVectors = Mat(k, n, CV_32F);
+    projections.create(n, k, CV_32F);
+    for (int i = 0; i < k; i++) {
+        double sqrtL = sqrt(gramValues.at<double>(i));
+        Mat row = scaledVectors.row(i);
+        gramVectors.row(i).convertTo(row, CV_32F, 1.0 / sqrtL);
+        Mat col = projections.col(i);
+        Mat(gramVectors.row(i).t()).convertTo(col, CV_32F, sqrtL);
+    }
+
+    eigenvectors.create(d, k, CV_32F);
+    parallel_for_(Range(0, d), BackProjectBody(data, scaledVectors, eigenvectors), max(d / PIXELS_PER_STRIPE, 1));
+
+    // Mesma escala que cv::PCA, que divide a covariância pelo número de rostos.
+    eigenvalues = gramValues.rowRange(0, k) / (double)n;
+}
+
+void FastSubspaceFaceRecognizer::train(InputArrayOfArrays _src, InputArray _local_labels)
+{
+    if (_src.total() == 0)
+        CV_Error(CV_StsBadArg, "Empty training data was given. You'll need more than one sample to learn a model.");
+    vector<Mat> src;
+    _src.getMatVector(src);
+    Mat labels = _local_labels.getMat();
+    int n = (int)src.size();
+    if ((int)labels.total() != n)
+        CV_Error(CV_StsBadArg, format("The number of samples (src) must equal the number of labels (labels). Was len(samples)=%d, len(labels)=%d.", n, (int)labels.total()));
+    int d = (int)src[0].total();
+    for (int i = 0; i < n; i++) {
+        if ((int)src[i].total() != d)
+            CV_Error(CV_StsBadArg, format("All training faces must have the same size. Face %d has %d pixels instead of %d.", i, (int)src[i].total(), d));
+    }
+    Mat labels32;
+    labels.reshape(1, n).convertTo(labels32, CV_32S);
+    if (_mirror) {
+        // Os rostos espelhados ficam depois dos originais, com os mesmos nomes.
+        labels32.push_back(labels32.clone());
+        n *= 2;
+    }
+
+    // Monta a matriz de dados, um rosto por linha, e tira a média de cada pixel.
+    Mat data = Mat(n, d, CV_32F);
+    parallel_for_(Range(0, (int)src.size()), ConvertSamplesBody(src, data, _mirror));
+    reduce(data, _mean, 0, CV_REDUCE_AVG);
+    for (int i = 0; i < n; i++) {
+        Mat row = data.row(i);
+        row -= _mean;
+    }
+
+    Mat projections;
+    if (!_useFisher) {
+        trainPCA(data, _num_components, _explained_variance, _eigenvectors, _eigenvalues, projections);
+    }
+    else {
+        // Fisherfaces: PCA com N - C componentes (para que a matriz de dispersão dentro das classes não seja singular), e depois LDA.
+        vector<int> classes;
+        for (int i = 0; i < n; i++) {
+            if (find(classes.begin(), classes.end(), labels32.at<int>(i)) == classes.end())
+                classes.push_back(labels32.at<int>(i));
+        }
+        int c = (int)classes.size();
+        if (c < 2)
+            CV_Error(CV_StsBadArg, "At least two classes are needed to perform a LDA. Reason: Only one class was given!");
+        int pcaComponents = n - c;
+        if (pcaComponents < 1)
+            CV_Error(CV_StsBadArg, "Fisherfaces needs more faces than people.");
+
+        Mat pcaVectors, pcaValues, pcaProjections;
+        trainPCA(data, pcaComponents, 0.0, pcaVectors, pcaValues, pcaProjections);
+
+        int ldaComponents = (_num_components > 0 && _num_components < c) ? _num_components : c - 1;
+        LDA lda(pcaProjections, labels32, ldaComponents);
+        Mat ldaVectors;
+        lda.eigenvectors().convertTo(ldaVectors, CV_32F);
+        _eigenvalues = lda.eigenvalues().clone();
+        gemm(pcaVectors, ldaVectors, 1.0, noArray(), 0.0, _eigenvectors);
+        gemm(pcaProjections, ldaVectors, 1.0, noArray(), 0.0, projections);
+    }
+
+    _labels = labels32;
+    _projections.clear();
+    for (int i = 0; i < n; i++)
+        _projections.push_back(projections.row(i).clone());
+
+    // Para Fisherfaces, a variância explicada é calculada com os autovalores do LDA.
+    if (_useFisher)
+        reduceComponents(0, _explained_variance);
+    updateQuantizedEigenvectors();
+}
+
+void FastSubspaceFaceRecognizer::predict(InputArray _src, int &minClass, double &minDist) const
+{
+    if (_projections.empty())
+        CV_Error(CV_StsError, "This FaceRecognizer is not computed yet. Did you call FaceRecognizer::train or FaceRecognizer::load?");
+    Mat src = _src.getMat();
+    if ((int)src.total() != _eigenvectors.rows)
+        CV_Error(CV_StsBadArg, format("Wrong input image size. Reason: Training and Test images must be of equal size! Expected an image with %d elements, but got %d.", _eigenvectors.rows, (int)src.total()));
+    if (!src.isContinuous())
+        src = src.clone();
+
+    Mat q = project(src);
+    minDist = DBL_MAX;
+    minClass = -1;
+    for (size_t i = 0; i < _projections.size(); i++) {
+        double dist = norm(_projections[i], q, NORM_L2);
+        if ((dist < minDist) && (dist < _threshold)) {
+            minDist = dist;
+            minClass = _labels.at<int>((int)i);
+        }
+    }
+}
+
+int FastSubspaceFaceRecognizer::predict(InputArray src) const
+{
+    int label;
+    double dummy;
+    predict(src, label, dummy);
+    return label;
+}
+
+Ptr<FaceRecognizer> FastSubspaceFaceRecognizer::relabeled(int label, int newLabel) const
+{
+    // O objeto é sempre um FastEigenfaces ou um FastFisherfaces. Os Mat da cópia apontam para os mesmos dados, e só a galeria é montada de novo.
+    FastSubspaceFaceRecognizer *copy;
+    if (_useFisher)
+        copy = new FastFisherfaces(*static_cast<const FastFisherfaces*>(this));
+    else
+        copy = new FastEigenfaces(*static_cast<const FastEigenfaces*>(this));
+    Ptr<FaceRecognizer> result = copy;
+
+    copy->_projections.clear();
+    vector<int> labels;
+    for (size_t i = 0; i < _projections.size(); i++) {
+        int l = _labels.at<int>((int)i);
+        if (l == label) {
+            if (newLabel < 0)
+                continue;
+            l = newLabel;
+        }
+        copy->_projections.push_back(_projections[i]);
+        labels.push_back(l);
+    }
+    copy->_labels = Mat(labels, true);
+    return result;
+}
+
+// Mesmo formato dos arquivos salvos pelas classes Eigenfaces e Fisherfaces do OpenCV.
+void FastSubspaceFaceRecognizer::save(FileStorage &fs) const
+{
+    fs << "num_components" << _num_components;
+    fs << "mean" << _mean;
+    fs << "eigenvalues" << _eigenvalues;
+    fs << "eigenvectors" << _eigenvectors;
+    fs << "projections" << "[";
+    for (size_t i = 0; i < _projections.size(); i++)
+        fs << _projections[i];
+    fs << "]";
+    fs << "labels" << _labels;
+    fs << "quantization" << _quantization;
+}
+
+void FastSubspaceFaceRecognizer::load(const FileStorage &fs)
+{
+    fs["num_components"] >> _num_components;
+    fs["mean"] >> _mean;
+    fs["eigenvalues"] >> _eigenvalues;
+    fs["eigenvectors"] >> _eigenvectors;
+    _projections.clear();
+    FileNode projections = fs["projections"];
+    for (FileNodeIterator it = projections.begin(); it != projections.end(); ++it) {
+        Mat m;
+        *it >> m;
+        _projections.push_back(m);
+    }
+    fs["labels"] >> _labels;
+    if (!fs["quantization"].empty())
+        fs["quantization"] >> _quantization;
+
+    // Arquivos salvos pelo OpenCV usam CV_64F, mas aqui tudo é CV_32F.
+    _mean.convertTo(_mean, CV_32F);
+    _eigenvectors.convertTo(_eigenvectors, CV_32F);
+    for (size_t i = 0; i < _projections.size(); i++)
+        _projections[i].convertTo(_projections[i], CV_32F);
+
+    updateQuantizedEigenvectors();
+}
+
+
+CV_INIT_ALGORITHM(FastEigenfaces, "FaceRecognizer.FastEigenfaces",
+                  obj.info()->addParam(obj, "ncomponents", obj._num_components);
+                  obj.info()->addParam(obj, "variance", obj._explained_variance);
+                  obj.info()->addParam(obj, "mirror", obj._mirror);
+                  obj.info()->addParam(obj, "threshold", obj._threshold);
+                  obj.info()->addParam(obj, "projections", obj._projections, true);
+                  obj.info()->addParam(obj, "labels", obj._labels, true);
+                  obj.info()->addParam(obj, "eigenvectors", obj._eigenvectors, true);
+                  obj.info()->addParam(obj, "eigenvalues", obj._eigenvalues, true);
+                  obj.info()->addParam(obj, "mean", obj._mean, true);
+                  obj.info()->addParam(obj, "quantization", obj._quantization, false, 0, (void (Algorithm::*)(int))&FastSubspaceFaceRecognizer::setProjectionQuantization));
+
+CV_INIT_ALGORITHM(FastFisherfaces, "FaceRecognizer.FastFisherfaces",
+                  obj.info()->addParam(obj, "ncomponents", obj._num_components);
+                  obj.info()->addParam(obj, "variance", obj._explained_variance);
+                  obj.info()->addParam(obj, "mirror", obj._mirror);
+                  obj.info()->addParam(obj, "threshold", obj._threshold);
+                  obj.info()->addParam(obj, "projections", obj._projections, true);
+                  obj.info()->addParam(obj, "labels", obj._labels, true);
+                  obj.info()->addParam(obj, "eigenvectors", obj._eigenvectors, true);
+                  obj.info()->addParam(obj, "eigenvalues", obj._eigenvalues, true);
+                  obj.info()->addParam(obj, "mean", obj._mean, true);
+                  obj.info()->addParam(obj, "quantization", obj._quantization, false, 0, (void (Algorithm::*)(int))&FastSubspaceFaceRecognizer::setProjectionQuantization));
+
+Ptr<FaceRecognizer> createFastEigenFaceRecognizer(int numComponents, double threshold)
+{
+    return new FastEigenfaces(numComponents, threshold);
+}
+
+Ptr<FaceRecognizer> createFastFisherFaceRecognizer(int numComponents, double threshold)
+{
+    return new FastFisherfaces(numComponents, threshold);
+}
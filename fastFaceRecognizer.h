@@ -0,0 +1,110 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include <float.h>
+#include "opencv2/opencv.hpp"
+
+
+using namespace cv;
+using namespace std;
+
+// Eigenfaces e Fisherfaces com o mesmo modelo que as classes do OpenCV (as mesmas propriedades "mean", "eigenvectors", "eigenvalues",
+// "projections" e "labels", então reconstructFace() e showTrainingDebugData() continuam funcionando), mas com um treinamento mais rápido:
+// - A matriz de dados é montada convertendo cada rosto diretamente para sua linha, sem cópias temporárias.
+// - Como há bem menos rostos (N) do que pixels (D), os autovetores são calculados a partir da matriz de Gram N x N (X * X^T)
+//   em vez da matriz de covariância D x D, e depois levados de volta para o espaço dos pixels.
+// - A matriz de Gram e a volta para o espaço dos pixels (as partes O(N^2 * D)) são divididas entre as threads com cv::parallel_for_.
+// Registrados como "FaceRecognizer.FastEigenfaces" e "FaceRecognizer.FastFisherfaces", para serem usados com Algorithm::create().
+//
+// O número de componentes pode ser limitado por um orçamento ("ncomponents") e/ou pela fração da variância explicada ("variance",
+// por exemplo 0.95 para manter apenas os autovetores que explicam 95% da variância). Menos componentes deixam a projeção, a reconstrução
+// e a busca na galeria mais rápidas, em troca de um pouco de precisão. Veja benchRecognition para a precisão e a latência de cada escolha.
+//
+// Com a propriedade "mirror", o treinamento também usa a imagem espelhada de cada rosto, como se ela estivesse na lista de rostos:
+// as linhas espelhadas são lidas dos rostos originais ao montar a matriz de dados, então as cópias espelhadas não precisam ser guardadas.
+//
+// Opcionalmente, a projeção dos rostos pode usar autovetores quantizados (propriedade "quantization"), que ocupam 2x ou 4x menos memória,
+// com uma escala por componente. Os autovetores quantizados são calculados ao treinar ou carregar o modelo (o arquivo salvo continua
+// com os autovetores float), e a projeção usa produtos escalares com SSE2. Veja benchRecognition para a precisão em relação ao float.
+enum ProjectionQuantization {PROJECTION_FLOAT32=0, PROJECTION_FLOAT16, PROJECTION_INT8};
+
+class FastSubspaceFaceRecognizer : public FaceRecognizer
+{
+public:
+    FastSubspaceFaceRecognizer(bool useFisher, int numComponents = 0, double threshold = DBL_MAX);
+
+    void train(InputArrayOfArrays src, InputArray labels);
+
+    int predict(InputArray src) const;
+    void predict(InputArray src, int &label, double &dist) const;
+
+    void save(FileStorage &fs) const;
+    void load(const FileStorage &fs);
+    using FaceRecognizer::save;
+    using FaceRecognizer::load;
+
+    // Se true, treina também com a imagem espelhada (esquerda-direita) de cada rosto, sem precisar das cópias espelhadas.
+    void setMirrorFaces(bool mirror) { _mirror = mirror; }
+    bool getMirrorFaces() const { return _mirror; }
+
+    // Fração da variância (de 0 a 1) que os componentes mantidos devem explicar. 0 ou 1 mantêm todos os componentes.
+    void setExplainedVariance(double fraction) { _explained_variance = fraction; }
+    double getExplainedVariance() const { return _explained_variance; }
+
+    // Reduz um modelo já treinado, mantendo no máximo 'maxComponents' componentes (0 para não limitar), e apenas os primeiros componentes
+    // que explicam a fração 'varianceFraction' da variância (0 ou 1 para não limitar). Trunca "eigenvectors", "eigenvalues" e "projections".
+    void reduceComponents(int maxComponents, double varianceFraction = 0.0);
+
+    // Copia o modelo treinado trocando o nome 'label' por 'newLabel' na galeria ("projections" e "labels"), ou sem os rostos da pessoa
+    // se 'newLabel' for negativo, sem treinar de novo. A cópia compartilha os autovetores e a média, que não mudam: o subespaço ainda tem
+    // a contribuição dos rostos removidos até o próximo treinamento, mas a pessoa nunca mais é reconhecida.
+    Ptr<FaceRecognizer> relabeled(int label, int newLabel) const;
+
+    // Um dos valores de ProjectionQuantization.
+    void setProjectionQuantization(int quantization);
+    int getProjectionQuantization() const { return _quantization; }
+
+    // Projeta um rosto no subespaço (como subspaceProject()), usando os autovetores quantizados se a quantização estiver ligada.
+    // Retorna uma linha CV_32F com um valor por componente.
+    Mat project(const Mat &face) const;
+
+protected:
+    void trainPCA(const Mat &data, int numComponents, double varianceFraction, Mat &eigenvectors, Mat &eigenvalues, Mat &projections);
+    void updateQuantizedEigenvectors();
+
+    bool _useFisher;
+    int _num_components;
+    double _explained_variance;
+    double _threshold;
+    bool _mirror;
+    Mat _eigenvectors;      // D x K, um autovetor por coluna (CV_32F).
+    Mat _eigenvalues;
+    Mat _mean;              // 1 x D (CV_32F).
+    vector<Mat> _projections;
+    Mat _labels;
+
+    int _quantization;
+    Mat _qEigenvectors;     // K x D, um autovetor quantizado por linha (CV_8S para int8, CV_16U com valores float16 para float16).
+    vector<float> _qScales;     // Escala de cada autovetor quantizado.
+    vector<float> _qOffsets;    // Para int8: a projeção da média, que é subtraída do produto com os pixels (sem tirar a média antes).
+};
+
+class FastEigenfaces : public FastSubspaceFaceRecognizer
+{
+public:
+    FastEigenfaces(int numComponents = 0, double threshold = DBL_MAX) : FastSubspaceFaceRecognizer(false, numComponents, threshold) {}
+    AlgorithmInfo* info() const;
+};
+
+class FastFisherfaces : public FastSubspaceFaceRecognizer
+{
+public:
+    FastFisherfaces(int numComponents = 0, double threshold = DBL_MAX) : FastSubspaceFaceRecognizer(true, numComponents, threshold) {}
+    AlgorithmInfo* info() const;
+};
+
+Ptr<FaceRecognizer> createFastEigenFaceRecognizer(int numComponents = 0, double threshold = DBL_MAX);
+Ptr<FaceRecognizer> createFastFisherFaceRecognizer(int numComponents = 0, double threshold = DBL_MAX);
@@ -0,0 +1,242 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const int LBP_BINS = 256;                   // Um bin para cada código LBP de 8 vizinhos.
+const int GALLERY_ROWS_PER_STRIPE = 32;     // Quantos rostos da galeria cada thread compara de uma vez.
+
+
+#include "fastLBPHFaceRecognizer.h"     // LBPH com códigos LBP e distância chi-quadrado usando SSE2.
+
+#include <algorithm>
+
+#include "opencv2/core/internal.hpp"    // Para CV_INIT_ALGORITHM.
+
+
+// Calcula o código LBP de cada pixel que não está na borda: cada um dos 8 vizinhos que é maior ou igual ao pixel central liga um bit.
+// 'codes' tem 2 linhas e 2 colunas a menos que 'src'.
+static void computeLBPCodes(const Mat &src, Mat &codes)
+{
+    int rows = src.rows - 2;
+    int cols = src.cols - 2;
+    codes.create(rows, cols, CV_8U);
+    for (int y = 0; y < rows; y++) {
+        const uchar *up = src.ptr<uchar>(y);
+        const uchar *center = src.ptr<uchar>(y + 1);
+        const uchar *down = src.ptr<uchar>(y + 2);
+        uchar *code = codes.ptr<uchar>(y);
+        int x = 0;
+#if CV_SSE2
+        // 16 pixels de cada vez: n >= c sem sinal é o mesmo que max(n, c) == n.
+        #define LBP_BIT(neighbors, bit)     _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(neighbors, c), neighbors), _mm_set1_epi8((char)(bit)))
+        for (; x <= cols - 16; x += 16) {
+            __m128i c = _mm_loadu_si128((const __m128i*)(center + x + 1));
+            __m128i v = LBP_BIT(_mm_loadu_si128((const __m128i*)(up + x)), 0x80);
+            v = _mm_or_si128(v, LBP_BIT(_mm_loadu_si128((const __m128i*)(up + x + 1)), 0x40));
+            v = _mm_or_si128(v, LBP_BIT(_mm_loadu_si128((const __m128i*)(up + x + 2)), 0x20));
+            v = _mm_or_si128(v, LBP_BIT(_mm_loadu_si128((const __m128i*)(center + x + 2)), 0x10));
+            v = _mm_or_si128(v, LBP_BIT(_mm_loadu_si128((const __m128i*)(down + x + 2)), 0x08));
+            v = _mm_or_si128(v, LBP_BIT(_mm_loadu_si128((const __m128i*)(down + x + 1)), 0x04));
+            v = _mm_or_si128(v, LBP_BIT(_mm_loadu_si128((const __m128i*)(down + x)), 0x02));
+            v = _mm_or_si128(v, LBP_BIT(_mm_loadu_si128((const __m128i*)(center + x)), 0x01));
+            _mm_storeu_si128((__m128i*)(code + x), v);
+        }
+        #undef LBP_BIT
+#endif
+        for (; x < cols; x++) {
+            uchar c = center[x + 1];
+            code[x] = (uchar)(((up[x] >= c) << 7) | ((up[x + 1] >= c) << 6) | ((up[x + 2] >= c) << 5) | ((center[x + 2] >= c) << 4) |
+                              ((down[x + 2] >= c) << 3) | ((down[x + 1] >= c) << 2) | ((down[x] >= c) << 1) | (center[x] >= c));
+        }
+    }
+}
+
+void computeLBPHistogram(const Mat &face, int gridX, int gridY, float *histogram)
+{
+    if (face.channels() != 1 || face.depth() != CV_8U)
+        CV_Error(CV_StsBadArg, "FastLBPH only works with 8-bit grayscale faces.");
+    Mat codes;
+    computeLBPCodes(face, codes);
+
+    // As células dividem a imagem dos códigos igualmente, e as colunas e linhas que sobram à direita e embaixo são ignoradas.
+    int cellWidth = codes.cols / gridX;
+    int cellHeight = codes.rows / gridY;
+    if (cellWidth <= 0 || cellHeight <= 0)
+        CV_Error(CV_StsBadArg, format("The face (%dx%d) is too small for a %dx%d grid.", face.cols, face.rows, gridX, gridY));
+
+    int cells = gridX * gridY;
+    vector<int> counts(cells * LBP_BINS, 0);
+    for (int y = 0; y < cellHeight * gridY; y++) {
+        const uchar *code = codes.ptr<uchar>(y);
+        int *cellRow = &counts[(y / cellHeight) * gridX * LBP_BINS];
+        for (int cx = 0; cx < gridX; cx++) {
+            int *hist = cellRow + cx * LBP_BINS;
+            const uchar *c = code + cx * cellWidth;
+            for (int x = 0; x < cellWidth; x++)
+                hist[c[x]]++;
+        }
+    }
+
+    float scale = 1.0f / (cellWidth * cellHeight);
+    for (int i = 0; i < cells * LBP_BINS; i++)
+        histogram[i] = counts[i] * scale;
+}
+
+// Calcula a distância do rosto para os rostos da galeria de cada thread.
+class ChiSquareBody : public ParallelLoopBody
+{
+public:
+    ChiSquareBody(const Mat &histogram, const Mat &gallery, vector<float> &distances) : m_histogram(histogram), m_gallery(gallery), m_distances(distances) {}
+
+    virtual void operator()(const Range &range) const
+    {
+        const float *h = m_histogram.ptr<float>(0);
+        int n = m_gallery.cols;
+        for (int i = range.start; i < range.end; i++)
+            m_distances[i] = chiSquareDistance(h, m_gallery.ptr<float>(i), n);
+    }
+
+private:
+    const Mat &m_histogram;
+    const Mat &m_gallery;
+    vector<float> &m_distances;
+};
+
+
+FastLBPH::FastLBPH(int gridX, int gridY, double threshold)
+    : _grid_x(gridX), _grid_y(gridY), _threshold(threshold)
+{
+}
+
+Mat FastLBPH::computeHistogram(const Mat &face) const
+{
+    Mat histogram = Mat(1, _grid_x * _grid_y * LBP_BINS, CV_32F);
+    computeLBPHistogram(face, _grid_x, _grid_y, histogram.ptr<float>(0));
+    return histogram;
+}
+
+void FastLBPH::computeDistances(const Mat &histogram, vector<float> &distances) const
+{
+    distances.resize(_histograms.rows);
+    if (_histograms.rows > 0)
+        parallel_for_(Range(0, _histograms.rows), ChiSquareBody(histogram, _histograms, distances), max(_histograms.rows / GALLERY_ROWS_PER_STRIPE, 1));
+}
+
+void FastLBPH::addSamples(const vector<Mat> &src, const Mat &labels)
+{
+    int n = (int)src.size();
+    if ((int)labels.total() != n)
+        CV_Error(CV_StsBadArg, format("The number of samples (src) must equal the number of labels (labels). Was len(samples)=%d, len(labels)=%d.", n, (int)labels.total()));
+    Mat labels32;
+    labels.reshape(1, n).convertTo(labels32, CV_32S);
+
+    // Os histogramas novos vão direto para o fim da galeria.
+    int first = _histograms.rows;
+    for (int i = 0; i < n; i++)
+        _histograms.push_back(computeHistogram(src[i]));
+    _labels.push_back(labels32);
+    CV_Assert(_histograms.rows == first + n && _labels.rows == _histograms.rows);
+}
+
+void FastLBPH::train(InputArrayOfArrays _src, InputArray _local_labels)
+{
+    if (_src.total() == 0)
+        CV_Error(CV_StsBadArg, "Empty training data was given. You'll need more than one sample to learn a model.");
+    vector<Mat> src;
+    _src.getMatVector(src);
+    _histograms.release();
+    _labels.release();
+    addSamples(src, _local_labels.getMat());
+}
+
+void FastLBPH::update(InputArrayOfArrays _src, InputArray _local_labels)
+{
+    if (_src.total() == 0)
+        return;
+    vector<Mat> src;
+    _src.getMatVector(src);
+    addSamples(src, _local_labels.getMat());
+}
+
+void FastLBPH::predict(InputArray _src, int &minClass, double &minDist) const
+{
+    if (_histograms.empty())
+        CV_Error(CV_StsError, "This FaceRecognizer is not computed yet. Did you call FaceRecognizer::train or FaceRecognizer::load?");
+    Mat histogram = computeHistogram(_src.getMat());
+    if (histogram.cols != _histograms.cols)
+        CV_Error(CV_StsBadArg, format("Wrong input image size. The face gives %d histogram bins, but the training faces gave %d.", histogram.cols, _histograms.cols));
+
+    vector<float> distances;
+    computeDistances(histogram, distances);
+    minDist = DBL_MAX;
+    minClass = -1;
+    for (size_t i = 0; i < distances.size(); i++) {
+        if ((distances[i] < minDist) && (distances[i] < _threshold)) {
+            minDist = distances[i];
+            minClass = _labels.at<int>((int)i);
+        }
+    }
+}
+
+int FastLBPH::predict(InputArray src) const
+{
+    int label;
+    double dummy;
+    predict(src, label, dummy);
+    return label;
+}
+
+Ptr<FaceRecognizer> FastLBPH::relabeled(int label, int newLabel) const
+{
+    FastLBPH *copy = new FastLBPH(_grid_x, _grid_y, _threshold);
+    Ptr<FaceRecognizer> result = copy;
+    if (_histograms.empty())
+        return result;
+
+    int kept = 0;
+    for (int i = 0; i < _labels.rows; i++)
+        kept += (newLabel >= 0 || _labels.at<int>(i) != label) ? 1 : 0;
+    copy->_histograms.create(kept, _histograms.cols, CV_32F);
+    copy->_labels.create(kept, 1, CV_32S);
+    for (int i = 0, j = 0; i < _labels.rows; i++) {
+        int l = _labels.at<int>(i);
+        if (l == label) {
+            if (newLabel < 0)
+                continue;
+            l = newLabel;
+        }
+        _histograms.row(i).copyTo(copy->_histograms.row(j));
+        copy->_labels.at<int>(j) = l;
+        j++;
+    }
+    return result;
+}
+
+void FastLBPH::save(FileStorage &fs) const
+{
+    fs << "grid_x" << _grid_x;
+    fs << "grid_y" << _grid_y;
+    fs << "histograms" << _histograms;
+    fs << "labels" << _labels;
+}
+
+void FastLBPH::load(const FileStorage &fs)
+{
+    fs["grid_x"] >> _grid_x;
+    fs["grid_y"] >> _grid_y;
+    fs["histograms"] >> _histograms;
+    fs["labels"] >> _labels;
+}
+
+
+CV_INIT_ALGORITHM(FastLBPH, "FaceRecognizer.FastLBPH",
+                  obj.info()->addParam(obj, "grid_x", obj._grid_x);
+                  obj.info()->addParam(obj, "grid_y", obj._grid_y);
+                  obj.info()->addParam(obj, "threshold", obj._threshold);
+                  obj.info()->addParam(obj, "histograms", obj._histograms, true);
+                  obj.info()->addParam(obj, "labels", obj._labels, true));
+
+Ptr<FaceRecognizer> createFastLBPHFaceRecognizer(int gridX, int gridY, double threshold)
+{
+    return new FastLBPH(gridX, gridY, threshold);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include <float.h>
+#include "opencv2/opencv.hpp"
+
+#if CV_SSE2
+    #include <emmintrin.h>
+#endif
+
+
+using namespace cv;
+using namespace std;
+
+// LBPH (Local Binary Patterns Histograms, Ahonen et al, 2006) ajustado para os rostos pré-processados de 70x70 do main.cpp:
+// - Os códigos LBP (raio 1, 8 vizinhos, na vizinhança 3x3 de cada pixel) são calculados com SSE2, 16 pixels de cada vez.
+// - Os histogramas de todas as células de um rosto ficam em uma única linha contínua (célula por célula, 256 bins cada), e a galeria
+//   inteira é uma única matriz, um rosto por linha, em vez de um Mat separado para cada rosto.
+// - A distância chi-quadrado simétrica, sum((a - b)^2 / (a + b)), é calculada com SSE2 para todos os rostos da galeria,
+//   dividindo a galeria entre as threads.
+// Novos rostos podem ser acrescentados com update(), sem treinar de novo os anteriores.
+// Registrado como "FaceRecognizer.FastLBPH", para ser usado com Algorithm::create(). Rostos mais distantes que "threshold" do rosto
+// mais próximo da galeria são reconhecidos como -1 (pessoa desconhecida). Os códigos LBP não são os mesmos do LBPH do OpenCV
+// (que interpola os vizinhos em um círculo), então os arquivos salvos pelos dois não são compatíveis.
+class FastLBPH : public FaceRecognizer
+{
+public:
+    FastLBPH(int gridX = 8, int gridY = 8, double threshold = DBL_MAX);
+
+    void train(InputArrayOfArrays src, InputArray labels);
+    void update(InputArrayOfArrays src, InputArray labels);
+
+    int predict(InputArray src) const;
+    void predict(InputArray src, int &label, double &dist) const;
+
+    void save(FileStorage &fs) const;
+    void load(const FileStorage &fs);
+    using FaceRecognizer::save;
+    using FaceRecognizer::load;
+
+    AlgorithmInfo* info() const;
+
+    // Calcula os histogramas de todas as células de um rosto de 8 bits, em uma linha CV_32F de gridX * gridY * 256 valores.
+    // Cada célula é normalizada para somar 1.
+    Mat computeHistogram(const Mat &face) const;
+
+    // Distância chi-quadrado do rosto para cada rosto da galeria, na mesma ordem que "labels".
+    void computeDistances(const Mat &histogram, vector<float> &distances) const;
+
+    // Copia o modelo treinado trocando o nome 'label' por 'newLabel' na galeria, ou sem os histogramas da pessoa se 'newLabel' for negativo.
+    Ptr<FaceRecognizer> relabeled(int label, int newLabel) const;
+
+protected:
+    void addSamples(const vector<Mat> &src, const Mat &labels);
+
+    int _grid_x;
+    int _grid_y;
+    double _threshold;
+    Mat _histograms;        // N x (gridX * gridY * 256), um rosto por linha (CV_32F).
+    Mat _labels;            // N x 1 (CV_32S).
+};
+
+Ptr<FaceRecognizer> createFastLBPHFaceRecognizer(int gridX = 8, int gridY = 8, double threshold = DBL_MAX);
+
+// Calcula os histogramas das células de um rosto de 8 bits, como FastLBPH::computeHistogram(), em 'histogram' (gridX * gridY * 256 valores).
+void computeLBPHistogram(const Mat &face, int gridX, int gridY, float *histogram);
+
+// Distância chi-quadrado simétrica entre dois histogramas. Quando a + b é 0, a - b também é, então dividir por FLT_EPSILON dá 0.
+// Fica no header para que, quando 'n' é uma constante, o compilador possa desenrolar o loop.
+inline float chiSquareDistance(const float *a, const float *b, int n)
+{
+    int i = 0;
+    float sum = 0;
+#if CV_SSE2
+    __m128 epsilon = _mm_set1_ps(FLT_EPSILON);
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i <= n - 8; i += 8) {
+        __m128 a0 = _mm_loadu_ps(a + i);
+        __m128 b0 = _mm_loadu_ps(b + i);
+        __m128 a1 = _mm_loadu_ps(a + i + 4);
+        __m128 b1 = _mm_loadu_ps(b + i + 4);
+        __m128 d0 = _mm_sub_ps(a0, b0);
+        __m128 d1 = _mm_sub_ps(a1, b1);
+        acc0 = _mm_add_ps(acc0, _mm_div_ps(_mm_mul_ps(d0, d0), _mm_max_ps(_mm_add_ps(a0, b0), epsilon)));
+        acc1 = _mm_add_ps(acc1, _mm_div_ps(_mm_mul_ps(d1, d1), _mm_max_ps(_mm_add_ps(a1, b1), epsilon)));
+    }
+    float CV_DECL_ALIGNED(16) buf[4];
+    _mm_store_ps(buf, _mm_add_ps(acc0, acc1));
+    sum = buf[0] + buf[1] + buf[2] + buf[3];
+#endif
+    for (; i < n; i++) {
+        float d = a[i] - b[i];
+        sum += d * d / std::max(a[i] + b[i], FLT_EPSILON);
+    }
+    return sum;
+}
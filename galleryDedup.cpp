@@ -0,0 +1,76 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+
+#include "galleryDedup.h"       // Evita guardar rostos quase iguais na galeria ao coletar rostos.
+
+
+GalleryDedupIndex::GalleryDedupIndex(double minDistance, Size signatureSize)
+    : m_minDistance(minDistance), m_signatureSize(signatureSize), m_accepted(0), m_rejected(0)
+{
+}
+
+// Reduz o rosto, tira a média e normaliza, em uma linha CV_32F.
+Mat GalleryDedupIndex::computeSignature(const Mat &face) const
+{
+    Mat small, signature;
+    resize(face, small, m_signatureSize, 0, 0, INTER_AREA);
+    small.reshape(1, 1).convertTo(signature, CV_32F);
+    signature -= mean(signature)[0];
+    double n = norm(signature, NORM_L2);
+    if (n > 0)
+        signature *= 1.0 / n;
+    return signature;
+}
+
+bool GalleryDedupIndex::addIfDiverse(const Mat &face, int label, double *nearestDistance)
+{
+    Mat signature = computeSignature(face);
+    Mat &signatures = m_signatures[label];
+
+    // As assinaturas têm norma 1, então |a - b|^2 = 2 - 2 * a.b, e uma multiplicação dá a distância para todos os rostos da pessoa.
+    double nearest = DBL_MAX;
+    if (!signatures.empty()) {
+        Mat products = signatures * signature.t();
+        double maxProduct;
+        minMaxLoc(products, 0, &maxProduct);
+        nearest = sqrt(max(2.0 - 2.0 * maxProduct, 0.0));
+    }
+    if (nearestDistance)
+        *nearestDistance = nearest;
+
+    if (nearest < m_minDistance) {
+        m_rejected++;
+        return false;
+    }
+    signatures.push_back(signature);
+    m_accepted++;
+    return true;
+}
+
+void GalleryDedupIndex::removePerson(int label)
+{
+    map<int, Mat>::iterator it = m_signatures.find(label);
+    if (it != m_signatures.end()) {
+        m_accepted -= it->second.rows;
+        m_signatures.erase(it);
+    }
+}
+
+void GalleryDedupIndex::relabelPerson(int label, int newLabel)
+{
+    map<int, Mat>::iterator it = m_signatures.find(label);
+    if (it == m_signatures.end() || label == newLabel)
+        return;
+    Mat signatures = it->second;
+    m_signatures.erase(it);
+    m_signatures[newLabel].push_back(signatures);
+}
+
+void GalleryDedupIndex::clear()
+{
+    m_signatures.clear();
+    m_accepted = 0;
+    m_rejected = 0;
+}
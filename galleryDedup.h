@@ -0,0 +1,46 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <float.h>
+#include "opencv2/opencv.hpp"
+
+
+using namespace cv;
+using namespace std;
+
+// Índice usado ao coletar rostos, para não encher a galeria com rostos quase iguais (que deixam o treinamento e a busca mais lentos
+// sem ensinar nada novo). Cada rosto é projetado em um espaço pequeno e fixo: o rosto reduzido para 'signatureSize' pixels, sem a média
+// e com norma 1, então mudanças de brilho e contraste não contam. Um rosto novo só é aceito se estiver a pelo menos 'minDistance'
+// de todos os rostos já aceitos da mesma pessoa (e não apenas do último rosto, como a comparação do main.cpp).
+// O espaço é fixo em vez de usar os autovetores do modelo para que funcione antes do primeiro treinamento e não mude a cada treinamento.
+class GalleryDedupIndex
+{
+public:
+    GalleryDedupIndex(double minDistance = 0.1, Size signatureSize = Size(10, 10));
+
+    // Retorna true e guarda o rosto no índice se ele é diferente o bastante dos rostos já aceitos de 'label'.
+    // Se 'nearestDistance' não for NULL, recebe a distância para o rosto mais parecido da pessoa (ou DBL_MAX se ela não tinha rostos).
+    bool addIfDiverse(const Mat &face, int label, double *nearestDistance = NULL);
+
+    // Esquece os rostos de uma pessoa, ou de todas.
+    void removePerson(int label);
+    // Junta os rostos de 'label' aos de 'newLabel'.
+    void relabelPerson(int label, int newLabel);
+    void clear();
+
+    int getAcceptedCount() const { return m_accepted; }
+    int getRejectedCount() const { return m_rejected; }
+
+private:
+    Mat computeSignature(const Mat &face) const;
+
+    double m_minDistance;
+    Size m_signatureSize;
+    map<int, Mat> m_signatures;     // Para cada pessoa, uma assinatura por linha (CV_32F).
+    int m_accepted;
+    int m_rejected;
+};
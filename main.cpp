@@ -2,7 +2,10 @@
 *   Face Recognition using Eigenfaces or Fisherfaces
 ******************************************************************************/
 
-const char *facerecAlgorithm = "FaceRecognizer.Fisherfaces";
+const char *facerecAlgorithm = "FaceRecognizer.FastFisherfaces";
+//const char *facerecAlgorithm = "FaceRecognizer.FastEigenfaces";
+//const char *facerecAlgorithm = "FaceRecognizer.FastLBPH";
+//const char *facerecAlgorithm = "FaceRecognizer.Fisherfaces";
 //const char *facerecAlgorithm = "FaceRecognizer.Eigenfaces";
 
 
@@ -14,6 +17,22 @@ const char *facerecAlgorithm = "FaceRecognizer.Fisherfaces";
 
 const float UNKNOWN_PERSON_THRESHOLD = 0.7f;
 
+// O LBPH e o FastLBPH não reconstroem o rosto (a semelhança acima é sempre 0), então para eles quem decide se a pessoa é desconhecida é
+// a distância até o rosto mais próximo: acima do limite o resultado é -1 ("Unknown"). As duas distâncias estão em escalas diferentes,
+// então cada algoritmo tem o seu limite. Rode benchRecognition com os seus rostos: ele mostra, no conjunto de teste, o limite que aceita
+// 95% das pessoas conhecidas e quantas pessoas desconhecidas cada limite rejeita.
+// LBPH do OpenCV: chi-quadrado assimétrico, soma de (a-b)^2/a sobre os histogramas das células, sem limite superior.
+const double UNKNOWN_PERSON_LBPH_THRESHOLD = 123.0;
+// FastLBPH: chi-quadrado simétrico, soma de (a-b)^2/(a+b), que vale no máximo 2 por célula (128 com a grade 8x8).
+const double UNKNOWN_PERSON_FASTLBPH_THRESHOLD = 60.0;
+
+// Modo de posto reduzido: mantém apenas os autovetores mais importantes, para o reconhecimento ficar mais rápido.
+// RECOGNITION_MAX_COMPONENTS limita o número de componentes (0 para não limitar), e RECOGNITION_EXPLAINED_VARIANCE mantém apenas os
+// componentes que explicam essa fração da variância (0 para manter todos; só com FastEigenfaces e FastFisherfaces).
+// Rode benchRecognition para ver a precisão e a latência de cada escolha.
+const int RECOGNITION_MAX_COMPONENTS = 0;
+const double RECOGNITION_EXPLAINED_VARIANCE = 0.0;
+
 
 // Cascade Classifier arquivos, usados para Face Detection.
 const char *faceCascadeFilename = "lbpcascade_frontalface.xml";     // LBP face detector.
@@ -39,14 +58,25 @@ const int DESIRED_CAMERA_HEIGHT = 480;
 // Caso contrário, o conjunto de treinamento poderia olhar para semelhantes uns aos outros!
 const double CHANGE_IN_IMAGE_FOR_COLLECTION = 0.3;      // Quanto à imagem facial deve mudar antes de coletar uma nova foto do seu rosto para o treinamento.
 const double CHANGE_IN_SECONDS_FOR_COLLECTION = 1.0;    // Quanto tempo deve passar antes de coletar uma nova foto do seu rosto para o treinamento.
+const bool MIRROR_FACES_FOR_TRAINING = true;   // Também treina com a imagem espelhada de cada rosto, para lidar com rostos olhando para a esquerda ou para a direita.
+const bool useGalleryDedup = true;      // Compara cada novo rosto com todos os rostos já coletados da pessoa, e não só com o anterior.
+const double DEDUP_MIN_DISTANCE = 0.1;  // Distância mínima (em GalleryDedupIndex) para um rosto novo não ser considerado repetido.
+const bool RETRAIN_AFTER_REMOVING_PERSON = true;    // Depois de remover uma pessoa do modelo, treina de novo em segundo plano, para tirar seus rostos também dos autovetores.
 const char *windowName = "WebcamFaceRec";   // Nome mostrado na janela de GUI.
 const int BORDER = 8;  // Fronteira entre elementos da interface gráfica para a borda da imagem.
 
 const bool preprocessLeftAndRightSeparately = true;   // Preprocess esquerdo e lado direito do rosto em separado, caso em que há luz mais forte em um lado.
+const bool useSkinPrefilter = false;    // Procura rostos apenas nas regiões com cor de pele. Bem mais rápido quando a maior parte da imagem é o fundo.
+const bool useTiledDetection = false;   // Também procura os rostos pequenos (distantes) na resolução original com o TiledDetector, e mostra todos eles. Útil com câmeras 4K ou panorâmicas.
+const int TILED_MIN_FACE_SIZE = 24;     // Menor rosto procurado pela detecção em tiles, em pixels da imagem da câmera.
 
 // Defina como true se você quiser ver muitas janelas sendo criada, mostrando várias informações de depuração. Defina para 0 caso contrário.
 bool m_debug = false;
 
+// Mostra gráficos ao vivo da latência de cada etapa, do FPS e da confiança do reconhecimento. Pode ser ligado e desligado com a tecla 'm'.
+bool m_showMetrics = false;
+const int METRICS_REDRAW_INTERVAL = 10;     // Redesenha os gráficos apenas a cada 10 frames, para que eles custem quase nada.
+
 
 #include <stdio.h>
 #include <vector>
@@ -58,14 +88,24 @@ bool m_debug = false;
 
 
 #include "detectObject.h"      
+#include "multiScaleCascade.h"    // Laço de escalas paralelo para o detector de rostos.
+#include "tiledDetection.h"     // Detecção dos rostos pequenos em tiles (veja useTiledDetection).
 #include "preprocessFace.h"    
 #include "recognition.h"    
+#include "metricsOverlay.h"    
+#include "asyncLog.h"    
+#include "galleryDedup.h"    
+#include "faceGallery.h"    
 
 #include "ImageUtils.h"     
 
 using namespace cv;
 using namespace std;
 
+// Filtro bilateral dos rostos pré-processados: FACE_DENOISE_FAST usa SSE2 e fica a no máximo 1 nível de cinza do bilateralFilter() do OpenCV.
+// Veja faceDenoise.h, e benchKernels para a velocidade e a diferença de cada modo.
+const int faceDenoiseMode = FACE_DENOISE_FAST;
+
 
 #if !defined VK_ESCAPE
     #define VK_ESCAPE 0x1B      
@@ -77,6 +117,7 @@ const char* MODE_NAMES[] = {"Startup", "Deteccao", "Coletando Rostos", "Treinand
 MODES m_mode = MODE_STARTUP;
 
 int m_selectedPerson = -1;
+int m_previousPerson = -1;      // A pessoa selecionada antes da atual, para juntar as duas com a tecla 'j'.
 int m_numPersons = 0;
 vector<int> m_latestFaces;
 
@@ -105,6 +146,12 @@ template <typename T> T fromString(string t)
     return out;
 }
 
+// O limite da distância do LBPH ou do FastLBPH para 'algorithm' (os outros algoritmos usam UNKNOWN_PERSON_THRESHOLD).
+double getLBPHThreshold(const string &algorithm)
+{
+    return (algorithm == "FaceRecognizer.FastLBPH") ? UNKNOWN_PERSON_FASTLBPH_THRESHOLD : UNKNOWN_PERSON_LBPH_THRESHOLD;
+}
+
 // Carrega o rosto e um ou dois olhos classificadores XML detecção.
 void initDetectors(CascadeClassifier &faceCascade, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2)
 {
@@ -247,6 +294,7 @@ void onMouse(int event, int x, int y, int, void*)
             cout << "Num Persons: " << m_numPersons << endl;
         }
         // Use a pessoa recém-adicionada. Também use a mais nova pessoa, mesmo que essa pessoa estava vazio.
+        m_previousPerson = m_selectedPerson;
         m_selectedPerson = m_numPersons - 1;
         m_mode = MODE_COLLECT_FACES;
     }
@@ -275,6 +323,7 @@ void onMouse(int event, int x, int y, int, void*)
         // Altere a pessoa atual e colete mais fotos para eles.
         if (clickedPerson >= 0) {
             // Altere a pessoa atual e colete mais fotos para eles.
+            m_previousPerson = m_selectedPerson;
             m_selectedPerson = clickedPerson; // Use a pessoa recém-adicionada.
             m_mode = MODE_COLLECT_FACES;
         }
@@ -293,11 +342,28 @@ void onMouse(int event, int x, int y, int, void*)
 // Loop principal que corre para sempre, até que as batidas do usuário Escape para sair.
 void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier &faceCascade, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2)
 {
-    Ptr<FaceRecognizer> model;
-    vector<Mat> preprocessedFaces;
-    vector<int> faceLabels;
+    RecognizerHandle recognizerHandle;
+    TrainingEngine trainingEngine(recognizerHandle);
+    bool trainingStarted = false;
+    bool retrainPending = false;    // Treinar de novo assim que possível, depois de remover ou juntar pessoas.
+    int modelVersion = 0;
+    // Os rostos coletados, em um único atlas contínuo. O treinamento recebe Mat que apontam para o atlas, sem copiar os pixels.
+    FaceGallery gallery(Size(faceWidth, faceHeight));
     Mat old_prepreprocessedFace;
     double old_time = 0;
+    GalleryDedupIndex galleryDedup(DEDUP_MIN_DISTANCE);
+    TiledDetector tiledDetector;
+    if (useTiledDetection && !tiledDetector.load(faceCascadeFilename))
+        ALOG(LOG_LEVEL_WARNING, "Could not load [%s] for the tiled detection, the small faces will not be searched.", faceCascadeFilename);
+
+    // Gráficos das métricas, com os últimos 120 frames.
+    MetricsOverlay metrics(120, METRICS_REDRAW_INTERVAL);
+    int metricFPS = metrics.addSeries("FPS", CV_RGB(0,255,0));
+    int metricDetection = metrics.addSeries("Deteccao", CV_RGB(255,255,0), 0, 0, "ms");
+    int metricRecognition = metrics.addSeries("Reconhec.", CV_RGB(0,255,255), 0, 0, "ms");
+    int metricConfidence = metrics.addSeries("Confianca", CV_RGB(255,128,0), 0.0f, 1.0f);
+    int metricTraining = metrics.addSeries("Treino", CV_RGB(255,0,255), 0, 0, "ms");
+    int64 old_frameTicks = 0;
 
     // Uma vez que já está inicializada, vamos iniciar no modo de detecção.
     m_mode = MODE_DETECTION;
@@ -318,6 +384,42 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
         Mat displayedFrame;
         cameraFrame.copyTo(displayedFrame);
 
+        // Pega o modelo atual uma vez, e usa o mesmo modelo no frame inteiro, mesmo se o treinamento em segundo plano publicar um novo.
+        // Verifica se o treinamento terminou antes de pegar o modelo, para que o modelo novo já esteja publicado.
+        bool trainingFinished = trainingStarted && !trainingEngine.isTraining();
+        std::shared_ptr<const RecognizerModel> currentModel = recognizerHandle.get();
+        Ptr<FaceRecognizer> model;
+        if (currentModel)
+            model = currentModel->recognizer;
+        if (currentModel && currentModel->version != modelVersion) {
+            modelVersion = currentModel->version;
+            double swapLatencyMs = (getTickCount() - currentModel->publishedTicks) * 1000.0 / getTickFrequency();
+            ALOG(LOG_LEVEL_INFO, "Using model %d (trained in %.1f ms, first used %.1f ms after it was published, %s recognizer).", modelVersion, currentModel->trainingMs, swapLatencyMs,
+                 (currentModel->backend && currentModel->backend->isFixedSize()) ? "fixed-size" : "generic");
+            metrics.addSample(metricTraining, (float)currentModel->trainingMs);
+            // Mostra os dados de reconhecimento de face interna, para ajudar a depuração.
+            if (m_debug)
+                showTrainingDebugData(model, faceWidth, faceHeight);
+        }
+        if (trainingFinished) {
+            trainingStarted = false;
+            // Agora que o treinamento acabou, podemos começar a reconhecer! Se o treinamento falhou, volte para o modo de recolher rostos.
+            if (m_mode == MODE_TRAINING)
+                m_mode = model.empty() ? MODE_COLLECT_FACES : MODE_RECOGNITION;
+        }
+        // Depois de remover ou juntar pessoas, treina de novo em segundo plano com a galeria atualizada, sem parar o reconhecimento.
+        if (retrainPending && !trainingEngine.isTraining()) {
+            retrainPending = false;
+            if (gallery.size() > 0) {
+                vector<Mat> preprocessedFaces;
+                vector<int> faceLabels;
+                gallery.getFaces(preprocessedFaces, faceLabels);
+                trainingStarted = trainingEngine.startTraining(preprocessedFaces, faceLabels, facerecAlgorithm,
+                                                               RECOGNITION_MAX_COMPONENTS, RECOGNITION_EXPLAINED_VARIANCE, MIRROR_FACES_FOR_TRAINING,
+                                                               getLBPHThreshold(facerecAlgorithm));
+            }
+        }
+
         // Executar o sistema de reconhecimento de rosto na imagem da câmera. Ele vai tirar algumas coisas para a imagem dada, por isso certifique-se que não é só de leitura de memória!
         int identity = -1;
 
@@ -325,12 +427,21 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
         Rect faceRect;  
         Rect searchedLeftEye, searchedRightEye; 
         Point leftEye, rightEye;    /
-        Mat preprocessedFace = getPreprocessedFace(displayedFrame, faceWidth, faceCascade, eyeCascade1, eyeCascade2, preprocessLeftAndRightSeparately, &faceRect, &leftEye, &rightEye, &searchedLeftEye, &searchedRightEye);
+        int64 detectionStart = getTickCount();
+        Mat preprocessedFace = getPreprocessedFace(displayedFrame, faceWidth, faceCascade, eyeCascade1, eyeCascade2, preprocessLeftAndRightSeparately, &faceRect, &leftEye, &rightEye, &searchedLeftEye, &searchedRightEye, useSkinPrefilter, faceDenoiseMode);
+        metrics.addSample(metricDetection, (float)((getTickCount() - detectionStart) * 1000.0 / getTickFrequency()));
 
         bool gotFaceAndEyes = false;
         if (preprocessedFace.data)
             gotFaceAndEyes = true;
 
+        // Todos os rostos da imagem, inclusive os pequenos demais para a detecção reduzida de getPreprocessedFace().
+        vector<Rect> tiledFaces;
+        if (useTiledDetection && !tiledDetector.empty())
+            tiledDetector.detect(displayedFrame, tiledFaces, TILED_MIN_FACE_SIZE);
+        for (size_t i = 0; i < tiledFaces.size(); i++)
+            rectangle(displayedFrame, tiledFaces[i], CV_RGB(255, 128, 0), 1, CV_AA);
+
         // Desenha um retângulo com anti-aliasing em torno do rosto detectado.
         if (faceRect.width > 0) {
             rectangle(displayedFrame, faceRect, CV_RGB(255, 255, 0), 2, CV_AA);
@@ -363,21 +474,23 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
                 double timeDiff_seconds = (current_time - old_time)/getTickFrequency();
 
                 // Apenas processar a face se é visivelmente diferente do quadro anterior e tem havido diferença de tempo visível.
-                if ((imageDiff > CHANGE_IN_IMAGE_FOR_COLLECTION) && (timeDiff_seconds > CHANGE_IN_SECONDS_FOR_COLLECTION)) {
-                    // Também adicionar a imagem de espelho para o conjunto de treinamento, por isso temos mais dados de treinamento, bem como para lidar com rostos olhando para a esquerda ou para a direita.
-                    Mat mirroredFace;
-                    flip(preprocessedFace, mirroredFace, 1);
-
-                    // Adicione as imagens de rostos para a lista de rostos detectados.
-                    preprocessedFaces.push_back(preprocessedFace);
-                    preprocessedFaces.push_back(mirroredFace);
-                    faceLabels.push_back(m_selectedPerson);
-                    faceLabels.push_back(m_selectedPerson);
-
+                bool isNewFace = (imageDiff > CHANGE_IN_IMAGE_FOR_COLLECTION) && (timeDiff_seconds > CHANGE_IN_SECONDS_FOR_COLLECTION);
+                // E se também é diferente de todos os rostos já coletados dessa pessoa.
+                if (isNewFace && useGalleryDedup) {
+                    double nearestDistance;
+                    if (!galleryDedup.addIfDiverse(preprocessedFace, m_selectedPerson, &nearestDistance)) {
+                        ALOG_EVERY_MS(1000, LOG_LEVEL_INFO, "Skipped a face of person %d that is too similar to one already collected (distance %.3f).", m_selectedPerson, nearestDistance);
+                        old_time = current_time;
+                        isNewFace = false;
+                    }
+                }
+                if (isNewFace) {
+                    // Adicione a imagem de rosto para a lista de rostos detectados. A imagem espelhada não é guardada: o treinamento a cria
+                    // a partir do original (veja MIRROR_FACES_FOR_TRAINING).
                     // Mantenha uma referência mais recente rosto de cada pessoa.
-                    m_latestFaces[m_selectedPerson] = preprocessedFaces.size() - 2;  // Ponto para o rosto não espelhado.
-                    // Mostra o número de rostos recolhidos. Mas uma vez também armazenar rostos espelhados, apenas mostrar quantas o usuário pensa que foi armazenado.
-                    cout << "Saved face " << (preprocessedFaces.size()/2) << " for person " << m_selectedPerson << endl;
+                    m_latestFaces[m_selectedPerson] = gallery.add(preprocessedFace, m_selectedPerson);
+                    // Mostra o número de rostos recolhidos.
+                    ALOG(LOG_LEVEL_INFO, "Saved face %d for person %d", gallery.size(), m_selectedPerson);
 
                     // Faça um flash branco no rosto, de modo que o usuário saiba a foto foi tirada.
                     Mat displayedFaceRegion = displayedFrame(faceRect);
@@ -389,32 +502,36 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
                 }
             }
         }
-        else if (m_mode == MODE_TRAINING) {
+        else if (m_mode == MODE_TRAINING && !trainingStarted) {
 
             // Verificar se não há dados suficientes para treinar. Para Eigenfaces, podemos aprender apenas uma pessoa, se quisermos, mas para Fisherfaces,
              // Precisamos de pelo menos 2 pessoas caso contrário ele irá falhar!
             bool haveEnoughData = true;
-            if (strcmp(facerecAlgorithm, "FaceRecognizer.Fisherfaces") == 0) {
+            if (strstr(facerecAlgorithm, "Fisherfaces") != NULL) {
                 if ((m_numPersons < 2) || (m_numPersons == 2 && m_latestFaces[1] < 0) ) {
                     cout << "Warning: Fisherfaces needs atleast 2 people, otherwise there is nothing to differentiate! Collect more data ..." << endl;
                     haveEnoughData = false;
                 }
             }
-            if (m_numPersons < 1 || preprocessedFaces.size() <= 0 || preprocessedFaces.size() != faceLabels.size()) {
+            if (m_numPersons < 1 || gallery.size() <= 0) {
                 cout << "Warning: Need some training data before it can be learnt! Collect more data ..." << endl;
                 haveEnoughData = false;
             }
 
             if (haveEnoughData) {
-                // Iniciar a formação dos rostos recolhidos usando Eigenfaces ou um algoritmo similar.
-                model = learnCollectedFaces(preprocessedFaces, faceLabels, facerecAlgorithm);
-
-                // Mostra os dados de reconhecimento de face interna, para ajudar a depuração.
-                if (m_debug)
-                    showTrainingDebugData(model, faceWidth, faceHeight);
-
-                // Agora que o treinamento acabou, podemos começar a reconhecer!
-                m_mode = MODE_RECOGNITION;
+                if (useGalleryDedup)
+                    ALOG(LOG_LEVEL_INFO, "Training with %d faces (%d near-duplicate faces were not collected).", gallery.size(), galleryDedup.getRejectedCount());
+                // Iniciar a formação dos rostos recolhidos usando Eigenfaces ou um algoritmo similar, em segundo plano.
+                // O loop continua rodando, e o modelo antigo (se houver) continua reconhecendo até o novo ficar pronto.
+                vector<Mat> preprocessedFaces;
+                vector<int> faceLabels;
+                gallery.getFaces(preprocessedFaces, faceLabels);
+                trainingStarted = trainingEngine.startTraining(preprocessedFaces, faceLabels, facerecAlgorithm,
+                                                               RECOGNITION_MAX_COMPONENTS, RECOGNITION_EXPLAINED_VARIANCE, MIRROR_FACES_FOR_TRAINING,
+                                                               getLBPHThreshold(facerecAlgorithm));
+                // Se já existe um modelo, não há por que esperar: continue reconhecendo com ele até o novo ser publicado.
+                if (trainingStarted && !model.empty())
+                    m_mode = MODE_RECOGNITION;
             }
             else {
                 // Como não há dados de treinamento suficientes, volte para o modo de recolher rostos!
@@ -422,30 +539,37 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
             }
 
         }
-        else if (m_mode == MODE_RECOGNITION) {
-            if (gotFaceAndEyes && (preprocessedFaces.size() > 0) && (preprocessedFaces.size() == faceLabels.size())) {
+        else if (m_mode == MODE_RECOGNITION || m_mode == MODE_TRAINING) {
+            if (gotFaceAndEyes && currentModel && currentModel->backend && (gallery.size() > 0)) {
+
+                int64 recognitionStart = getTickCount();
 
-                // Gerar uma aproximação rosto de volta projetando-os eigenvectors e eigenvalues.
-                Mat reconstructedFace;
-                reconstructedFace = reconstructFace(model, preprocessedFace);
-                if (m_debug)
+                // Reconhece o rosto com o backend do modelo, que leu as propriedades do modelo uma vez quando ele foi treinado.
+                // Ele projeta o rosto, gera uma aproximação do rosto de volta a partir dos eigenvectors, e procura o rosto mais próximo.
+                RecognitionResult result = currentModel->backend->recognize(preprocessedFace);
+                if (m_debug) {
+                    Mat reconstructedFace = reconstructFace(model, preprocessedFace);
                     if (reconstructedFace.data)
                         imshow("reconstructedFace", reconstructedFace);
+                }
 
                 // Verifique se o rosto reconstruído se parece com o rosto pré-processado, caso contrário, é provável que seja uma pessoa desconhecida.
-                double similarity = getSimilarity(preprocessedFace, reconstructedFace);
+                double similarity = result.similarity;
 
                 string outputStr;
                 if (similarity < UNKNOWN_PERSON_THRESHOLD) {
                     // Identificar quem é a pessoa da imagem de rosto pré-processados.
-                    identity = model->predict(preprocessedFace);
-                    outputStr = toString(identity);
+                    // O LBPH e o FastLBPH devolvem -1 quando a distância passa do limite de getLBPHThreshold().
+                    identity = result.label;
+                    outputStr = (identity >= 0) ? toString(identity) : "Unknown";
                 }
                 else {
                     // Uma vez que a confiança é baixa, assumir que é uma pessoa desconhecida.
                     outputStr = "Unknown";
                 }
-                cout << "Identity: " << outputStr << ". Similarity: " << similarity << endl;
+                // Escreve no máximo uma linha por segundo, sem bloquear o loop dos frames.
+                ALOG_EVERY_MS(1000, LOG_LEVEL_INFO, "Identity: %s. Similarity: %f", outputStr.c_str(), similarity);
+                metrics.addSample(metricRecognition, (float)((getTickCount() - recognitionStart) * 1000.0 / getTickFrequency()));
 
                 // Mostra o nível de confiança para o reconhecimento em meados do topo da tela.
                 int cx = (displayedFrame.cols - faceWidth) / 2;
@@ -456,6 +580,7 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
                 rectangle(displayedFrame, ptThreshold, Point(ptBottomRight.x, ptThreshold.y), CV_RGB(200,200,200), 1, CV_AA);
                 // Cortar o nível de confiança entre 0,0 a 1,0, para mostrar na barra.
                 double confidenceRatio = 1.0 - min(max(similarity, 0.0), 1.0);
+                metrics.addSample(metricConfidence, (float)confidenceRatio);
                 Point ptConfidence = Point(ptTopLeft.x, ptBottomRight.y - confidenceRatio * faceHeight);
                 // Mostra a barra de confiança azul-claro.
                 rectangle(displayedFrame, ptConfidence, ptBottomRight, CV_RGB(0,255,255), CV_FILLED, CV_AA);
@@ -466,11 +591,17 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
         else if (m_mode == MODE_DELETE_ALL) {
             // Reinicie tudo!
             m_selectedPerson = -1;
+            m_previousPerson = -1;
             m_numPersons = 0;
             m_latestFaces.clear();
-            preprocessedFaces.clear();
-            faceLabels.clear();
+            gallery.clear();
             old_prepreprocessedFace = Mat();
+            galleryDedup.clear();
+            // O modelo atual e o que estava sendo treinado conhecem as pessoas apagadas.
+            trainingEngine.discardTraining();
+            recognizerHandle.set(std::shared_ptr<const RecognizerModel>());
+            trainingStarted = false;
+            retrainPending = false;
 
             // Reinicie em modo de detecção.
             m_mode = MODE_DETECTION;
@@ -488,9 +619,9 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
         if (m_mode == MODE_DETECTION)
             help = "Click em [Adicionar Pessoa] quando estiver pronto para coletar os rostos.";
         else if (m_mode == MODE_COLLECT_FACES)
-            help = "Click anywhere to train from your " + toString(preprocessedFaces.size()/2) + " faces of " + toString(m_numPersons) + " people.";
+            help = "Click anywhere to train from your " + toString(gallery.size()) + " faces of " + toString(m_numPersons) + " people.";
         else if (m_mode == MODE_TRAINING)
-            help = "Please wait while your " + toString(preprocessedFaces.size()/2) + " faces of " + toString(m_numPersons) + " people builds.";
+            help = "Please wait while your " + toString(gallery.size()) + " faces of " + toString(m_numPersons) + " people builds.";
         else if (m_mode == MODE_RECOGNITION)
             help = "Click people on the right to add more faces to them, or [Add Person] for someone new.";
         if (help.length() > 0) {
@@ -533,9 +664,9 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
         m_gui_faces_left = displayedFrame.cols - BORDER - faceWidth;
         m_gui_faces_top = BORDER;
         for (int i=0; i<m_numPersons; i++) {
-            int index = m_latestFaces[i];
-            if (index >= 0 && index < (int)preprocessedFaces.size()) {
-                Mat srcGray = preprocessedFaces[index];
+            int index = gallery.getLatestFace(i);
+            if (index >= 0) {
+                Mat srcGray = gallery.getFace(index);
                 if (srcGray.data) {
                     // Obter uma versão BGR do rosto, uma vez que a saída é BGR cor.
                     Mat srcBGR = Mat(srcGray.size(), CV_8UC3);
@@ -566,6 +697,16 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
             rectangle(displayedFrame, rc, CV_RGB(0,255,0), 3, CV_AA);
         }
 
+        // Mede o FPS usando o tempo entre os frames.
+        int64 frameTicks = getTickCount();
+        if (old_frameTicks > 0)
+            metrics.addSample(metricFPS, (float)(getTickFrequency() / (double)max(frameTicks - old_frameTicks, (int64)1)));
+        old_frameTicks = frameTicks;
+
+        // Mostra os gráficos das métricas abaixo dos botões.
+        if (m_showMetrics)
+            metrics.draw(displayedFrame, Point(BORDER, m_rcBtnDebug.y + m_rcBtnDebug.height + BORDER));
+
         // Mostra o quadro da câmera na tela.
         imshow(windowName, displayedFrame);
 
@@ -595,6 +736,44 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
             // Quit the program!
             break;
         }
+        else if (keypress == 'm' || keypress == 'M') {
+            m_showMetrics = !m_showMetrics;
+            cout << "Metrics overlay: " << m_showMetrics << endl;
+        }
+        else if ((keypress == 'd' || keypress == 'D') && m_selectedPerson >= 0 && m_selectedPerson < m_numPersons) {
+            // Remove apenas a pessoa selecionada, sem apagar as outras e sem parar o reconhecimento: o modelo publicado é atualizado
+            // na hora, e a pessoa removida nunca mais é reconhecida.
+            int person = m_selectedPerson;
+            gallery.removePerson(person);
+            galleryDedup.removePerson(person);
+            m_latestFaces[person] = -1;
+            old_prepreprocessedFace = Mat();
+            bool wasTraining = trainingEngine.isTraining();
+            bool downdated = trainingEngine.removePerson(person);
+            // O treinamento que estava rodando foi descartado, e os algoritmos do OpenCV precisam treinar de novo.
+            if (gallery.size() > 0 && (wasTraining || !downdated || RETRAIN_AFTER_REMOVING_PERSON))
+                retrainPending = true;
+            ALOG(LOG_LEVEL_INFO, "Deleted person %d (%d faces left).", person, gallery.size());
+            if (gallery.size() == 0 || m_mode == MODE_COLLECT_FACES)
+                m_mode = (gallery.size() > 0 && recognizerHandle.get()) ? MODE_RECOGNITION : MODE_DETECTION;
+        }
+        else if ((keypress == 'j' || keypress == 'J') && m_selectedPerson >= 0 && m_selectedPerson < m_numPersons &&
+                 m_previousPerson >= 0 && m_previousPerson < m_numPersons && m_previousPerson != m_selectedPerson) {
+            // Junta a pessoa selecionada à pessoa selecionada antes dela (por exemplo, a mesma pessoa cadastrada duas vezes).
+            int person = m_selectedPerson;
+            int target = m_previousPerson;
+            gallery.relabelPerson(person, target);
+            galleryDedup.relabelPerson(person, target);
+            m_latestFaces[target] = gallery.getLatestFace(target);
+            m_latestFaces[person] = -1;
+            bool wasTraining = trainingEngine.isTraining();
+            bool downdated = trainingEngine.relabelPerson(person, target);
+            if (wasTraining || !downdated)
+                retrainPending = true;
+            ALOG(LOG_LEVEL_INFO, "Merged person %d into person %d.", person, target);
+            m_selectedPerson = target;
+            m_previousPerson = -1;
+        }
 
     }//fim while
 }
@@ -602,7 +781,7 @@ void recognizeAndTrainUsingWebcam(VideoCapture &videoCapture, CascadeClassifier
 
 int main(int argc, char *argv[])
 {
-    CascadeClassifier faceCascade;
+    MultiScaleCascade faceCascade;      // As escalas do detector de rostos são procuradas em paralelo.
     CascadeClassifier eyeCascade1;
     CascadeClassifier eyeCascade2;
     VideoCapture videoCapture;
@@ -615,6 +794,7 @@ int main(int argc, char *argv[])
 
     cout << endl;
     cout << "Hit 'Escape' in the GUI window to quit." << endl;
+    cout << "Hit 'd' to delete the selected person, or 'j' to merge the selected person into the person selected before." << endl;
 
     // Permitir que o usuário especifique um número da câmera, uma vez que nem todos os computadores será o mesmo número da câmera.
     int cameraNumber = 0;   // Altere este se você quiser usar um dispositivo de câmera diferente.
@@ -638,5 +818,7 @@ int main(int argc, char *argv[])
     // Rode Face Recogintion interativamente da webcam. Esta função é executado até que o usuário saía.
     recognizeAndTrainUsingWebcam(videoCapture, faceCascade, eyeCascade1, eyeCascade2);
 
+    // Escreve as mensagens do log que ainda estão esperando.
+    flushLog();
     return 0;
 }
@@ -0,0 +1,128 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const int METRICS_BORDER = 4;           // Espaço entre os gráficos do painel.
+const int METRICS_LABEL_WIDTH = 110;    // Largura do texto à esquerda de cada gráfico.
+const float METRICS_FONT_SCALE = 0.35f;
+
+
+#include "metricsOverlay.h"     // Gráficos ao vivo de métricas sobre o frame mostrado.
+
+
+MetricsOverlay::MetricsOverlay(int historyLength, int redrawInterval, Size graphSize)
+    : m_historyLength(max(historyLength, 2)), m_redrawInterval(max(redrawInterval, 1)), m_graphSize(graphSize), m_framesSinceRedraw(0)
+{
+}
+
+int MetricsOverlay::addSeries(const string &name, Scalar color, float minV, float maxV, const string &units)
+{
+    Series s;
+    s.name = name;
+    s.units = units;
+    s.color = color;
+    s.minV = minV;
+    s.maxV = maxV;
+    s.history.resize(m_historyLength);
+    s.next = 0;
+    s.count = 0;
+    m_series.push_back(s);
+
+    // O painel precisa de espaço para o novo gráfico.
+    m_panel.release();
+    return (int)m_series.size() - 1;
+}
+
+void MetricsOverlay::addSample(int series, float value)
+{
+    if (series < 0 || series >= (int)m_series.size())
+        return;
+    Series &s = m_series[series];
+    s.history[s.next] = value;
+    s.next = (s.next + 1) % m_historyLength;
+    s.count = min(s.count + 1, m_historyLength);
+}
+
+float MetricsOverlay::getLatest(int series) const
+{
+    if (series < 0 || series >= (int)m_series.size() || m_series[series].count == 0)
+        return 0.0f;
+    const Series &s = m_series[series];
+    return s.history[(s.next + m_historyLength - 1) % m_historyLength];
+}
+
+Size MetricsOverlay::getPanelSize() const
+{
+    int n = (int)m_series.size();
+    return Size(METRICS_LABEL_WIDTH + m_graphSize.width + 2*METRICS_BORDER, n * (m_graphSize.height + METRICS_BORDER) + METRICS_BORDER);
+}
+
+// Redesenha todos os gráficos no painel guardado.
+void MetricsOverlay::renderPanel()
+{
+    Size panelSize = getPanelSize();
+    m_panel.create(panelSize, CV_8UC3);
+    m_panel.setTo(Scalar::all(30));
+
+    for (int i = 0; i < (int)m_series.size(); i++) {
+        const Series &s = m_series[i];
+        Rect graph = Rect(METRICS_BORDER + METRICS_LABEL_WIDTH, METRICS_BORDER + i * (m_graphSize.height + METRICS_BORDER), m_graphSize.width, m_graphSize.height);
+        rectangle(m_panel, graph, CV_RGB(80,80,80), 1);
+
+        // O valor mais antigo está em 'next' quando o buffer está cheio, e em 0 quando não está.
+        int first = (s.count == m_historyLength) ? s.next : 0;
+        float minV = s.minV;
+        float maxV = s.maxV;
+        if (minV == maxV && s.count > 0) {
+            minV = maxV = s.history[first];
+            for (int j = 0; j < s.count; j++) {
+                float v = s.history[(first + j) % m_historyLength];
+                minV = min(minV, v);
+                maxV = max(maxV, v);
+            }
+            // Mostra o zero, para que pequenas variações não pareçam enormes.
+            minV = min(minV, 0.0f);
+        }
+        float range = max(maxV - minV, 1e-6f);
+
+        // Os valores mais novos ficam à direita do gráfico.
+        m_points.resize(s.count);
+        float dx = (m_graphSize.width - 1) / (float)(m_historyLength - 1);
+        int x0 = graph.x + cvRound((m_historyLength - s.count) * dx);
+        for (int j = 0; j < s.count; j++) {
+            float v = min(max(s.history[(first + j) % m_historyLength], minV), maxV);
+            int y = graph.y + graph.height - 1 - cvRound((v - minV) / range * (graph.height - 1));
+            m_points[j] = Point(x0 + cvRound(j * dx), y);
+        }
+        if (s.count > 1) {
+            const Point *pts = &m_points[0];
+            int npts = s.count;
+            polylines(m_panel, &pts, &npts, 1, false, s.color, 1);
+        }
+
+        // Nome, último valor e escala da série.
+        char text[64];
+        snprintf(text, sizeof(text), "%s: %.1f%s", s.name.c_str(), getLatest(i), s.units.c_str());
+        putText(m_panel, text, Point(METRICS_BORDER, graph.y + 12), FONT_HERSHEY_SIMPLEX, METRICS_FONT_SCALE, s.color, 1, CV_AA);
+        snprintf(text, sizeof(text), "[%.1f, %.1f]", minV, maxV);
+        putText(m_panel, text, Point(METRICS_BORDER, graph.y + graph.height - 4), FONT_HERSHEY_SIMPLEX, METRICS_FONT_SCALE, CV_RGB(160,160,160), 1, CV_AA);
+    }
+    m_framesSinceRedraw = 0;
+}
+
+void MetricsOverlay::draw(Mat &frame, Point topLeft)
+{
+    if (m_series.empty() || frame.empty() || frame.type() != CV_8UC3)
+        return;
+
+    if (m_panel.empty() || ++m_framesSinceRedraw >= m_redrawInterval)
+        renderPanel();
+
+    // Ajusta a posição para que o painel caiba no frame.
+    Rect rc = Rect(topLeft, m_panel.size());
+    rc.x = min(max(rc.x, 0), max(frame.cols - rc.width, 0));
+    rc.y = min(max(rc.y, 0), max(frame.rows - rc.height, 0));
+    rc &= Rect(0, 0, frame.cols, frame.rows);
+    if (rc.area() > 0)
+        m_panel(Rect(0, 0, rc.width, rc.height)).copyTo(frame(rc));
+}
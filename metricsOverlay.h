@@ -0,0 +1,57 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include "opencv2/opencv.hpp"
+
+
+using namespace cv;
+using namespace std;
+
+// Desenha gráficos ao vivo de métricas (latência de cada etapa, FPS, confiança do reconhecimento) sobre o frame mostrado.
+// Ao contrário de drawFloatGraph() e showFloatGraph(), os valores ficam em buffers circulares (adicionar um valor é O(1) e não aloca memória),
+// o painel é guardado entre os frames e só é redesenhado a cada 'redrawInterval' frames, e nos outros frames é apenas copiado para o frame.
+class MetricsOverlay
+{
+public:
+    MetricsOverlay(int historyLength = 120, int redrawInterval = 10, Size graphSize = Size(160, 40));
+
+    // Adiciona uma série e retorna seu índice. Se minV == maxV, a escala do gráfico segue os valores do histórico.
+    int addSeries(const string &name, Scalar color, float minV = 0.0f, float maxV = 0.0f, const string &units = "");
+
+    // Guarda um novo valor da série, substituindo o mais antigo quando o histórico está cheio.
+    void addSample(int series, float value);
+
+    // Último valor da série, ou 0 se ela ainda não tem valores.
+    float getLatest(int series) const;
+
+    // Copia o painel para 'frame' na posição 'topLeft' (ajustada para caber no frame), redesenhando o painel se for a hora.
+    void draw(Mat &frame, Point topLeft);
+
+    Size getPanelSize() const;
+
+private:
+    struct Series
+    {
+        string name;
+        string units;
+        Scalar color;
+        float minV, maxV;
+        vector<float> history;  // Buffer circular com os últimos valores.
+        int next;               // Onde o próximo valor será escrito.
+        int count;              // Quantos valores o buffer tem.
+    };
+
+    void renderPanel();
+
+    int m_historyLength;
+    int m_redrawInterval;
+    Size m_graphSize;
+    vector<Series> m_series;
+    Mat m_panel;
+    int m_framesSinceRedraw;
+    vector<Point> m_points;     // Pontos temporários do gráfico, reutilizados entre as renderizações.
+};
@@ -0,0 +1,149 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const int MOSAIC_BACKGROUND = 50;   // Cor cinza do fundo do mosaico, igual ao combineImages().
+
+
+#include "mosaic.h"     // Monta um mosaico com várias imagens, redesenhando apenas as que mudaram.
+
+#include "ImageUtils.h"      // Funções úteis
+
+
+// Redesenha uma lista de tiles, para que cv::parallel_for_ possa dividir os tiles entre as threads.
+class MosaicBuilder::RenderTilesBody : public ParallelLoopBody
+{
+public:
+    RenderTilesBody(MosaicBuilder &mosaic) : m_mosaic(mosaic) {}
+
+    virtual void operator()(const Range &range) const
+    {
+        for (int i = range.start; i < range.end; i++) {
+            int index = m_mosaic.m_dirtyTiles[i];
+            Tile &tile = m_mosaic.m_tiles[index];
+            // Recalcula as tabelas de interpolação apenas se o tamanho da imagem de origem mudou.
+            if (tile.mapSourceSize != tile.frame.size())
+                m_mosaic.updateTileMaps(tile, index);
+            m_mosaic.renderTile(tile);
+        }
+    }
+
+private:
+    MosaicBuilder &m_mosaic;
+};
+
+
+MosaicBuilder::MosaicBuilder(Size tileSize, int border)
+    : m_tileSize(tileSize), m_border(border), m_columns(1), m_renderedTiles(0)
+{
+}
+
+// Define quantos tiles o mosaico tem, e recria o canvas. Todos os tiles serão redesenhados na próxima composição.
+void MosaicBuilder::setTileCount(int nTiles, int nColumns)
+{
+    nTiles = max(nTiles, 0);
+    if (nColumns <= 0) {
+        // Um layout quase quadrado.
+        nColumns = max(cvCeil(sqrt((double)nTiles)), 1);
+    }
+    int nRows = max((nTiles + nColumns - 1) / nColumns, 1);
+    m_columns = nColumns;
+
+    // O layout mudou, então todos os tiles precisam de novas tabelas de interpolação.
+    m_tiles.resize(nTiles);
+    for (int i = 0; i < nTiles; i++) {
+        m_tiles[i].renderedFrameNumber = -1;
+        m_tiles[i].mapSourceSize = Size();
+    }
+
+    int w = m_border + nColumns * (m_tileSize.width + m_border);
+    int h = m_border + nRows * (m_tileSize.height + m_border);
+    m_canvas.create(h, w, CV_8UC3);
+    m_canvas.setTo(Scalar::all(MOSAIC_BACKGROUND));
+}
+
+// Posição do tile (sua célula inteira) no canvas.
+Rect MosaicBuilder::getTileRect(int index) const
+{
+    int col = index % m_columns;
+    int row = index / m_columns;
+    return Rect(m_border + col * (m_tileSize.width + m_border), m_border + row * (m_tileSize.height + m_border), m_tileSize.width, m_tileSize.height);
+}
+
+void MosaicBuilder::setTile(int index, const Mat &frame, int64 frameNumber)
+{
+    if (index < 0 || index >= (int)m_tiles.size()) {
+        cout << "WARNING: Invalid tile " << index << " in 'MosaicBuilder::setTile()'." << endl;
+        return;
+    }
+    Tile &tile = m_tiles[index];
+    tile.frame = frame;
+    tile.frameNumber = frameNumber;
+    tile.hasFrame = !frame.empty();
+}
+
+// Calcula as tabelas de interpolação bilinear para desenhar a imagem de origem dentro da célula do tile, mantendo a proporção.
+// Usa as mesmas coordenadas que resize() com INTER_LINEAR, convertidas para ponto fixo para que o remap() seja rápido.
+void MosaicBuilder::updateTileMaps(Tile &tile, int index)
+{
+    Rect cell = getTileRect(index);
+    Size srcSize = tile.frame.size();
+    double scale = min(cell.width / (double)srcSize.width, cell.height / (double)srcSize.height);
+    int w = max(cvRound(srcSize.width * scale), 1);
+    int h = max(cvRound(srcSize.height * scale), 1);
+    tile.dstRect = Rect(cell.x + (cell.width - w) / 2, cell.y + (cell.height - h) / 2, w, h);
+
+    float sx = srcSize.width / (float)w;
+    float sy = srcSize.height / (float)h;
+    Mat mapX = Mat(h, w, CV_32F);
+    Mat mapY = Mat(h, w, CV_32F);
+    for (int y = 0; y < h; y++) {
+        float fy = min(max((y + 0.5f) * sy - 0.5f, 0.0f), (float)(srcSize.height - 1));
+        float *pX = mapX.ptr<float>(y);
+        float *pY = mapY.ptr<float>(y);
+        for (int x = 0; x < w; x++) {
+            pX[x] = min(max((x + 0.5f) * sx - 0.5f, 0.0f), (float)(srcSize.width - 1));
+            pY[x] = fy;
+        }
+    }
+    convertMaps(mapX, mapY, tile.map1, tile.map2, CV_16SC2);
+    tile.mapSourceSize = srcSize;
+
+    // Limpa a célula, já que a área em volta da imagem pode ter sobras de uma imagem com outra proporção.
+    m_canvas(cell).setTo(Scalar::all(MOSAIC_BACKGROUND));
+}
+
+// Redimensiona o frame do tile diretamente para sua posição no canvas.
+void MosaicBuilder::renderTile(Tile &tile)
+{
+    Mat dst = m_canvas(tile.dstRect);
+    if (tile.frame.type() == CV_8UC3) {
+        remap(tile.frame, dst, tile.map1, tile.map2, INTER_LINEAR, BORDER_REPLICATE);
+    }
+    else {
+        // Redimensiona primeiro e converte para cor depois, já que a imagem reduzida tem menos pixels para converter.
+        remap(tile.frame, tile.resizedGray, tile.map1, tile.map2, INTER_LINEAR, BORDER_REPLICATE);
+        if (tile.resizedGray.channels() == 1)
+            cvtColor(tile.resizedGray, dst, CV_GRAY2BGR);
+        else if (tile.resizedGray.channels() == 4)
+            cvtColor(tile.resizedGray, dst, CV_BGRA2BGR);
+    }
+    tile.renderedFrameNumber = tile.frameNumber;
+}
+
+// Desenha em paralelo os tiles que têm um novo frame (ou que mudaram de posição), e retorna o canvas.
+const Mat &MosaicBuilder::composite()
+{
+    m_dirtyTiles.clear();
+    for (int i = 0; i < (int)m_tiles.size(); i++) {
+        const Tile &tile = m_tiles[i];
+        if (tile.hasFrame && (tile.frameNumber != tile.renderedFrameNumber || tile.mapSourceSize != tile.frame.size()))
+            m_dirtyTiles.push_back(i);
+    }
+
+    m_renderedTiles = (int)m_dirtyTiles.size();
+    if (m_renderedTiles > 0)
+        parallel_for_(Range(0, m_renderedTiles), RenderTilesBody(*this));
+
+    return m_canvas;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+
+using namespace cv;
+using namespace std;
+
+// Monta um mosaico com qualquer número de imagens (por exemplo, as câmeras de um painel de monitoramento) em um único canvas persistente.
+// Ao contrário de combineImages() e combineImagesResized(), o canvas é reutilizado entre chamadas, cada tile usa tabelas de interpolação
+// pré-calculadas (só recalculadas quando o tamanho da imagem de origem muda), os tiles são redimensionados em paralelo,
+// e apenas os tiles cujo frame mudou desde a última composição são redesenhados.
+class MosaicBuilder
+{
+public:
+    MosaicBuilder(Size tileSize = Size(320, 240), int border = 4);
+
+    // Define quantos tiles o mosaico tem, e quantas colunas (0 para escolher automaticamente um layout quase quadrado).
+    void setTileCount(int nTiles, int nColumns = 0);
+    int getTileCount() const { return (int)m_tiles.size(); }
+
+    // Atualiza o frame de um tile. 'frameNumber' deve mudar sempre que o conteúdo do frame muda, já que o tile só é
+    // redesenhado se for diferente do último frame desenhado. O frame não é copiado, então ele não deve ser modificado até composite().
+    void setTile(int index, const Mat &frame, int64 frameNumber);
+
+    // Desenha os tiles que mudaram no canvas e o retorna.
+    const Mat &composite();
+
+    // Quantos tiles foram redesenhados na última chamada de composite().
+    int getRenderedTileCount() const { return m_renderedTiles; }
+
+    // Posição do tile no canvas, por exemplo para desenhar anotações por cima dele.
+    Rect getTileRect(int index) const;
+
+private:
+    struct Tile
+    {
+        Tile() : frameNumber(-1), renderedFrameNumber(-1), hasFrame(false) {}
+
+        Mat frame;
+        int64 frameNumber;
+        int64 renderedFrameNumber;
+        bool hasFrame;
+        Size mapSourceSize;     // Tamanho da imagem de origem usado para calcular as tabelas de interpolação.
+        Rect dstRect;           // Onde a imagem é desenhada no canvas (mantendo a proporção da imagem).
+        Mat map1, map2;         // Tabelas de interpolação em ponto fixo, para remap().
+        Mat resizedGray;        // Imagem temporária para as imagens em tons de cinza.
+    };
+
+    class RenderTilesBody;
+
+    void updateTileMaps(Tile &tile, int index);
+    void renderTile(Tile &tile);
+
+    Size m_tileSize;
+    int m_border;
+    int m_columns;
+    Mat m_canvas;
+    vector<Tile> m_tiles;
+    vector<int> m_dirtyTiles;
+    int m_renderedTiles;
+};
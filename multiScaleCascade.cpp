@@ -0,0 +1,217 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const double MULTISCALE_GROUP_EPS = 0.2;        // O mesmo GROUP_EPS do detectMultiScale() do OpenCV.
+const int MULTISCALE_POINTS_PER_STRIP = 1000;   // Como o detectMultiScale() do OpenCV divide cada escala em faixas (PTS_PER_THREAD).
+const int MULTISCALE_MAX_STRIPS = 100;
+const char *MULTISCALE_FEATURES_NODE = "features";     // O nó com as features no XML dos detectores no formato novo (CC_FEATURES).
+
+
+#include "multiScaleCascade.h"      // Laço de escalas paralelo em volta do CascadeClassifier.
+
+
+// Uma cópia do detector para uma thread: os mesmos estágios, com o seu próprio avaliador de features. Procura as escalas com o
+// detectSingleScale() protegido do CascadeClassifier, e fora isso é um CascadeClassifier comum.
+class MultiScaleCascade::Worker : public CascadeClassifier
+{
+public:
+    Worker(const Data &cascadeData, const Ptr<FeatureEvaluator> &evaluator)
+    {
+        data = cascadeData;
+        featureEvaluator = evaluator;
+    }
+
+    bool detectLevel(const Mat &levelImg, double factor, vector<Rect> &candidates);
+};
+
+// Monta e procura uma lista de níveis da pirâmide, para que cv::parallel_for_ possa dividir os níveis entre as threads.
+class MultiScaleCascade::DetectLevelsBody : public ParallelLoopBody
+{
+public:
+    DetectLevelsBody(MultiScaleCascade &cascade, const Mat &gray, const vector<int> &levels, vector<vector<Rect> > &candidates, vector<uchar> &levelOk)
+        : m_cascade(cascade), m_gray(gray), m_levels(levels), m_candidates(candidates), m_levelOk(levelOk) {}
+
+    virtual void operator()(const Range &range) const
+    {
+        Worker *worker = static_cast<Worker*>(m_cascade.acquireWorker());
+        for (int i = range.start; i < range.end; i++) {
+            int level = m_levels[i];
+            Mat &levelImg = m_cascade.m_pyramid[level];
+            resize(m_gray, levelImg, m_cascade.m_levelSizes[level], 0, 0, INTER_LINEAR);
+            m_levelOk[level] = worker->detectLevel(levelImg, m_cascade.m_factors[level], m_candidates[level]);
+        }
+        m_cascade.releaseWorker(worker);
+    }
+
+private:
+    MultiScaleCascade &m_cascade;
+    const Mat &m_gray;
+    const vector<int> &m_levels;
+    vector<vector<Rect> > &m_candidates;
+    vector<uchar> &m_levelOk;
+};
+
+
+// Junta os candidatos das escalas na ordem das escalas. O detectMultiScale() do OpenCV para na primeira escala em que
+// detectSingleScale() falha, então os candidatos das escalas a partir dela não contam.
+static void collectCandidates(const vector<vector<Rect> > &candidates, const vector<uchar> &levelOk, vector<Rect> &allCandidates)
+{
+    allCandidates.clear();
+    for (size_t i = 0; i < candidates.size() && levelOk[i]; i++)
+        allCandidates.insert(allCandidates.end(), candidates[i].begin(), candidates[i].end());
+}
+
+
+MultiScaleCascade::MultiScaleCascade()
+{
+}
+
+bool MultiScaleCascade::load(const string &filename)
+{
+    clearWorkers();
+    return CascadeClassifier::load(filename);
+}
+
+// O CascadeClassifier::load() também passa por aqui. O nó das features só vale enquanto o FileStorage de quem chamou estiver aberto,
+// então ele é copiado para um FileStorage na memória, que as cópias das threads leem depois.
+bool MultiScaleCascade::read(const FileNode &node)
+{
+    clearWorkers();
+    m_features.release();
+    if (!CascadeClassifier::read(node))
+        return false;
+    FileStorage features(".xml", FileStorage::WRITE + FileStorage::MEMORY);
+    cvWriteFileNode(*features, MULTISCALE_FEATURES_NODE, *node[MULTISCALE_FEATURES_NODE], 0);
+    m_features.open(features.releaseAndGetString(), FileStorage::READ + FileStorage::MEMORY);
+    return true;
+}
+
+void MultiScaleCascade::clearWorkers()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_workers.clear();
+    m_freeWorkers.clear();
+}
+
+// Procura uma escala, dividida em faixas do mesmo jeito que o detectMultiScale() do OpenCV, então os candidatos são os mesmos.
+// Os retângulos já voltam nas coordenadas da imagem original. Retorna false se a escala não pôde ser procurada.
+bool MultiScaleCascade::Worker::detectLevel(const Mat &levelImg, double factor, vector<Rect> &candidates)
+{
+    Size window = getOriginalWindowSize();
+    Size processingRectSize(levelImg.cols - window.width, levelImg.rows - window.height);
+    // O mesmo passo do OpenCV: os detectores HOG sempre pulam 4 linhas e colunas, os outros 1 nas escalas grandes e 2 nas pequenas.
+    int yStep = (getFeatureType() == FeatureEvaluator::HOG) ? 4 : ((factor > 2.0) ? 1 : 2);
+    int stripCount = ((processingRectSize.width / yStep) * (processingRectSize.height + yStep - 1) / yStep + MULTISCALE_POINTS_PER_STRIP / 2) / MULTISCALE_POINTS_PER_STRIP;
+    stripCount = min(max(stripCount, 1), MULTISCALE_MAX_STRIPS);
+    int stripSize = (((processingRectSize.height + stripCount - 1) / stripCount + yStep - 1) / yStep) * yStep;
+    vector<int> rejectLevels;
+    vector<double> levelWeights;
+    return detectSingleScale(levelImg, stripCount, processingRectSize, stripSize, yStep, factor, candidates, rejectLevels, levelWeights, false);
+}
+
+// O detector em si é só lido durante a busca, mas o avaliador de features guarda a imagem integral da escala atual, então cada thread
+// precisa do seu. O clone() do avaliador não serve: ele compartilha a lista de features, cujos ponteiros para a imagem integral são
+// reescritos por setImage(). Então cada cópia cria o seu avaliador e lê as features do nó copiado por read(), sem abrir o XML de novo.
+CascadeClassifier *MultiScaleCascade::acquireWorker()
+{
+    if (empty() || isOldFormatCascade() || !m_features.isOpened())
+        CV_Error(CV_StsBadArg, "Only a loaded detector in the new format can be copied for other threads.");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_freeWorkers.empty()) {
+        CascadeClassifier *worker = m_freeWorkers.back();
+        m_freeWorkers.pop_back();
+        return worker;
+    }
+    Ptr<FeatureEvaluator> evaluator = FeatureEvaluator::create(getFeatureType());
+    if (!evaluator->read(m_features[MULTISCALE_FEATURES_NODE]))
+        CV_Error(CV_StsParseError, "Could not read the detector's features for another thread.");
+    Ptr<CascadeClassifier> worker = new Worker(data, evaluator);
+    m_workers.push_back(worker);
+    return worker;
+}
+
+void MultiScaleCascade::releaseWorker(CascadeClassifier *worker)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeWorkers.push_back(worker);
+}
+
+void MultiScaleCascade::detectMultiScale(const Mat &image, vector<Rect> &objects, double scaleFactor, int minNeighbors, int flags, Size minSize, Size maxSize)
+{
+    if (empty() || isOldFormatCascade()) {
+        CascadeClassifier::detectMultiScale(image, objects, scaleFactor, minNeighbors, flags, minSize, maxSize);
+        return;
+    }
+    CV_Assert(scaleFactor > 1 && image.depth() == CV_8U);
+
+    objects.clear();
+    if (maxSize.height == 0 || maxSize.width == 0)
+        maxSize = image.size();
+    Mat gray = image;
+    if (gray.channels() > 1) {
+        Mat temp;
+        cvtColor(gray, temp, CV_BGR2GRAY);
+        gray = temp;
+    }
+
+    // As mesmas escalas que o detectMultiScale() do OpenCV procura.
+    Size window = getOriginalWindowSize();
+    m_factors.clear();
+    m_levelSizes.clear();
+    for (double factor = 1; ; factor *= scaleFactor) {
+        Size windowSize(cvRound(window.width * factor), cvRound(window.height * factor));
+        Size scaledImageSize(cvRound(gray.cols / factor), cvRound(gray.rows / factor));
+        if (scaledImageSize.width - window.width <= 0 || scaledImageSize.height - window.height <= 0)
+            break;
+        if (windowSize.width > maxSize.width || windowSize.height > maxSize.height)
+            break;
+        if (windowSize.width < minSize.width || windowSize.height < minSize.height)
+            continue;
+        m_factors.push_back(factor);
+        m_levelSizes.push_back(scaledImageSize);
+    }
+    int nLevels = (int)m_factors.size();
+    if (nLevels == 0)
+        return;
+    if ((int)m_pyramid.size() < nLevels)
+        m_pyramid.resize(nLevels);
+
+    vector<vector<Rect> > candidates(nLevels);
+    vector<uchar> levelOk(nLevels, 1);      // As escalas que ainda não foram procuradas também contam como procuradas com sucesso.
+    vector<Rect> allCandidates;
+    if (!(flags & CASCADE_FIND_BIGGEST_OBJECT)) {
+        // Todas as escalas de uma vez, e os candidatos agrupados na ordem das escalas, como no OpenCV.
+        vector<int> levels(nLevels);
+        for (int i = 0; i < nLevels; i++)
+            levels[i] = i;
+        parallel_for_(Range(0, nLevels), DetectLevelsBody(*this, gray, levels, candidates, levelOk));
+        collectCandidates(candidates, levelOk, allCandidates);
+        objects = allCandidates;
+        groupRectangles(objects, minNeighbors, MULTISCALE_GROUP_EPS);
+        return;
+    }
+
+    // Da maior escala (os maiores objetos) para a menor, um grupo de escalas de cada vez, até encontrar um objeto com vizinhos suficientes.
+    int batchSize = max(getNumThreads(), 1);
+    for (int end = nLevels; end > 0 && objects.empty(); end -= batchSize) {
+        vector<int> levels;
+        for (int i = end - 1; i >= max(end - batchSize, 0); i--)
+            levels.push_back(i);
+        parallel_for_(Range(0, (int)levels.size()), DetectLevelsBody(*this, gray, levels, candidates, levelOk));
+        collectCandidates(candidates, levelOk, allCandidates);
+        objects = allCandidates;
+        groupRectangles(objects, minNeighbors, MULTISCALE_GROUP_EPS);
+    }
+
+    if (objects.size() > 1) {
+        int largest = 0;
+        for (int i = 1; i < (int)objects.size(); i++) {
+            if (objects[i].area() > objects[largest].area())
+                largest = i;
+        }
+        Rect largestObject = objects[largest];
+        objects.clear();
+        objects.push_back(largestObject);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include <mutex>
+#include "opencv2/opencv.hpp"
+
+
+using namespace cv;
+using namespace std;
+
+// Um CascadeClassifier com o nosso próprio laço de escalas em volta do detector, para ser usado no lugar dele (por exemplo o detector
+// de rostos do main.cpp). O detectMultiScale() do OpenCV reduz a imagem para cada escala e procura nela, uma escala depois da outra
+// (só as linhas de cada escala são divididas entre as threads), e com os detectores no formato novo (como lbpcascade_frontalface.xml)
+// CASCADE_FIND_BIGGEST_OBJECT não economiza nada, já que todas as escalas são procuradas do mesmo jeito. Aqui:
+// - A pirâmide de imagens reduzidas é montada uma vez por imagem, em buffers reutilizados entre as chamadas.
+// - As escalas são procuradas em paralelo (cv::parallel_for_), cada thread com a sua própria cópia do avaliador de features.
+// - Com CASCADE_FIND_BIGGEST_OBJECT, as escalas são procuradas da maior para a menor, em grupos de tantas escalas quantas threads,
+//   e a busca para no primeiro grupo em que um objeto passa de 'minNeighbors' vizinhos. Só o maior objeto é retornado.
+// Sem CASCADE_FIND_BIGGEST_OBJECT, os candidatos de cada escala são exatamente os mesmos do OpenCV (com o mesmo passo entre as janelas
+// para os detectores LBP, Haar e HOG), e são agrupados do mesmo jeito. Como no OpenCV, as escalas a partir da primeira que não pôde ser
+// procurada são ignoradas.
+// Os detectores no formato antigo (como haarcascade_eye.xml) usam o detectMultiScale() do OpenCV.
+class MultiScaleCascade : public CascadeClassifier
+{
+public:
+    MultiScaleCascade();
+
+    // Carregar outro detector descarta as cópias das threads, que são do detector anterior.
+    bool load(const string &filename);
+    virtual bool read(const FileNode &node);
+
+    using CascadeClassifier::detectMultiScale;
+    virtual void detectMultiScale(const Mat &image, vector<Rect> &objects, double scaleFactor = 1.1, int minNeighbors = 3, int flags = 0,
+                                  Size minSize = Size(), Size maxSize = Size());
+
+    // Uma cópia do detector que nenhuma outra thread está usando, para procurar em várias threads ao mesmo tempo (por exemplo os tiles do
+    // TiledDetector). A cópia é um CascadeClassifier comum, feita na memória na primeira vez que for preciso, e deve ser devolvida com
+    // releaseWorker(). Só funciona com os detectores no formato novo.
+    CascadeClassifier *acquireWorker();
+    void releaseWorker(CascadeClassifier *worker);
+
+private:
+    class Worker;
+    class DetectLevelsBody;
+
+    void clearWorkers();
+
+    vector<double> m_factors;                       // A escala de cada nível da pirâmide.
+    vector<Size> m_levelSizes;
+    vector<Mat> m_pyramid;                          // Buffers dos níveis, reutilizados entre as chamadas.
+    FileStorage m_features;                         // Cópia na memória do nó "features" do detector, de onde cada cópia lê o seu avaliador.
+    vector<Ptr<CascadeClassifier> > m_workers;      // Cópias do detector para as threads, com o próprio avaliador de features.
+    vector<CascadeClassifier*> m_freeWorkers;
+    std::mutex m_mutex;
+};
@@ -7,6 +7,9 @@ const double DESIRED_LEFT_EYE_Y = 0.14;
 const double FACE_ELLIPSE_CY = 0.40;
 const double FACE_ELLIPSE_W = 0.50;         // Precisa ser pelo menos 0.5
 const double FACE_ELLIPSE_H = 0.80;         // Controla quão alta serão as máscaras
+const int EYE_SEARCH_WIDTH = 72;            // Largura máxima de cada região de busca dos olhos, para o custo não depender da resolução da câmera.
+const double EYE_MIN_SIZE = 0.12;           // Menor e maior olho procurados, em fração da largura do rosto.
+const double EYE_MAX_SIZE = 0.30;
 
 
 #include "detectObject.h"       // Detecta face ou olhos (usando LBP or Haar Cascades).
@@ -14,7 +17,44 @@ const double FACE_ELLIPSE_H = 0.80;         // Controla quão alta serão as má
 
 #include "ImageUtils.h"      // Funções úteis
 
-void detectBothEyes(const Mat &face, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2, Point &leftEye, Point &rightEye, Rect *searchedLeftEye, Rect *searchedRightEye)
+// Procura o maior olho em 'eyeRegion', uma região de busca de um rosto com 'faceWidth' pixels de largura, e retorna o centro do olho
+// nas coordenadas de 'eyeRegion', ou (-1,-1) se não encontrar. A região é reduzida para no máximo EYE_SEARCH_WIDTH pixels de largura,
+// e só olhos entre EYE_MIN_SIZE e EYE_MAX_SIZE da largura do rosto são procurados, então o custo é quase o mesmo para qualquer
+// tamanho de rosto. O centro volta para a região original sem arredondar, com precisão sub-pixel.
+static Point2f detectEyeCenter(const Mat &eyeRegion, int faceWidth, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2)
+{
+    // Reduz a região colorida antes de converter para tons de cinza (detectObjectsCustom() converte), que é mais barato.
+    Mat searchImg = eyeRegion;
+    double scale = 1.0;
+    if (eyeRegion.cols > EYE_SEARCH_WIDTH) {
+        scale = EYE_SEARCH_WIDTH / (double)eyeRegion.cols;
+        resize(eyeRegion, searchImg, Size(EYE_SEARCH_WIDTH, max(cvRound(eyeRegion.rows * scale), 1)), 0, 0, INTER_AREA);
+    }
+
+    // Os tamanhos de olho possíveis, medidos na região reduzida. O maior não pode passar da própria região.
+    int minSide = cvRound(faceWidth * EYE_MIN_SIZE * scale);
+    int maxSide = min(cvRound(faceWidth * EYE_MAX_SIZE * scale), min(searchImg.cols, searchImg.rows));
+    maxSide = max(maxSide, minSide);
+    Size minEyeSize = Size(minSide, minSide);
+    Size maxEyeSize = Size(maxSide, maxSide);
+
+    Rect eyeRect;
+    detectLargestObject(searchImg, eyeCascade1, eyeRect, searchImg.cols, false, minEyeSize, maxEyeSize);
+
+    // Se o olho não for detectado, tenta um classificador diferente
+    if (eyeRect.width <= 0 && !eyeCascade2.empty())
+        detectLargestObject(searchImg, eyeCascade2, eyeRect, searchImg.cols, false, minEyeSize, maxEyeSize);
+
+    if (eyeRect.width <= 0)
+        return Point2f(-1, -1);     // Retorna um ponto inválido
+
+    // O centro do retângulo na região reduzida, levado de volta para a região original (com o centro de cada pixel em +0.5).
+    float cx = eyeRect.x + eyeRect.width * 0.5f;
+    float cy = eyeRect.y + eyeRect.height * 0.5f;
+    return Point2f((float)((cx + 0.5) / scale - 0.5), (float)((cy + 0.5) / scale - 0.5));
+}
+
+void detectBothEyes(const Mat &face, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2, Point2f &leftEye, Point2f &rightEye, Rect *searchedLeftEye, Rect *searchedRightEye)
 {
 
     // Como padrão eye.xml ou eyeglasses.xml: Encontra ambos os olhos em cerca de 40% dos rostos detectados, mas não detecta os olhos fechados.
@@ -31,7 +71,6 @@ void detectBothEyes(const Mat &face, CascadeClassifier &eyeCascade1, CascadeClas
 
     Mat topLeftOfFace = face(Rect(leftX, topY, widthX, heightY));
     Mat topRightOfFace = face(Rect(rightX, topY, widthX, heightY));
-    Rect leftEyeRect, rightEyeRect;
 
     // Retorna a janela de pesquisa para o vistante, se desejar
     if (searchedLeftEye)
@@ -39,37 +78,17 @@ void detectBothEyes(const Mat &face, CascadeClassifier &eyeCascade1, CascadeClas
     if (searchedRightEye)
         *searchedRightEye = Rect(rightX, topY, widthX, heightY);
 
-    // Procura na região esquerda, e depois na direita usando o primeiro detector de olho
-    detectLargestObject(topLeftOfFace, eyeCascade1, leftEyeRect, topLeftOfFace.cols);
-    detectLargestObject(topRightOfFace, eyeCascade1, rightEyeRect, topRightOfFace.cols);
+    // Procura na região esquerda, e depois na direita
+    leftEye = detectEyeCenter(topLeftOfFace, face.cols, eyeCascade1, eyeCascade2);
+    rightEye = detectEyeCenter(topRightOfFace, face.cols, eyeCascade1, eyeCascade2);
 
-    // Se o olho não for detectado, tenta um classificador diferente
-    if (leftEyeRect.width <= 0 && !eyeCascade2.empty()) {
-        detectLargestObject(topLeftOfFace, eyeCascade2, leftEyeRect, topLeftOfFace.cols);
-    }
-    
-
-    // Se o olho não for detectado, tenta um classificador diferentes
-    if (rightEyeRect.width <= 0 && !eyeCascade2.empty()) {
-        detectLargestObject(topRightOfFace, eyeCascade2, rightEyeRect, topRightOfFace.cols);
-    }
-
-    if (leftEyeRect.width > 0) {   // Verifica se o olho foi detectado
-        leftEyeRect.x += leftX;    // Ajusta o retângulo do olho esquerdo porque a bordas do rosto foi removida
-        leftEyeRect.y += topY;
-        leftEye = Point(leftEyeRect.x + leftEyeRect.width/2, leftEyeRect.y + leftEyeRect.height/2);
+    if (leftEye.x >= 0) {   // Verifica se o olho foi detectado
+        leftEye.x += leftX;    // Ajusta o centro do olho esquerdo porque a bordas do rosto foi removida
+        leftEye.y += topY;
     }
-    else {
-        leftEye = Point(-1, -1);    // Retorna um ponto inválido
-    }
-
-    if (rightEyeRect.width > 0) { // Verifica se o olho foi detectado
-        rightEyeRect.x += rightX; // Ajusta o retângulo do olho direito porque a bordas do rosto foi removida 
-        rightEyeRect.y += topY;  
-        rightEye = Point(rightEyeRect.x + rightEyeRect.width/2, rightEyeRect.y + rightEyeRect.height/2);
-    }
-    else {
-        rightEye = Point(-1, -1);    // Retorna um ponto inválido
+    if (rightEye.x >= 0) { // Verifica se o olho foi detectado
+        rightEye.x += rightX; // Ajusta o centro do olho direito porque a bordas do rosto foi removida
+        rightEye.y += topY;
     }
 }
 
@@ -132,6 +151,51 @@ void equalizeLeftAndRightHalves(Mat &faceImg)
 }
 
 
+// Matriz que alinha os olhos com as posições ideais de um rosto de desiredFaceWidth x desiredFaceHeight pixels.
+Mat getFaceAlignmentMatrix(Point2f leftEye, Point2f rightEye, int desiredFaceWidth, int desiredFaceHeight)
+{
+    // Pega o centro entre os dois olhos.
+    Point2f eyesCenter = Point2f( (leftEye.x + rightEye.x) * 0.5f, (leftEye.y + rightEye.y) * 0.5f );
+
+    // Pega o Ângulo entre os dois olhos.
+    double dy = (rightEye.y - leftEye.y);
+    double dx = (rightEye.x - leftEye.x);
+    double len = sqrt(dx*dx + dy*dy);
+    double angle = atan2(dy, dx) * 180.0/CV_PI; // Convertendo radiano para graus
+
+    // Medições manuais mostraram que o centro do olho esquerdo deve ser idealmente em cerca de (0,19, 0,14) de uma imagem do rosto escalado.
+
+    const double DESIRED_RIGHT_EYE_X = (1.0f - DESIRED_LEFT_EYE_X);
+
+    // Obter a quantidade que precisamos para dimensionar a imagem para ser o tamanho fixo desejado que queremos.
+    double desiredLen = (DESIRED_RIGHT_EYE_X - DESIRED_LEFT_EYE_X) * desiredFaceWidth;
+    double scale = desiredLen / len;
+    // Obter a matriz de transformação para rotacionar e escalar a face ao ângulo e tamanho desejado.
+    Mat rot_mat = getRotationMatrix2D(eyesCenter, angle, scale);
+    // Deslocar o centro dos olhos para ser o centro desejado entre os olhos.
+    rot_mat.at<double>(0, 2) += desiredFaceWidth * 0.5f - eyesCenter.x;
+    rot_mat.at<double>(1, 2) += desiredFaceHeight * DESIRED_LEFT_EYE_Y - eyesCenter.y;
+    return rot_mat;
+}
+
+
+// Desenha a máscara elíptica do rosto e copia através dela os pixels de 'filtered' para 'dstImg'.
+void applyFaceEllipseMask(const Mat &filtered, Mat &dstImg)
+{
+    // Desenha uma elipse preenchida no meio da imagem de tamanho rosto.
+    Mat mask = Mat(filtered.size(), CV_8U, Scalar(0)); // Start with an empty mask.
+    Point faceCenter = Point( filtered.cols/2, cvRound(filtered.rows * FACE_ELLIPSE_CY) );
+    Size size = Size( cvRound(filtered.cols * FACE_ELLIPSE_W), cvRound(filtered.rows * FACE_ELLIPSE_H) );
+    ellipse(mask, faceCenter, size, 0, 0, 360, Scalar(255), CV_FILLED);
+
+    // Use a máscara para remover o pixels de fora
+    dstImg = Mat(filtered.size(), CV_8U, Scalar(128)); // Clear the output image to a default gray.
+
+    // Aplicando a máscara eliptica sobre o rosto
+    filtered.copyTo(dstImg, mask);  // Copia os pixels não mascarados de filtrada para dstImg.
+}
+
+
 
 // Cria uma imagem em tons de cinza do rosto que tem um tamanho padrão e contraste e brilho.
 // "srcImg" deve ser uma cópia de todo o quadro da câmera de cor, de modo que possa tirar as posições de olho.
@@ -145,7 +209,9 @@ void equalizeLeftAndRightHalves(Mat &faceImg)
 // Retorna uma imagem quadrada rosto pré-processados ou NULL (ou seja: não conseguiu detectar o rosto e dois olhos).
 // Se um rosto for encontrado, ele pode armazenar as coordenadas rect em 'storeFaceRect' e 'storeLeftEye' e 'storeRightEye',
 // E regiões de busca de olho em 'searchedLeftEye' e 'searchedRightEye'.
-Mat getPreprocessedFace(Mat &srcImg, int desiredFaceWidth, CascadeClassifier &faceCascade, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2, bool doLeftAndRightSeparately, Rect *storeFaceRect, Point *storeLeftEye, Point *storeRightEye, Rect *searchedLeftEye, Rect *searchedRightEye)
+// Se 'useSkinFilter' é verdade, o rosto só é procurado nas regiões com cor de pele da imagem, o que é bem mais rápido quando a maior parte da imagem é o fundo.
+// 'denoiseMode' escolhe a implementação do filtro bilateral (um dos valores de FaceDenoiseMode).
+Mat getPreprocessedFace(Mat &srcImg, int desiredFaceWidth, CascadeClassifier &faceCascade, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2, bool doLeftAndRightSeparately, Rect *storeFaceRect, Point *storeLeftEye, Point *storeRightEye, Rect *searchedLeftEye, Rect *searchedRightEye, bool useSkinFilter, int denoiseMode)
 {
     // Use rotos quadrados
     int desiredFaceHeight = desiredFaceWidth;
@@ -165,7 +231,7 @@ Mat getPreprocessedFace(Mat &srcImg, int desiredFaceWidth, CascadeClassifier &fa
 
     // Acha o rosto mais largo
     Rect faceRect;
-    detectLargestObject(srcImg, faceCascade, faceRect);
+    detectLargestObject(srcImg, faceCascade, faceRect, 320, useSkinFilter);
 
     // Verifica se o rosto foi detectado
     if (faceRect.width > 0) {
@@ -177,29 +243,18 @@ Mat getPreprocessedFace(Mat &srcImg, int desiredFaceWidth, CascadeClassifier &fa
 
         Mat faceImg = srcImg(faceRect);    // Pega o rosto detectado
 
-        // Se a imagem de entrada não está em escala de cinza, convertemos para BGR ou BGRA color para escala de cinza.
-        Mat gray;
-        if (faceImg.channels() == 3) {
-            cvtColor(faceImg, gray, CV_BGR2GRAY);
-        }
-        else if (faceImg.channels() == 4) {
-            cvtColor(faceImg, gray, CV_BGRA2GRAY);
-        }
-        else {
-            // Acessa a imagem de entrada diretamente, desde que ela esteja em escala de cinza
-            gray = faceImg;
-        }
-
+        // O rosto não é convertido para tons de cinza inteiro: a detecção de olhos converte só as regiões onde procura os olhos,
+        // e warpFace() converte só os pixels que usa.
 
-        // Procura pelos 2 olhos com a resolução inteira, porque a detecção de olhos precisa da máxima resolução possível
-        Point leftEye, rightEye;
-        detectBothEyes(gray, eyeCascade1, eyeCascade2, leftEye, rightEye, searchedLeftEye, searchedRightEye);
+        // Procura pelos 2 olhos, em uma resolução limitada mas com os centros com precisão sub-pixel (veja detectEyeCenter()).
+        Point2f leftEye, rightEye;
+        detectBothEyes(faceImg, eyeCascade1, eyeCascade2, leftEye, rightEye, searchedLeftEye, searchedRightEye);
 
         // Devolve os olhos encontrados se o usuário desejar
         if (storeLeftEye)
-            *storeLeftEye = leftEye;
+            *storeLeftEye = (leftEye.x >= 0) ? Point(cvRound(leftEye.x), cvRound(leftEye.y)) : Point(-1, -1);
         if (storeRightEye)
-            *storeRightEye = rightEye;
+            *storeRightEye = (rightEye.x >= 0) ? Point(cvRound(rightEye.x), cvRound(rightEye.y)) : Point(-1, -1);
 
         // Checa ambos os olhos forma detectados
         if (leftEye.x >= 0 && rightEye.x >= 0) {
@@ -210,32 +265,14 @@ Mat getPreprocessedFace(Mat &srcImg, int desiredFaceWidth, CascadeClassifier &fa
             // Alinhar perfeitamente com as posições ideais dos olhos. Isso garante que os olhos estarão na horizontal,
             // e não muito distante para Esquerda OU Direita do Rosto, etc.
 
-            // Pega o centro entre os dois olhos.
-            Point2f eyesCenter = Point2f( (leftEye.x + rightEye.x) * 0.5f, (leftEye.y + rightEye.y) * 0.5f );
-  
-            // Pega o Ângulo entre os dois olhos.
-            double dy = (rightEye.y - leftEye.y);
-            double dx = (rightEye.x - leftEye.x);
-            double len = sqrt(dx*dx + dy*dy);
-            double angle = atan2(dy, dx) * 180.0/CV_PI; // Convertendo radiano para graus
-
-            // Medições manuais mostraram que o centro do olho esquerdo deve ser idealmente em cerca de (0,19, 0,14) de uma imagem do rosto escalado.
-
-            const double DESIRED_RIGHT_EYE_X = (1.0f - DESIRED_LEFT_EYE_X);
-
-            // Obter a quantidade que precisamos para dimensionar a imagem para ser o tamanho fixo desejado que queremos.
-            double desiredLen = (DESIRED_RIGHT_EYE_X - DESIRED_LEFT_EYE_X) * desiredFaceWidth;
-            double scale = desiredLen / len;
-            // Obter a matriz de transformação para rotacionar e escalar a face ao ângulo e tamanho desejado.
-            Mat rot_mat = getRotationMatrix2D(eyesCenter, angle, scale);
-            // Deslocar o centro dos olhos para ser o centro desejado entre os olhos.
-            rot_mat.at<double>(0, 2) += desiredFaceWidth * 0.5f - eyesCenter.x;
-            rot_mat.at<double>(1, 2) += desiredFaceHeight * DESIRED_LEFT_EYE_Y - eyesCenter.y;
+            Mat rot_mat = getFaceAlignmentMatrix(leftEye, rightEye, desiredFaceWidth, desiredFaceHeight);
 
             // Rotacionar, escalar e traduzir a imagem para o ângulo e tamanho e posição desejada!
             // Note-se que usamos "w" para a altura, em vez de 'h', porque a cara de entrada tem 1: 1 de relação de aspecto.
-            Mat warped = Mat(desiredFaceHeight, desiredFaceWidth, CV_8U, Scalar(128)); // Limpar a imagem de saída para um cinza padrão.
-            warpAffine(gray, warped, rot_mat, warped.size());
+            // warpFace() lê direto da imagem colorida e dá o mesmo resultado que cvtColor() e warpAffine(gray, warped, rot_mat, warped.size()).
+            // O que fica fora da região do rosto é preto, como o warpAffine() já fazia (a borda dele é constante e zero).
+            Mat warped;
+            warpFace(faceImg, rot_mat, warped, Size(desiredFaceWidth, desiredFaceHeight));
             
             // Dê um brilho a imagem padrão e contraste, no caso, era muito escuro ou tinham baixo contraste.
             if (!doLeftAndRightSeparately) {
@@ -249,22 +286,13 @@ Mat getPreprocessedFace(Mat &srcImg, int desiredFaceWidth, CascadeClassifier &fa
             
 
             // Use o "filtro Bilateral" para reduzir o ruído dos pixels para suavizar a imagem, mas mantendo as bordas afiadas na cara.
+            // O filtro é o mesmo bilateralFilter(warped, filtered, 0, 20.0, 2.0), com código especializado (veja faceDenoise.h).
             Mat filtered = Mat(warped.size(), CV_8U);
-            bilateralFilter(warped, filtered, 0, 20.0, 2.0);
+            denoiseFace(warped, filtered, denoiseMode);
            
             // Filtre os cantos do rosto, uma vez que, principalmente, só se preocupamos com as partes do meio.
-            // Desenha uma elipse preenchida no meio da imagem de tamanho rosto.
-            Mat mask = Mat(warped.size(), CV_8U, Scalar(0)); // Start with an empty mask.
-            Point faceCenter = Point( desiredFaceWidth/2, cvRound(desiredFaceHeight * FACE_ELLIPSE_CY) );
-            Size size = Size( cvRound(desiredFaceWidth * FACE_ELLIPSE_W), cvRound(desiredFaceHeight * FACE_ELLIPSE_H) );
-            ellipse(mask, faceCenter, size, 0, 0, 360, Scalar(255), CV_FILLED);
-          
-            // Use a máscara para remover o pixels de fora
-            Mat dstImg = Mat(warped.size(), CV_8U, Scalar(128)); // Clear the output image to a default gray.
-           
-            // Apply the elliptical mask on the face.
-            // Aplicando a máscara eliptica sobre o rosto
-            filtered.copyTo(dstImg, mask);  // Copia os pixels não mascarados de filtrada para dstImg.
+            Mat dstImg;
+            applyFaceEllipseMask(filtered, dstImg);
             //imshow("dstImg", dstImg);
 
         
@@ -7,13 +7,23 @@
 
 #include "opencv2/opencv.hpp"
 
+#include "faceDenoise.h"        // FaceDenoiseMode.
+#include "faceWarp.h"           // warpFace().
+
 
 using namespace cv;
 using namespace std;
 
-void detectBothEyes(const Mat &face, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2, Point &leftEye, Point &rightEye, Rect *searchedLeftEye = NULL, Rect *searchedRightEye = NULL);
+void detectBothEyes(const Mat &face, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2, Point2f &leftEye, Point2f &rightEye, Rect *searchedLeftEye = NULL, Rect *searchedRightEye = NULL);
 
 void equalizeLeftAndRightHalves(Mat &faceImg);
 
-Mat getPreprocessedFace(Mat &srcImg, int desiredFaceWidth, CascadeClassifier &faceCascade, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2, bool doLeftAndRightSeparately, Rect *storeFaceRect = NULL, Point *storeLeftEye = NULL, Point *storeRightEye = NULL, Rect *searchedLeftEye = NULL, Rect *searchedRightEye = NULL);
+// Matriz que gira, escala e desloca a região do rosto para que os olhos fiquem nas posições ideais de um rosto de
+// desiredFaceWidth x desiredFaceHeight pixels, a mesma que getPreprocessedFace() passa para warpFace().
+Mat getFaceAlignmentMatrix(Point2f leftEye, Point2f rightEye, int desiredFaceWidth, int desiredFaceHeight);
+
+// Copia para 'dstImg' (cinza fora da elipse) só os pixels de 'filtered' dentro da elipse do rosto, como em getPreprocessedFace().
+void applyFaceEllipseMask(const Mat &filtered, Mat &dstImg);
+
+Mat getPreprocessedFace(Mat &srcImg, int desiredFaceWidth, CascadeClassifier &faceCascade, CascadeClassifier &eyeCascade1, CascadeClassifier &eyeCascade2, bool doLeftAndRightSeparately, Rect *storeFaceRect = NULL, Point *storeLeftEye = NULL, Point *storeRightEye = NULL, Rect *searchedLeftEye = NULL, Rect *searchedRightEye = NULL, bool useSkinFilter = false, int denoiseMode = FACE_DENOISE_QUALITY);
 
@@ -6,29 +6,84 @@
 #include "recognition.h"     // Treinar o sistema de reconhecimento facial e reconhecimento de uma pessoa a partir de uma imagem.
 
 #include "ImageUtils.h"
+#include "asyncLog.h"       // Log assíncrono para as mensagens de cada frame.
+#include "fastFaceRecognizer.h"     // Registra "FaceRecognizer.FastEigenfaces" e "FaceRecognizer.FastFisherfaces".
+#include "fastLBPHFaceRecognizer.h"     // Registra "FaceRecognizer.FastLBPH".
+
+// Cria o FaceRecognizer do algoritmo. Os algoritmos do próprio projeto são criados diretamente, sem precisar do módulo "contrib"
+// carregado; os do OpenCV precisam dele, e se não estiverem disponíveis um erro é escrito e um ponteiro vazio é retornado.
+static Ptr<FaceRecognizer> createFaceRecognizer(const string &facerecAlgorithm)
+{
+    if (facerecAlgorithm == "FaceRecognizer.FastEigenfaces")
+        return createFastEigenFaceRecognizer();
+    if (facerecAlgorithm == "FaceRecognizer.FastFisherfaces")
+        return createFastFisherFaceRecognizer();
+    if (facerecAlgorithm == "FaceRecognizer.FastLBPH")
+        return createFastLBPHFaceRecognizer();
+
+    // Verifique se o módulo "contrib" é carregado dinamicamente em tempo de execução.
+    bool haveContribModule = initModule_contrib();
+    if (!haveContribModule) {
+        ALOG(LOG_LEVEL_ERROR, "The 'contrib' module is needed for the [%s] FaceRecognizer but has not been loaded into OpenCV!", facerecAlgorithm.c_str());
+        return Ptr<FaceRecognizer>();
+    }
+
+    // Use a nova classe FaceRecognizer no módulo "contrib" do OpenCV:
+    Ptr<FaceRecognizer> model = Algorithm::create<FaceRecognizer>(facerecAlgorithm);
+    if (model.empty())
+        ALOG(LOG_LEVEL_ERROR, "The FaceRecognizer algorithm [%s] is not available in your version of OpenCV. Please update to OpenCV v2.4.1 or newer.", facerecAlgorithm.c_str());
+    return model;
+}
 
 // Iniciar a formação dos rostos recolhidos.
 // "FaceRecognizer.Eigenfaces": Eigenfaces, também referidos como PCA (Turk e Pentland, 1991).
 // "FaceRecognizer.Fisherfaces": Fisherfaces, também referidos como LDA (Belhumeur et al, 1997).
 // "FaceRecognizer.LBPH": local padrão binário histogramas (Ahonen et al, 2006).
-Ptr<FaceRecognizer> learnCollectedFaces(const vector<Mat> preprocessedFaces, const vector<int> faceLabels, const string facerecAlgorithm)
+// "FaceRecognizer.FastEigenfaces" e "FaceRecognizer.FastFisherfaces": o mesmo que Eigenfaces e Fisherfaces, mas treinando com várias threads.
+// "FaceRecognizer.FastLBPH": LBPH com SSE2 e os histogramas da galeria em uma única matriz.
+Ptr<FaceRecognizer> learnCollectedFaces(const vector<Mat> preprocessedFaces, const vector<int> faceLabels, const string facerecAlgorithm,
+                                        int maxComponents, double explainedVariance, bool mirrorFaces, double lbphThreshold)
 {
-    Ptr<FaceRecognizer> model;
+    ALOG(LOG_LEVEL_INFO, "Learning the collected faces using the [%s] algorithm ...", facerecAlgorithm.c_str());
 
-    cout << "Learning the collected faces using the [" << facerecAlgorithm << "] algorithm ..." << endl;
+    Ptr<FaceRecognizer> model = createFaceRecognizer(facerecAlgorithm);
+    if (model.empty())
+        return model;
 
-    // Verifique se o módulo "contrib" é carregado dinamicamente em tempo de execução.
-    bool haveContribModule = initModule_contrib();
-    if (!haveContribModule) {
-        cerr << "ERROR: The 'contrib' module is needed for FaceRecognizer but has not been loaded into OpenCV!" << endl;
-        exit(1);
+    // Menos componentes deixam o reconhecimento mais rápido (veja benchRecognition). O LBPH não tem componentes.
+    vector<string> params;
+    model->getParams(params);
+    if (maxComponents > 0 && find(params.begin(), params.end(), "ncomponents") != params.end())
+        model->set("ncomponents", maxComponents);
+    if (explainedVariance > 0.0 && explainedVariance < 1.0) {
+        if (find(params.begin(), params.end(), "variance") != params.end())
+            model->set("variance", explainedVariance);
+        else
+            ALOG(LOG_LEVEL_WARNING, "The [%s] algorithm does not support limiting the explained variance, keeping all the components.", facerecAlgorithm.c_str());
     }
 
-    // Use a nova classe FaceRecognizer no módulo "contrib" do OpenCV:
-    model = Algorithm::create<FaceRecognizer>(facerecAlgorithm);
-    if (model.empty()) {
-        cerr << "ERROR: The FaceRecognizer algorithm [" << facerecAlgorithm << "] is not available in your version of OpenCV. Please update to OpenCV v2.4.1 or newer." << endl;
-        exit(1);
+    // O LBPH não reconstrói o rosto, então é o seu "threshold" que separa as pessoas desconhecidas (o padrão aceita qualquer distância).
+    // O "threshold" dos outros algoritmos está em outra escala, e para eles quem decide é a semelhança da reconstrução.
+    bool isLBPH = (facerecAlgorithm == "FaceRecognizer.LBPH" || facerecAlgorithm == "FaceRecognizer.FastLBPH");
+    if (isLBPH && lbphThreshold > 0.0 && find(params.begin(), params.end(), "threshold") != params.end())
+        model->set("threshold", lbphThreshold);
+
+    // Também adicionar a imagem de espelho para o conjunto de treinamento, por isso temos mais dados de treinamento, bem como para lidar
+    // com rostos olhando para a esquerda ou para a direita. Se o algoritmo sabe ler os rostos espelhados, eles não precisam ser criados.
+    if (mirrorFaces && find(params.begin(), params.end(), "mirror") != params.end()) {
+        model->set("mirror", true);
+    }
+    else if (mirrorFaces) {
+        vector<Mat> faces = preprocessedFaces;
+        vector<int> labels = faceLabels;
+        for (size_t i = 0; i < preprocessedFaces.size(); i++) {
+            Mat mirroredFace;
+            flip(preprocessedFaces[i], mirroredFace, 1);
+            faces.push_back(mirroredFace);
+            labels.push_back(faceLabels[i]);
+        }
+        model->train(faces, labels);
+        return model;
     }
 
     // Faça o treinamento real dos rostos recolhidos. Pode demorar alguns segundos ou minutos, dependendo de entrada!
@@ -98,6 +153,11 @@ void showTrainingDebugData(const Ptr<FaceRecognizer> model, const int faceWidth,
 // Gerar um rosto aproximadamente reconstruído por back-projecting pelos eigenvectors e eigenvalues do dado (pré-processado).
 Mat reconstructFace(const Ptr<FaceRecognizer> model, const Mat preprocessedFace)
 {
+    // O LBPH não tem um subespaço onde reconstruir o rosto. O rosto é devolvido como está (então getSimilarity() dá 0), e quem
+    // decide se é uma pessoa desconhecida é o "threshold" do próprio LBPH, com predict() retornando -1.
+    if (model->info()->name() == "FaceRecognizer.LBPH" || model->info()->name() == "FaceRecognizer.FastLBPH")
+        return preprocessedFace;
+
     // Uma vez que só podemos reconstruir o rosto para alguns tipos de modelos FaceRecognizer (ou seja: Eigenfaces ou Fisherfaces),
     // Devemos cercar as chamadas OpenCV por um bloco try / catch para que não bata em outros modelos.
     try {
@@ -144,7 +204,272 @@ double getSimilarity(const Mat A, const Mat B)
         return similarity;
     }
     else {
-        cout << "WARNING: Images have a different size in 'getSimilarity()'." << endl;
+        ALOG_EVERY_MS(1000, LOG_LEVEL_WARNING, "Images have a different size in 'getSimilarity()'.");
         return 100000000.0;  // Return a bad value
     }
 }
+
+
+const int BATCH_ROWS_PER_STRIPE = 16;    // Quantos rostos de um lote cada thread processa de uma vez.
+
+
+BatchRecognizer::BatchRecognizer(const Ptr<FaceRecognizer> &model) : m_threshold(DBL_MAX)
+{
+    try {
+        Mat eigenvectors = model->get<Mat>("eigenvectors");
+        Mat mean = model->get<Mat>("mean");
+        vector<Mat> projections = model->get<vector<Mat> >("projections");
+        Mat labels = model->get<Mat>("labels");
+        m_threshold = model->get<double>("threshold");
+        if (eigenvectors.empty() || projections.empty())
+            return;
+
+        // Os modelos do OpenCV usam CV_64F, mas CV_32F é suficiente e duas vezes mais rápido.
+        eigenvectors.convertTo(m_eigenvectors, CV_32F);
+        mean.reshape(1, 1).convertTo(m_mean, CV_32F);
+        m_gallery.create((int)projections.size(), m_eigenvectors.cols, CV_64F);
+        for (int i = 0; i < (int)projections.size(); i++) {
+            Mat row = m_gallery.row(i);
+            projections[i].reshape(1, 1).convertTo(row, CV_64F);
+        }
+        reduce(m_gallery.mul(m_gallery), m_galleryNorms, 1, CV_REDUCE_SUM);
+        m_galleryNorms = m_galleryNorms.reshape(1, 1);
+        Mat labels32;
+        labels.reshape(1, 1).convertTo(labels32, CV_32S);
+        m_labels.assign(labels32.ptr<int>(0), labels32.ptr<int>(0) + labels32.total());
+    } catch (cv::Exception e) {
+        cout << "WARNING: Missing FaceRecognizer properties." << endl;
+        m_eigenvectors.release();
+    }
+}
+
+// Reconhece uma faixa dos rostos do lote. Cada thread processa suas faixas com suas próprias multiplicações de matrizes.
+class BatchRecognizer::RecognizeRowsBody : public ParallelLoopBody
+{
+public:
+    RecognizeRowsBody(const BatchRecognizer &recognizer, const vector<Mat> &faces, vector<RecognitionResult> &results)
+        : m_recognizer(recognizer), m_faces(faces), m_results(results) {}
+
+    virtual void operator()(const Range &range) const
+    {
+        const BatchRecognizer &r = m_recognizer;
+        int n = range.end - range.start;
+        int d = r.m_eigenvectors.rows;
+
+        // Empilha os rostos, um por linha, já sem a média.
+        Mat faces = Mat(n, d, CV_32F);
+        Mat faces8U = Mat(n, d, CV_8U);
+        vector<bool> valid(n);
+        for (int i = 0; i < n; i++) {
+            const Mat &face = m_faces[range.start + i];
+            Mat row = faces.row(i);
+            Mat row8U = faces8U.row(i);
+            valid[i] = ((int)face.total() == d && face.type() == CV_8UC1);
+            if (valid[i]) {
+                Mat continuous = face.isContinuous() ? face : face.clone();
+                continuous.reshape(1, 1).copyTo(row8U);
+                row8U.convertTo(row, CV_32F);
+                row -= r.m_mean;
+            }
+            else {
+                row.setTo(Scalar::all(0));
+            }
+        }
+
+        // Projeta todos os rostos no subespaço, e reconstrói todos eles.
+        Mat projections, reconstructions;
+        gemm(faces, r.m_eigenvectors, 1.0, noArray(), 0.0, projections);
+        gemm(projections, r.m_eigenvectors, 1.0, noArray(), 0.0, reconstructions, GEMM_2_T);
+
+        // Distância de cada rosto para cada rosto da galeria: |y - p|^2 = |y|^2 + |p|^2 - 2 * y.p
+        // Para rostos quase iguais aos da galeria os termos quase se cancelam, e em float o erro mudaria o rosto mais próximo.
+        // Em double sobra só o erro da projeção em float, muito menor que a diferença entre dois rostos diferentes.
+        Mat projections64F, products, projectionNorms;
+        projections.convertTo(projections64F, CV_64F);
+        gemm(projections64F, r.m_gallery, 1.0, noArray(), 0.0, products, GEMM_2_T);
+        reduce(projections64F.mul(projections64F), projectionNorms, 1, CV_REDUCE_SUM);
+
+        Mat reconstructed8U;
+        for (int i = 0; i < n; i++) {
+            RecognitionResult &result = m_results[range.start + i];
+            result.label = -1;
+            result.distance = DBL_MAX;
+            result.similarity = 100000000.0;  // Mesmo valor ruim que getSimilarity() dá.
+            if (!valid[i])
+                continue;
+
+            // Mesmo cálculo que reconstructFace() seguido de getSimilarity().
+            Mat reconstruction = reconstructions.row(i);
+            reconstruction += r.m_mean;
+            reconstruction.convertTo(reconstructed8U, CV_8U);
+            result.similarity = norm(faces8U.row(i), reconstructed8U, NORM_L2) / (double)d;
+
+            const double *p = products.ptr<double>(i);
+            const double *galleryNorms = r.m_galleryNorms.ptr<double>(0);
+            double yNorm = projectionNorms.at<double>(i);
+            int best = -1;
+            double bestDist = DBL_MAX;
+            for (int j = 0; j < r.m_gallery.rows; j++) {
+                double dist = yNorm + galleryNorms[j] - 2.0 * p[j];
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best = j;
+                }
+            }
+            double distance = sqrt(max(bestDist, 0.0));
+            if (best >= 0 && distance < r.m_threshold) {
+                result.label = r.m_labels[best];
+                result.distance = distance;
+            }
+        }
+    }
+
+private:
+    const BatchRecognizer &m_recognizer;
+    const vector<Mat> &m_faces;
+    vector<RecognitionResult> &m_results;
+};
+
+void BatchRecognizer::recognize(const vector<Mat> &preprocessedFaces, vector<RecognitionResult> &results) const
+{
+    int n = (int)preprocessedFaces.size();
+    results.resize(n);
+    if (n == 0)
+        return;
+    if (!isValid()) {
+        cout << "WARNING: BatchRecognizer needs a trained Eigenfaces or Fisherfaces model." << endl;
+        for (int i = 0; i < n; i++) {
+            results[i].label = -1;
+            results[i].distance = DBL_MAX;
+            results[i].similarity = 100000000.0;
+        }
+        return;
+    }
+    parallel_for_(Range(0, n), RecognizeRowsBody(*this, preprocessedFaces, results), max(n / BATCH_ROWS_PER_STRIPE, 1));
+}
+
+
+TrainingEngine::TrainingEngine(RecognizerHandle &handle) : m_handle(handle), m_training(false), m_generation(0), m_version(0)
+{
+}
+
+TrainingEngine::~TrainingEngine()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+bool TrainingEngine::startTraining(const vector<Mat> &preprocessedFaces, const vector<int> &faceLabels, const string &facerecAlgorithm,
+                                   int maxComponents, double explainedVariance, bool mirrorFaces, double lbphThreshold)
+{
+    if (m_training)
+        return false;
+    // A thread do treinamento anterior já terminou, mas ainda precisa ser liberada.
+    if (m_thread.joinable())
+        m_thread.join();
+
+    int generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        generation = m_generation;
+    }
+    m_training = true;
+    m_thread = std::thread(&TrainingEngine::run, this, preprocessedFaces, faceLabels, facerecAlgorithm, maxComponents, explainedVariance, mirrorFaces, lbphThreshold, generation);
+    return true;
+}
+
+bool TrainingEngine::isTraining() const
+{
+    return m_training;
+}
+
+void TrainingEngine::discardTraining()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generation++;
+}
+
+bool TrainingEngine::relabelPerson(int label, int newLabel)
+{
+    int64 start = getTickCount();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // O treinamento que estiver rodando ainda conhece a pessoa com o nome antigo.
+    m_generation++;
+    std::shared_ptr<const RecognizerModel> current = m_handle.get();
+    if (!current)
+        return true;
+
+    std::shared_ptr<RecognizerModel> model = std::make_shared<RecognizerModel>(*current);
+    string facerecAlgorithm = current->recognizer->info()->name();
+    const FastSubspaceFaceRecognizer *subspace = dynamic_cast<const FastSubspaceFaceRecognizer*>((const FaceRecognizer*)current->recognizer);
+    const FastLBPH *lbph = dynamic_cast<const FastLBPH*>((const FaceRecognizer*)current->recognizer);
+    bool downdated = (subspace != NULL || lbph != NULL);
+    if (downdated) {
+        model->recognizer = subspace ? subspace->relabeled(label, newLabel) : lbph->relabeled(label, newLabel);
+        model->numFaces = (int)model->recognizer->get<Mat>("labels").total();
+        if (subspace && subspace->getMirrorFaces())
+            model->numFaces /= 2;
+        model->backend = (model->numFaces > 0) ? createRecognizerBackend(model->recognizer, facerecAlgorithm, model->faceSize) : std::shared_ptr<RecognizerBackend>();
+    }
+    else {
+        model->backend = createRelabeledBackend(current->backend, label, newLabel);
+    }
+    model->trainingMs = (getTickCount() - start) * 1000.0 / getTickFrequency();
+
+    // Sem nenhum rosto na galeria, não há modelo.
+    if (downdated && model->numFaces == 0) {
+        m_handle.set(std::shared_ptr<const RecognizerModel>());
+        ALOG(LOG_LEVEL_INFO, "Removed person %d, no faces are left in model %d.", label, current->version);
+        return true;
+    }
+    model->version = ++m_version;
+    model->publishedTicks = getTickCount();
+    m_handle.set(model);
+    if (newLabel < 0)
+        ALOG(LOG_LEVEL_INFO, "Removed person %d from model %d, published model %d in %.2f ms (%s).", label, current->version, model->version, model->trainingMs,
+             downdated ? "gallery downdated" : "results relabeled, needs retraining");
+    else
+        ALOG(LOG_LEVEL_INFO, "Merged person %d into person %d in model %d, published model %d in %.2f ms (%s).", label, newLabel, current->version, model->version, model->trainingMs,
+             downdated ? "gallery downdated" : "results relabeled, needs retraining");
+    return downdated;
+}
+
+void TrainingEngine::run(vector<Mat> preprocessedFaces, vector<int> faceLabels, string facerecAlgorithm, int maxComponents, double explainedVariance, bool mirrorFaces, double lbphThreshold, int generation)
+{
+    int64 start = getTickCount();
+    Ptr<FaceRecognizer> recognizer;
+    try {
+        recognizer = learnCollectedFaces(preprocessedFaces, faceLabels, facerecAlgorithm, maxComponents, explainedVariance, mirrorFaces, lbphThreshold);
+    } catch (cv::Exception &e) {
+        ALOG(LOG_LEVEL_ERROR, "Training failed: %s", e.what());
+        recognizer.release();
+    }
+    double trainingMs = (getTickCount() - start) * 1000.0 / getTickFrequency();
+
+    if (!recognizer.empty()) {
+        std::shared_ptr<RecognizerModel> model = std::make_shared<RecognizerModel>();
+        model->recognizer = recognizer;
+        // O backend lê as propriedades do modelo aqui, em segundo plano, e não no loop dos frames.
+        model->backend = createRecognizerBackend(recognizer, facerecAlgorithm, preprocessedFaces[0].size());
+        model->faceSize = preprocessedFaces[0].size();
+        model->numFaces = (int)preprocessedFaces.size();
+        model->trainingMs = trainingMs;
+
+        // Publica o novo modelo, a não ser que a galeria tenha sido apagada durante o treinamento.
+        double swapUs = 0;
+        bool published = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (generation == m_generation) {
+                model->version = ++m_version;
+                model->publishedTicks = getTickCount();
+                m_handle.set(model);
+                swapUs = (getTickCount() - model->publishedTicks) * 1000000.0 / getTickFrequency();
+                published = true;
+            }
+        }
+        if (published)
+            ALOG(LOG_LEVEL_INFO, "Trained model %d from %d faces in %.1f ms (swap took %.1f us).", model->version, model->numFaces, trainingMs, swapUs);
+    }
+    m_training = false;
+}
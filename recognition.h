@@ -4,16 +4,120 @@
 #include <stdio.h>
 #include <iostream>
 #include <vector>
+#include <float.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
 #include "opencv2/opencv.hpp"
 
+#include "recognizerBackend.h"      // RecognizerBackend e RecognitionResult.
+
 
 using namespace cv;
 using namespace std;
 
-Ptr<FaceRecognizer> learnCollectedFaces(const vector<Mat> preprocessedFaces, const vector<int> faceLabels, const string facerecAlgorithm = "FaceRecognizer.Eigenfaces");
+// 'maxComponents' limita o número de componentes (propriedade "ncomponents", 0 para não limitar), e 'explainedVariance' mantém apenas
+// os componentes que explicam essa fração da variância (propriedade "variance", só existe em FastEigenfaces e FastFisherfaces).
+// Se 'mirrorFaces' for true, também treina com a imagem espelhada de cada rosto: os algoritmos com a propriedade "mirror" (FastEigenfaces
+// e FastFisherfaces) leem os rostos espelhados direto dos originais, e para os outros as cópias espelhadas são criadas só para o treinamento.
+// 'lbphThreshold' é a distância a partir da qual o LBPH e o FastLBPH retornam -1 (propriedade "threshold", 0 para não limitar).
+// Retorna um ponteiro vazio se o algoritmo não estiver disponível.
+Ptr<FaceRecognizer> learnCollectedFaces(const vector<Mat> preprocessedFaces, const vector<int> faceLabels, const string facerecAlgorithm = "FaceRecognizer.Eigenfaces",
+                                        int maxComponents = 0, double explainedVariance = 0.0, bool mirrorFaces = false, double lbphThreshold = 0.0);
 
 void showTrainingDebugData(const Ptr<FaceRecognizer> model, const int faceWidth, const int faceHeight);
 
 Mat reconstructFace(const Ptr<FaceRecognizer> model, const Mat preprocessedFace);
 
 double getSimilarity(const Mat A, const Mat B);
+
+// Reconhece vários rostos de uma vez (por exemplo todos os rostos de um frame, ou um arquivo inteiro de rostos) com modelos de subespaço
+// (Eigenfaces ou Fisherfaces). Os rostos são empilhados em uma matriz, e a projeção, a reconstrução e a distância para todos os rostos
+// da galeria são calculadas com uma multiplicação de matrizes cada, em vez de uma multiplicação vetor-matriz por rosto.
+// As propriedades do modelo são lidas uma vez no construtor, então crie um novo BatchRecognizer para cada novo modelo.
+class BatchRecognizer
+{
+public:
+    BatchRecognizer(const Ptr<FaceRecognizer> &model);
+
+    // false se o modelo não é um modelo de subespaço, ou ainda não foi treinado.
+    bool isValid() const { return !m_eigenvectors.empty(); }
+
+    void recognize(const vector<Mat> &preprocessedFaces, vector<RecognitionResult> &results) const;
+
+private:
+    class RecognizeRowsBody;
+
+    Mat m_eigenvectors;     // D x K (CV_32F).
+    Mat m_mean;             // 1 x D (CV_32F).
+    Mat m_gallery;          // As projeções dos rostos da galeria, G x K (CV_64F, veja RecognizeRowsBody).
+    Mat m_galleryNorms;     // O quadrado da norma de cada projeção da galeria, 1 x G (CV_64F).
+    vector<int> m_labels;
+    double m_threshold;
+};
+
+// Um modelo treinado, com as informações do treinamento. Nunca é modificado depois de publicado, então pode ser usado por várias threads.
+struct RecognizerModel
+{
+    Ptr<FaceRecognizer> recognizer;
+    std::shared_ptr<RecognizerBackend> backend;     // Usado para reconhecer os rostos de cada frame.
+    int version;                // Aumenta a cada novo modelo publicado.
+    Size faceSize;              // Tamanho dos rostos do treinamento.
+    int numFaces;               // Quantos rostos foram usados no treinamento (sem contar os espelhados).
+    double trainingMs;          // Quanto tempo o treinamento levou.
+    int64 publishedTicks;       // Quando o modelo foi publicado (getTickCount()), para medir quanto tempo até ele ser usado.
+};
+
+// Guarda o modelo atual. A troca de modelo é atômica, e como o modelo tem um contador de referências, cada frame pega o modelo
+// uma vez com get() e continua usando o mesmo modelo até o fim, mesmo se um novo modelo for publicado no meio do frame.
+class RecognizerHandle
+{
+public:
+    std::shared_ptr<const RecognizerModel> get() const { return std::atomic_load(&m_model); }
+    void set(const std::shared_ptr<const RecognizerModel> &model) { std::atomic_store(&m_model, model); }
+
+private:
+    std::shared_ptr<const RecognizerModel> m_model;
+};
+
+// Treina novos modelos em uma thread separada, a partir de uma cópia da galeria de rostos, e publica cada novo modelo em um RecognizerHandle.
+// O reconhecimento continua usando o modelo antigo enquanto o novo está sendo treinado.
+class TrainingEngine
+{
+public:
+    TrainingEngine(RecognizerHandle &handle);
+    ~TrainingEngine();
+
+    // Começa a treinar com uma cópia das listas de rostos e nomes (as imagens não são copiadas, então elas não devem ser modificadas).
+    // 'maxComponents', 'explainedVariance', 'mirrorFaces' e 'lbphThreshold' são passados para learnCollectedFaces().
+    // Retorna false se um treinamento ainda está rodando.
+    bool startTraining(const vector<Mat> &preprocessedFaces, const vector<int> &faceLabels, const string &facerecAlgorithm,
+                       int maxComponents = 0, double explainedVariance = 0.0, bool mirrorFaces = false, double lbphThreshold = 0.0);
+
+    // Continua true até o novo modelo ter sido publicado (ou o treinamento ter falhado).
+    bool isTraining() const;
+
+    // Descarta o resultado do treinamento atual, por exemplo se os rostos foram apagados enquanto ele rodava.
+    void discardTraining();
+
+    // Troca o nome 'label' por 'newLabel' no modelo publicado (juntando as duas pessoas), ou remove a pessoa se 'newLabel' for negativo,
+    // sem treinar de novo: FastEigenfaces, FastFisherfaces e FastLBPH atualizam só a galeria de projeções (ou de histogramas) e a
+    // tabela de nomes. O novo modelo é publicado como os modelos treinados, então o reconhecimento continua com o modelo anterior até
+    // a troca, e a pessoa removida nunca é reconhecida pelos modelos seguintes. O treinamento que estiver rodando é descartado, já que
+    // ele usa a galeria antiga. Retorna false se o modelo precisa ser treinado de novo: os algoritmos do OpenCV só trocam o nome nos
+    // resultados (a pessoa removida vira -1 em vez da pessoa mais próxima).
+    bool relabelPerson(int label, int newLabel);
+    bool removePerson(int label) { return relabelPerson(label, -1); }
+
+private:
+    void run(vector<Mat> preprocessedFaces, vector<int> faceLabels, string facerecAlgorithm, int maxComponents, double explainedVariance, bool mirrorFaces, double lbphThreshold, int generation);
+
+    RecognizerHandle &m_handle;
+    std::thread m_thread;
+    std::atomic<bool> m_training;
+    std::mutex m_mutex;
+    int m_generation;
+    int m_version;
+};
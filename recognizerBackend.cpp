@@ -0,0 +1,302 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const int LBPH_FIXED_GRID = 8;      // Grade do FastLBPH com código especializado (a mesma grade padrão do FastLBPH e do LBPH do OpenCV).
+
+
+#include "recognizerBackend.h"      // Interface do projeto para o reconhecimento de cada frame, com código especializado para rostos 70x70.
+
+#include "recognition.h"
+#include "fastFaceRecognizer.h"     // Projeção com os autovetores quantizados.
+#include "fastLBPHFaceRecognizer.h"
+#include "asyncLog.h"       // Log assíncrono para as mensagens de cada frame.
+
+
+// Produto escalar com 8 somas independentes, para que o compilador possa vetorizar o loop sem mudar a ordem das somas de cada uma.
+// Quando N não é 0, o tamanho é a constante N em vez de 'n'.
+template<int N>
+static inline float dotProduct(const float *a, const float *b, int n)
+{
+    if (N > 0)
+        n = N;
+    float sums[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    int i = 0;
+    for (; i <= n - 8; i += 8) {
+        for (int j = 0; j < 8; j++)
+            sums[j] += a[i + j] * b[i + j];
+    }
+    for (; i < n; i++)
+        sums[0] += a[i] * b[i];
+    return ((sums[0] + sums[1]) + (sums[2] + sums[3])) + ((sums[4] + sums[5]) + (sums[6] + sums[7]));
+}
+
+// y += alpha * x.
+template<int N>
+static inline void addScaled(float *y, const float *x, float alpha, int n)
+{
+    if (N > 0)
+        n = N;
+    for (int i = 0; i < n; i++)
+        y[i] += alpha * x[i];
+}
+
+// Retorna o rosto como uma imagem contínua de 8 bits, convertendo apenas se for preciso.
+static Mat getContinuous8U(const Mat &face)
+{
+    Mat src = face;
+    if (src.type() != CV_8UC1)
+        src.convertTo(src, CV_8U);
+    if (!src.isContinuous())
+        src = src.clone();
+    return src;
+}
+
+
+// Eigenfaces e Fisherfaces: projeção no subespaço, reconstrução e vizinho mais próximo na galeria, como reconstructFace(),
+// getSimilarity() e predict(). WIDTH x HEIGHT é o tamanho dos rostos, ou 0 x 0 para usar o tamanho lido do modelo.
+// Se 'quantized' não é NULL, a projeção usa os autovetores quantizados dele (a propriedade "quantization" do FastEigenfaces e do
+// FastFisherfaces), como o predict() dele faz. A reconstrução continua com os autovetores float, como reconstructFace().
+template<int WIDTH, int HEIGHT>
+class SubspaceBackend : public RecognizerBackend
+{
+public:
+    enum { PIXELS = WIDTH * HEIGHT };
+
+    SubspaceBackend(const Mat &eigenvectors, const Mat &mean, const vector<Mat> &projections, const Mat &labels, double threshold, const string &name,
+                    const Ptr<FaceRecognizer> &model = Ptr<FaceRecognizer>(), const FastSubspaceFaceRecognizer *quantized = NULL)
+        : m_model(model), m_quantized(quantized), m_threshold(threshold), m_name(name)
+    {
+        // Um autovetor por linha, para que cada produto escalar leia memória contínua.
+        Mat(eigenvectors.t()).convertTo(m_vectors, CV_32F);
+        mean.reshape(1, 1).convertTo(m_mean, CV_32F);
+        m_pixels = m_vectors.cols;
+        CV_Assert(PIXELS == 0 || m_pixels == PIXELS);
+        m_gallery.create((int)projections.size(), m_vectors.rows, CV_32F);
+        for (size_t i = 0; i < projections.size(); i++) {
+            Mat row = m_gallery.row((int)i);
+            projections[i].reshape(1, 1).convertTo(row, CV_32F);
+        }
+        Mat labels32;
+        labels.reshape(1, (int)labels.total()).convertTo(labels32, CV_32S);
+        m_labels.assign(labels32.begin<int>(), labels32.end<int>());
+    }
+
+    virtual RecognitionResult recognize(const Mat &preprocessedFace) const
+    {
+        const int d = PIXELS > 0 ? (int)PIXELS : m_pixels;
+        const int k = m_vectors.rows;
+        Mat src = getContinuous8U(preprocessedFace);
+        if ((int)src.total() != d)
+            CV_Error(CV_StsBadArg, format("Wrong input image size. Expected an image with %d elements, but got %d.", d, (int)src.total()));
+
+        AutoBuffer<float> buffer(2 * d + k);
+        float *centered = buffer;
+        float *reconstruction = centered + d;
+        float *projection = reconstruction + d;
+        const uchar *x = src.ptr<uchar>(0);
+        const float *mean = m_mean.ptr<float>(0);
+
+        if (m_quantized) {
+            Mat q = m_quantized->project(src);
+            const float *y = q.ptr<float>(0);
+            for (int j = 0; j < k; j++)
+                projection[j] = y[j];
+        }
+        else {
+            for (int i = 0; i < d; i++)
+                centered[i] = x[i] - mean[i];
+            for (int j = 0; j < k; j++)
+                projection[j] = dotProduct<PIXELS>(m_vectors.ptr<float>(j), centered, d);
+        }
+
+        // Reconstrói o rosto e compara com o original, como getSimilarity() faz com o rosto de 8 bits de reconstructFace().
+        for (int i = 0; i < d; i++)
+            reconstruction[i] = mean[i];
+        for (int j = 0; j < k; j++)
+            addScaled<PIXELS>(reconstruction, m_vectors.ptr<float>(j), projection[j], d);
+        double errorL2 = 0;
+        for (int i = 0; i < d; i++) {
+            int diff = (int)x[i] - (int)saturate_cast<uchar>(reconstruction[i]);
+            errorL2 += diff * diff;
+        }
+
+        RecognitionResult result;
+        result.similarity = sqrt(errorL2) / (double)d;
+        result.label = -1;
+        result.distance = DBL_MAX;
+        for (int g = 0; g < m_gallery.rows; g++) {
+            const float *p = m_gallery.ptr<float>(g);
+            float dist2 = 0;
+            for (int j = 0; j < k; j++)
+                dist2 += (p[j] - projection[j]) * (p[j] - projection[j]);
+            double dist = sqrt((double)dist2);
+            if ((dist < result.distance) && (dist < m_threshold)) {
+                result.distance = dist;
+                result.label = m_labels[g];
+            }
+        }
+        return result;
+    }
+
+    virtual const char* getName() const { return m_name.c_str(); }
+    virtual bool isFixedSize() const { return PIXELS > 0; }
+
+private:
+    Ptr<FaceRecognizer> m_model;                    // Mantém 'm_quantized' vivo.
+    const FastSubspaceFaceRecognizer *m_quantized;  // NULL para projetar com os autovetores float.
+    Mat m_vectors;      // K x D (CV_32F).
+    Mat m_mean;         // 1 x D (CV_32F).
+    Mat m_gallery;      // G x K (CV_32F).
+    vector<int> m_labels;
+    int m_pixels;
+    double m_threshold;
+    string m_name;
+};
+
+// FastLBPH: histogramas das células e distância chi-quadrado para cada rosto da galeria, como FastLBPH::predict(). FEATURES é o tamanho
+// dos histogramas (grade x grade x 256) e WIDTH x HEIGHT o tamanho dos rostos, ou 0 para usar os valores lidos do modelo.
+// Não há reconstrução, então 'similarity' é sempre 0, como reconstructFace() faz com o LBPH.
+template<int WIDTH, int HEIGHT, int FEATURES>
+class LBPHBackend : public RecognizerBackend
+{
+public:
+    LBPHBackend(int gridX, int gridY, const Mat &histograms, const Mat &labels, double threshold)
+        : m_gridX(gridX), m_gridY(gridY), m_threshold(threshold)
+    {
+        histograms.convertTo(m_gallery, CV_32F);
+        CV_Assert(FEATURES == 0 || m_gallery.cols == FEATURES);
+        Mat labels32;
+        labels.reshape(1, (int)labels.total()).convertTo(labels32, CV_32S);
+        m_labels.assign(labels32.begin<int>(), labels32.end<int>());
+    }
+
+    virtual RecognitionResult recognize(const Mat &preprocessedFace) const
+    {
+        const int features = FEATURES > 0 ? FEATURES : m_gallery.cols;
+        Mat src = getContinuous8U(preprocessedFace);
+        if (WIDTH > 0 && (src.cols != WIDTH || src.rows != HEIGHT))
+            CV_Error(CV_StsBadArg, format("Wrong input image size. Expected a %dx%d face, but got %dx%d.", WIDTH, HEIGHT, src.cols, src.rows));
+
+        AutoBuffer<float> histogram(features);
+        computeLBPHistogram(src, m_gridX, m_gridY, histogram);
+
+        RecognitionResult result;
+        result.similarity = 0;
+        result.label = -1;
+        result.distance = DBL_MAX;
+        for (int g = 0; g < m_gallery.rows; g++) {
+            double dist = chiSquareDistance(histogram, m_gallery.ptr<float>(g), features);
+            if ((dist < result.distance) && (dist < m_threshold)) {
+                result.distance = dist;
+                result.label = m_labels[g];
+            }
+        }
+        return result;
+    }
+
+    virtual const char* getName() const { return "FaceRecognizer.FastLBPH"; }
+    virtual bool isFixedSize() const { return FEATURES > 0; }
+
+private:
+    int m_gridX;
+    int m_gridY;
+    Mat m_gallery;      // G x FEATURES (CV_32F).
+    vector<int> m_labels;
+    double m_threshold;
+};
+
+// Para outros algoritmos: o mesmo que o loop do main.cpp fazia antes, através das propriedades do FaceRecognizer.
+class GenericBackend : public RecognizerBackend
+{
+public:
+    GenericBackend(const Ptr<FaceRecognizer> &model, const string &name) : m_model(model), m_name(name) {}
+
+    virtual RecognitionResult recognize(const Mat &preprocessedFace) const
+    {
+        RecognitionResult result;
+        Mat reconstructedFace = reconstructFace(m_model, preprocessedFace);
+        result.similarity = getSimilarity(preprocessedFace, reconstructedFace);
+        m_model->predict(preprocessedFace, result.label, result.distance);
+        return result;
+    }
+
+    virtual const char* getName() const { return m_name.c_str(); }
+    virtual bool isFixedSize() const { return false; }
+
+private:
+    Ptr<FaceRecognizer> m_model;
+    string m_name;
+};
+
+// Troca um nome nos resultados de outro backend.
+class RelabeledBackend : public RecognizerBackend
+{
+public:
+    RelabeledBackend(const std::shared_ptr<RecognizerBackend> &backend, int label, int newLabel)
+        : m_backend(backend), m_label(label), m_newLabel(newLabel) {}
+
+    virtual RecognitionResult recognize(const Mat &preprocessedFace) const
+    {
+        RecognitionResult result = m_backend->recognize(preprocessedFace);
+        if (result.label == m_label) {
+            result.label = (m_newLabel >= 0) ? m_newLabel : -1;
+            if (m_newLabel < 0)
+                result.distance = DBL_MAX;
+        }
+        return result;
+    }
+
+    virtual const char* getName() const { return m_backend->getName(); }
+    virtual bool isFixedSize() const { return m_backend->isFixedSize(); }
+
+private:
+    std::shared_ptr<RecognizerBackend> m_backend;
+    int m_label;
+    int m_newLabel;
+};
+
+
+std::shared_ptr<RecognizerBackend> createRecognizerBackend(const Ptr<FaceRecognizer> &model, const string &facerecAlgorithm, Size faceSize, bool allowFixedSize)
+{
+    if (model.empty())
+        return std::shared_ptr<RecognizerBackend>();
+    bool fixedSize = allowFixedSize && (faceSize == Size(FIXED_FACE_WIDTH, FIXED_FACE_HEIGHT));
+
+    // As propriedades do modelo são lidas só aqui, uma vez por modelo.
+    try {
+        if (facerecAlgorithm.find("Eigenfaces") != string::npos || facerecAlgorithm.find("Fisherfaces") != string::npos) {
+            Mat eigenvectors = model->get<Mat>("eigenvectors");
+            Mat mean = model->get<Mat>("mean");
+            vector<Mat> projections = model->get<vector<Mat> >("projections");
+            Mat labels = model->get<Mat>("labels");
+            double threshold = model->get<double>("threshold");
+            const FastSubspaceFaceRecognizer *fast = dynamic_cast<const FastSubspaceFaceRecognizer*>((const FaceRecognizer*)model);
+            const FastSubspaceFaceRecognizer *quantized = (fast && fast->getProjectionQuantization() != PROJECTION_FLOAT32) ? fast : NULL;
+            if (fixedSize)
+                return std::make_shared<SubspaceBackend<FIXED_FACE_WIDTH, FIXED_FACE_HEIGHT> >(eigenvectors, mean, projections, labels, threshold, facerecAlgorithm,
+                                                                                               model, quantized);
+            return std::make_shared<SubspaceBackend<0, 0> >(eigenvectors, mean, projections, labels, threshold, facerecAlgorithm, model, quantized);
+        }
+        if (facerecAlgorithm == "FaceRecognizer.FastLBPH") {
+            int gridX = model->get<int>("grid_x");
+            int gridY = model->get<int>("grid_y");
+            Mat histograms = model->get<Mat>("histograms");
+            Mat labels = model->get<Mat>("labels");
+            double threshold = model->get<double>("threshold");
+            if (fixedSize && gridX == LBPH_FIXED_GRID && gridY == LBPH_FIXED_GRID)
+                return std::make_shared<LBPHBackend<FIXED_FACE_WIDTH, FIXED_FACE_HEIGHT, LBPH_FIXED_GRID * LBPH_FIXED_GRID * 256> >(gridX, gridY, histograms, labels, threshold);
+            return std::make_shared<LBPHBackend<0, 0, 0> >(gridX, gridY, histograms, labels, threshold);
+        }
+    } catch (cv::Exception &e) {
+        ALOG(LOG_LEVEL_WARNING, "Could not read the properties of the [%s] model, using the generic recognizer: %s", facerecAlgorithm.c_str(), e.what());
+    }
+    return std::make_shared<GenericBackend>(model, facerecAlgorithm);
+}
+
+std::shared_ptr<RecognizerBackend> createRelabeledBackend(const std::shared_ptr<RecognizerBackend> &backend, int label, int newLabel)
+{
+    if (!backend)
+        return backend;
+    return std::make_shared<RelabeledBackend>(backend, label, newLabel);
+}
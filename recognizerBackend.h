@@ -0,0 +1,54 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include "opencv2/opencv.hpp"
+
+
+using namespace cv;
+using namespace std;
+
+// Resultado do reconhecimento de um rosto, como no loop do main.cpp: 'similarity' é o mesmo valor que getSimilarity() dá entre o rosto
+// e o rosto reconstruído (valores altos significam uma pessoa desconhecida), e 'label' e 'distance' são os mesmos que model->predict() dá.
+struct RecognitionResult
+{
+    int label;
+    double distance;
+    double similarity;
+};
+
+// Interface do próprio projeto para o reconhecimento de cada frame, independente das propriedades do FaceRecognizer do OpenCV.
+// Um backend é criado uma vez para cada modelo treinado com createRecognizerBackend(), que lê as propriedades do modelo
+// ("eigenvectors", "mean", "projections", "histograms", ...) uma única vez. Depois disso, o reconhecimento de cada frame não faz
+// nenhuma busca por nome, e para rostos do tamanho do main.cpp (70x70) usa código especializado para esse tamanho, em que todos
+// os loops por pixel ou por bin do histograma têm um tamanho constante que o compilador pode desenrolar e vetorizar.
+// Outros tamanhos de rosto continuam funcionando, com os mesmos loops de tamanho lido do modelo.
+class RecognizerBackend
+{
+public:
+    virtual ~RecognizerBackend() {}
+
+    // Reconhece um rosto pré-processado, com o mesmo resultado que reconstructFace(), getSimilarity() e model->predict() juntos.
+    virtual RecognitionResult recognize(const Mat &preprocessedFace) const = 0;
+
+    // O algoritmo do modelo (como em 'facerecAlgorithm'), e se o código especializado para o tamanho do rosto está sendo usado.
+    virtual const char* getName() const = 0;
+    virtual bool isFixedSize() const = 0;
+};
+
+// Tamanho dos rostos com código especializado. Deve ser o mesmo 'faceWidth' do main.cpp.
+const int FIXED_FACE_WIDTH = 70;
+const int FIXED_FACE_HEIGHT = 70;
+
+// Cria o backend para um modelo já treinado com rostos de 'faceSize', escolhendo a implementação pelo 'facerecAlgorithm' usado no
+// treinamento: Eigenfaces e Fisherfaces (do OpenCV ou os rápidos), FastLBPH, ou, para outros algoritmos, um backend genérico que
+// chama reconstructFace(), getSimilarity() e predict(). Retorna um ponteiro vazio se o modelo estiver vazio.
+// 'allowFixedSize' = false força o código de tamanho genérico, para compará-lo com o especializado (veja benchRecognition).
+std::shared_ptr<RecognizerBackend> createRecognizerBackend(const Ptr<FaceRecognizer> &model, const string &facerecAlgorithm, Size faceSize, bool allowFixedSize = true);
+
+// Envolve outro backend trocando o nome 'label' por 'newLabel' nos resultados, ou por -1 (pessoa desconhecida) se 'newLabel' for negativo.
+// Usado quando a galeria do modelo não pode ser atualizada sem treinar de novo (os algoritmos do OpenCV), até o próximo treinamento.
+std::shared_ptr<RecognizerBackend> createRelabeledBackend(const std::shared_ptr<RecognizerBackend> &backend, int label, int newLabel);
@@ -0,0 +1,118 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+// Faixas de cor de pele, nos valores de 8 bits retornados por convertImageRGBtoYIQ() e convertImageRGBtoHSV() (Matiz de 0 a 255).
+// O componente I do YIQ separa bem a pele (tons vermelho-alaranjados) do fundo, e a Matiz/Saturação removem o que sobra.
+const int SKIN_MIN_I = 135;             // I = +0.03
+const int SKIN_MAX_I = 210;             // I = +0.39
+const int SKIN_MAX_HUE = 40;            // Matiz de 0 a 56 graus ...
+const int SKIN_MIN_HUE_WRAP = 235;      // ... ou de 332 a 360 graus.
+const int SKIN_MIN_S = 25;              // Saturação entre 0.10 ...
+const int SKIN_MAX_S = 200;             // ... e 0.78
+const int SKIN_MIN_V = 40;              // Ignora os pixels muito escuros, onde a cor não é confiável.
+
+const int SKIN_MIN_BLOB_SIZE = 6;       // Tamanho mínimo de um bloco de pele (em pixels da máscara reduzida) para conter um rosto.
+const float SKIN_REGION_BORDER = 0.25f; // Quanto aumentar cada bloco de pele, já que a pele pode não cobrir a testa, o queixo ou as bordas do rosto.
+
+
+#include "skinDetection.h"     // Encontra as regiões com cor de pele, para reduzir a área onde o detector de rosto procura.
+
+#include "ImageUtils.h"      // Funções úteis
+
+// Calcula uma máscara reduzida (com largura 'scaledWidth') com os pixels que têm cor de pele na imagem colorida BGR ou BGRA.
+// Usa as conversões rápidas para YIQ e HSV do ImageUtils.
+void getSkinMask(const Mat &img, Mat &skinMask, int scaledWidth)
+{
+    // A detecção de pele precisa de uma imagem BGR.
+    Mat bgr;
+    if (img.channels() == 4) {
+        cvtColor(img, bgr, CV_BGRA2BGR);
+    }
+    else {
+        bgr = img;
+    }
+
+    // Reduzir a imagem, já que só precisamos dos blocos grandes de pele.
+    Mat smallImg;
+    if (bgr.cols > scaledWidth) {
+        int scaledHeight = cvRound(bgr.rows * scaledWidth / (float)bgr.cols);
+        resize(bgr, smallImg, Size(scaledWidth, scaledHeight), 0, 0, INTER_AREA);
+    }
+    else {
+        smallImg = bgr;
+    }
+
+    Mat imageYIQ, imageHSV;
+    convertImageRGBtoYIQ(smallImg, imageYIQ);
+    convertImageRGBtoHSV(smallImg, imageHSV);
+
+    // Pixels de pele têm o componente I na faixa de pele, e uma Matiz vermelho-alaranjada (que dá a volta no círculo em 255).
+    Mat skinI, skinHue, skinHueWrap;
+    inRange(imageYIQ, Scalar(0, SKIN_MIN_I, 0), Scalar(255, SKIN_MAX_I, 255), skinI);
+    inRange(imageHSV, Scalar(0, SKIN_MIN_S, SKIN_MIN_V), Scalar(SKIN_MAX_HUE, SKIN_MAX_S, 255), skinHue);
+    inRange(imageHSV, Scalar(SKIN_MIN_HUE_WRAP, SKIN_MIN_S, SKIN_MIN_V), Scalar(255, SKIN_MAX_S, 255), skinHueWrap);
+    skinMask = skinI & (skinHue | skinHueWrap);
+
+    // Remove os pixels isolados, e fecha os buracos dos olhos, boca e sobrancelhas.
+    morphologyEx(skinMask, skinMask, MORPH_OPEN, Mat());
+    morphologyEx(skinMask, skinMask, MORPH_CLOSE, getStructuringElement(MORPH_ELLIPSE, Size(5, 5)));
+}
+
+// Encontra os blocos de pele na imagem colorida, armazenando seus retângulos (em coordenadas da imagem original) em 'skinRegions'.
+// Os retângulos que se sobrepõem são juntados, para que o detector não procure na mesma área duas vezes.
+// Retorna a fração da imagem coberta pelas regiões (1.0 se a imagem não é colorida, já que então a imagem toda precisa ser procurada).
+double detectSkinRegions(const Mat &img, vector<Rect> &skinRegions, int scaledWidth)
+{
+    skinRegions.clear();
+    Rect wholeImage = Rect(0, 0, img.cols, img.rows);
+
+    // Não dá para detectar pele em uma imagem em tons de cinza, então procura na imagem toda.
+    if (img.channels() < 3) {
+        skinRegions.push_back(wholeImage);
+        return 1.0;
+    }
+
+    Mat skinMask;
+    getSkinMask(img, skinMask, scaledWidth);
+    float scale = img.cols / (float)skinMask.cols;
+
+    // Pega o retângulo em volta de cada bloco de pele. Note que findContours() modifica a máscara.
+    vector<vector<Point> > contours;
+    findContours(skinMask, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+    for (int i = 0; i < (int)contours.size(); i++) {
+        Rect r = boundingRect(contours[i]);
+        if (r.width < SKIN_MIN_BLOB_SIZE || r.height < SKIN_MIN_BLOB_SIZE)
+            continue;
+
+        // Aumenta o retângulo, e converte para as coordenadas da imagem original.
+        int bx = cvRound(r.width * SKIN_REGION_BORDER);
+        int by = cvRound(r.height * SKIN_REGION_BORDER);
+        r = Rect(r.x - bx, r.y - by, r.width + 2*bx, r.height + 2*by);
+        r = Rect(cvFloor(r.x * scale), cvFloor(r.y * scale), cvCeil(r.width * scale), cvCeil(r.height * scale));
+        r &= wholeImage;
+        if (r.area() > 0)
+            skinRegions.push_back(r);
+    }
+
+    // Junta os retângulos que se sobrepõem.
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < (int)skinRegions.size() && !merged; i++) {
+            for (int j = i + 1; j < (int)skinRegions.size(); j++) {
+                if ((skinRegions[i] & skinRegions[j]).area() > 0) {
+                    skinRegions[i] |= skinRegions[j];
+                    skinRegions.erase(skinRegions.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    double skinArea = 0;
+    for (int i = 0; i < (int)skinRegions.size(); i++)
+        skinArea += skinRegions[i].area();
+    return skinArea / (double)wholeImage.area();
+}
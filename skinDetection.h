@@ -0,0 +1,18 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+
+using namespace cv;
+using namespace std;
+
+// Largura usada para calcular a máscara de pele. Não precisa de muita resolução, já que só queremos os blocos grandes de pele.
+const int SKIN_MASK_WIDTH = 160;
+
+void getSkinMask(const Mat &img, Mat &skinMask, int scaledWidth = SKIN_MASK_WIDTH);
+
+double detectSkinRegions(const Mat &img, vector<Rect> &skinRegions, int scaledWidth = SKIN_MASK_WIDTH);
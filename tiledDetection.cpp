@@ -0,0 +1,146 @@
+/*****************************************************************************
+*   Face Recognition using Eigenfaces or Fisherfaces
+******************************************************************************/
+
+const int TILE_SIZE_IN_OBJECTS = 16;        // Lado de cada tile, em múltiplos do menor objeto procurado.
+const int TILE_OVERLAP_IN_OBJECTS = 4;      // Sobreposição entre os tiles, que também é o maior objeto procurado nos tiles.
+const float TILE_SEARCH_SCALE_FACTOR = 1.1f;        // Os mesmos parâmetros de detectManyObjects().
+const int TILE_MIN_NEIGHBORS = 4;
+const double TILE_NMS_OVERLAP = 0.5;        // Fração do menor retângulo coberta pelo outro para serem considerados o mesmo objeto.
+
+
+#include "tiledDetection.h"     // Detecção em tiles paralelos para imagens muito grandes.
+#include "detectObject.h"       // detectObjectsCustom().
+
+#include <algorithm>
+
+
+// Procura uma lista de tiles, para que cv::parallel_for_ possa dividir os tiles entre as threads.
+// O item 0 é a passada na imagem toda reduzida, para os objetos maiores que a sobreposição, e os itens seguintes são os tiles.
+class TiledDetector::DetectTilesBody : public ParallelLoopBody
+{
+public:
+    DetectTilesBody(TiledDetector &detector, const Mat &img, int minObjectSize, int overlap, vector<vector<Rect> > &results)
+        : m_detector(detector), m_img(img), m_minObjectSize(minObjectSize), m_overlap(overlap), m_results(results) {}
+
+    virtual void operator()(const Range &range) const
+    {
+        CascadeClassifier *cascade = m_detector.m_cascade.acquireWorker();
+        for (int i = range.start; i < range.end; i++) {
+            vector<Rect> &objects = m_results[i];
+            if (i == 0) {
+                // Reduz a imagem para os objetos do tamanho da sobreposição ficarem do tamanho da janela do detector.
+                int scaledWidth = max(cvRound(m_img.cols * m_detector.m_windowSize.width / (double)m_overlap), 1);
+                detectObjectsCustom(m_img, *cascade, objects, scaledWidth, CASCADE_SCALE_IMAGE, m_detector.m_windowSize, Size(),
+                                    TILE_SEARCH_SCALE_FACTOR, TILE_MIN_NEIGHBORS);
+            }
+            else {
+                // Na resolução original, só os objetos que cabem inteiros na sobreposição.
+                Rect tile = m_detector.m_tiles[i - 1];
+                detectObjectsCustom(m_img(tile), *cascade, objects, tile.width, CASCADE_SCALE_IMAGE, Size(m_minObjectSize, m_minObjectSize),
+                                    Size(m_overlap, m_overlap), TILE_SEARCH_SCALE_FACTOR, TILE_MIN_NEIGHBORS);
+                for (size_t j = 0; j < objects.size(); j++) {
+                    objects[j].x += tile.x;
+                    objects[j].y += tile.y;
+                }
+            }
+        }
+        m_detector.m_cascade.releaseWorker(cascade);
+    }
+
+private:
+    TiledDetector &m_detector;
+    const Mat &m_img;
+    int m_minObjectSize;
+    int m_overlap;
+    vector<vector<Rect> > &m_results;
+};
+
+
+static bool compareRectAreas(const Rect &a, const Rect &b)
+{
+    return a.area() > b.area();
+}
+
+// Junta as detecções repetidas: um objeto na sobreposição de dois tiles aparece nos dois, às vezes cortado na borda de um deles, e
+// os objetos perto do tamanho da sobreposição também podem ser encontrados na passada reduzida. Mantém o maior retângulo de cada grupo.
+static void suppressOverlaps(vector<Rect> &objects)
+{
+    sort(objects.begin(), objects.end(), compareRectAreas);
+    vector<Rect> kept;
+    for (size_t i = 0; i < objects.size(); i++) {
+        bool repeated = false;
+        for (size_t j = 0; j < kept.size() && !repeated; j++) {
+            int intersection = (objects[i] & kept[j]).area();
+            repeated = intersection > TILE_NMS_OVERLAP * min(objects[i].area(), kept[j].area());
+        }
+        if (!repeated)
+            kept.push_back(objects[i]);
+    }
+    objects.swap(kept);
+}
+
+
+TiledDetector::TiledDetector()
+{
+}
+
+// Os detectores no formato antigo (como haarcascade_frontalface_alt_tree.xml) não podem ser copiados na memória para as threads.
+bool TiledDetector::load(const string &filename)
+{
+    if (!m_cascade.load(filename))
+        return false;
+    if (m_cascade.isOldFormatCascade()) {
+        cerr << "ERROR: The detector [" << filename << "] is in the old format, which the tiled detection does not support!" << endl;
+        return false;
+    }
+    m_windowSize = m_cascade.getOriginalWindowSize();
+    return true;
+}
+
+void TiledDetector::detect(const Mat &img, vector<Rect> &objects, int minObjectSize)
+{
+    objects.clear();
+    m_tiles.clear();
+    if (empty() || img.empty())
+        return;
+
+    // O detector não encontra objetos menores que a sua janela sem aumentar a imagem.
+    minObjectSize = max(minObjectSize, m_windowSize.width);
+    int tileSize = TILE_SIZE_IN_OBJECTS * minObjectSize;
+    int overlap = TILE_OVERLAP_IN_OBJECTS * minObjectSize;
+    int step = tileSize - overlap;
+
+    // Tiles em uma grade, com a última linha e a última coluna encostadas na borda da imagem.
+    // Uma imagem que cabe em um tile só é procurada inteira, sem a passada reduzida.
+    if (img.cols <= tileSize && img.rows <= tileSize) {
+        m_tiles.push_back(Rect(0, 0, img.cols, img.rows));
+    }
+    else {
+        for (int y = 0; ; y += step) {
+            int tileY = min(y, max(img.rows - tileSize, 0));
+            for (int x = 0; ; x += step) {
+                int tileX = min(x, max(img.cols - tileSize, 0));
+                m_tiles.push_back(Rect(tileX, tileY, min(tileSize, img.cols - tileX), min(tileSize, img.rows - tileY)));
+                if (tileX + tileSize >= img.cols)
+                    break;
+            }
+            if (tileY + tileSize >= img.rows)
+                break;
+        }
+    }
+
+    vector<vector<Rect> > results(m_tiles.size() + 1);
+    if (m_tiles.size() == 1) {
+        // Sem sobreposição, então o único tile procura objetos de qualquer tamanho.
+        overlap = max(img.cols, img.rows);
+        DetectTilesBody(*this, img, minObjectSize, overlap, results)(Range(1, 2));
+    }
+    else {
+        parallel_for_(Range(0, (int)results.size()), DetectTilesBody(*this, img, minObjectSize, overlap, results));
+    }
+
+    for (size_t i = 0; i < results.size(); i++)
+        objects.insert(objects.end(), results[i].begin(), results[i].end());
+    suppressOverlaps(objects);
+}
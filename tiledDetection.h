@@ -0,0 +1,45 @@
+#pragma once
+
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+#include "multiScaleCascade.h"      // As cópias do detector para as threads.
+
+
+using namespace cv;
+using namespace std;
+
+// Detecção de objetos pequenos (rostos distantes) em imagens muito grandes, como as de câmeras 4K ou panorâmicas.
+// detectObjectsCustom() reduz a imagem toda para 'scaledWidth' pixels, e nessa escala os rostos distantes somem, mas procurar na imagem
+// inteira sem reduzir com um único detectMultiScale() é lento demais. Aqui a imagem é dividida em tiles sobrepostos, do tamanho
+// proporcional ao menor rosto procurado, e cada tile é procurado na resolução original em paralelo (cv::parallel_for_).
+// Os tiles só procuram rostos até o tamanho da sobreposição, então cada um deles cabe inteiro em pelo menos um tile, e os rostos
+// maiores são procurados na imagem toda reduzida, ao mesmo tempo que os tiles. No final, as detecções repetidas nas sobreposições
+// são juntadas com supressão de não-máximos.
+class TiledDetector
+{
+public:
+    TiledDetector();
+
+    // Carrega o detector (o mesmo arquivo XML do CascadeClassifier, só no formato novo). Um CascadeClassifier não pode ser usado por
+    // várias threads ao mesmo tempo, então cada thread usa a sua própria cópia, feita na memória por MultiScaleCascade::acquireWorker()
+    // e com o seu próprio avaliador de features, então o resultado não depende do número de threads.
+    bool load(const string &filename);
+    bool empty() const { return m_cascade.empty() || m_cascade.isOldFormatCascade(); }
+
+    // Procura todos os objetos com pelo menos 'minObjectSize' pixels de largura, na resolução original de 'img'.
+    void detect(const Mat &img, vector<Rect> &objects, int minObjectSize);
+
+    // Os tiles da última chamada de detect(), por exemplo para desenhar.
+    const vector<Rect> &getTiles() const { return m_tiles; }
+
+private:
+    class DetectTilesBody;
+
+    MultiScaleCascade m_cascade;                    // O detector carregado, de onde as cópias das threads são feitas.
+    Size m_windowSize;                              // O tamanho do objeto no treinamento do detector (o menor que ele encontra).
+    vector<Rect> m_tiles;
+};